@@ -0,0 +1,422 @@
+#include "bitmatrix.h"
+
+#include <bitset>
+
+/**
+ *  @file bitmatrix.cpp
+ *  @brief Implementation of BitMatrix
+ *  */
+
+ /**
+ *  @class BitMatrix
+ *  @version 1.0
+ *  @brief nxn matrix of bits stored as 64-bit words, 32 times smaller than SquareMatrix. Meant for adjacency
+ *      and reachability where every element is 0 or 1. Products are computed over the Boolean semiring or over GF(2)
+ *      with the method of Four Russians: for every 8 rows of the right-hand side a table of all 256 combinations
+ *      of them is built, and each row of the result takes one table entry per 8 columns of the left-hand side
+ *      instead of 8 separate rows. Tables cover 16 words of 512 result rows at a time so that they and the
+ *      updated part of the result stay in cache
+ *  @author Niko Lehto
+ *  */
+
+const size_t BitMatrix::tableBits;
+const size_t BitMatrix::blockRows;
+const size_t BitMatrix::blockWords;
+
+/**
+ *  \brief Empty constructor, 0x0 matrix
+ */
+BitMatrix::BitMatrix() = default;
+
+/**
+ *  \brief Constructor of zero matrix
+ *  \param [in] n int dimension of matrix
+ */
+BitMatrix::BitMatrix(int n)
+{
+    if(n < 0)
+    {
+        throw std::invalid_argument("Matrix dimension can not be negative");
+    }
+    this->n = n;
+    this->wordsPerRow = (static_cast<size_t>(n) + 63) / 64;
+    this->words.assign(wordsPerRow * n, 0);
+}
+
+/**
+ *  \brief Converts a dense matrix, every nonzero element becomes 1
+ *  \param [in] m const SquareMatrixView& matrix to convert
+ */
+BitMatrix::BitMatrix(const SquareMatrixView& m) : BitMatrix(m.getDimension())
+{
+    SquareMatrix::runParallel(n, n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const int* source = m.row(i);
+            uint64_t* target = row(i);
+            for(size_t j = 0; j < static_cast<size_t>(n); j++)
+            {
+                target[j / 64] |= static_cast<uint64_t>(source[j] != 0) << (j % 64);
+            }
+        }
+    });
+}
+
+/**
+ *  \brief Destructor
+ */
+BitMatrix::~BitMatrix() = default;
+
+/**
+ *  \brief Identity matrix
+ *  \param [in] n int dimension of matrix
+ *  \return BitMatrix with ones on the diagonal
+ */
+BitMatrix BitMatrix::identity(int n)
+{
+    BitMatrix result(n);
+    for(size_t i = 0; i < static_cast<size_t>(n); i++)
+    {
+        result.row(i)[i / 64] = static_cast<uint64_t>(1) << (i % 64);
+    }
+    return result;
+}
+
+/**
+ *  \brief Words of row
+ *  \param [in] i size_t row index
+ *  \return uint64_t* first word of row
+ */
+uint64_t* BitMatrix::row(size_t i)
+{
+    return words.data() + i * wordsPerRow;
+}
+
+/**
+ *  \brief Words of row
+ *  \param [in] i size_t row index
+ *  \return const uint64_t* first word of row
+ */
+const uint64_t* BitMatrix::row(size_t i) const
+{
+    return words.data() + i * wordsPerRow;
+}
+
+/**
+ *  \brief Bits of row i in columns [column, column+tableBits)
+ *  \param [in] i size_t row index
+ *  \param [in] column size_t first column, multiple of tableBits
+ *  \return unsigned int bit b is column column+b, columns past n are 0
+ */
+unsigned int BitMatrix::chunk(size_t i, size_t column) const
+{
+    return static_cast<unsigned int>(row(i)[column / 64] >> (column % 64)) & ((1u << tableBits) - 1);
+}
+
+/**
+ *  \brief Product of a and b with the method of Four Russians
+ *  \param [in] a const BitMatrix& left-hand side
+ *  \param [in] b const BitMatrix& right-hand side
+ *  \param [in] algebra Algebra Boolean for OR of ANDs, GF2 for XOR of ANDs
+ *  \return BitMatrix product of a and b
+ */
+BitMatrix BitMatrix::multiply(const BitMatrix& a, const BitMatrix& b, Algebra algebra)
+{
+    if(a.n != b.n)
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    BitMatrix result(a.n);
+    size_t t_n = a.n;
+    size_t t_words = a.wordsPerRow;
+    bool gf2 = algebra == GF2;
+
+    SquareMatrix::runParallel(t_n, t_n / tableBits * t_words + 1, [&](size_t worker_start, size_t worker_stop)
+    {
+        std::vector<uint64_t> table((static_cast<size_t>(1) << tableBits) * blockWords);
+        for(size_t i0 = worker_start; i0 < worker_stop; i0 += blockRows)
+        {
+            size_t i1 = std::min(i0 + blockRows, worker_stop);
+            for(size_t w0 = 0; w0 < t_words; w0 += blockWords)
+            {
+                size_t width = std::min(blockWords, t_words - w0);
+                for(size_t k = 0; k < t_n; k += tableBits)
+                {
+                    // entry s combines rows k+bit of b for every bit set in s, built from s without its highest bit
+                    size_t depth = std::min(tableBits, t_n - k);
+                    size_t high = 0;
+                    std::fill(table.begin(), table.begin() + width, 0);
+                    for(size_t s = 1; s < (static_cast<size_t>(1) << depth); s++)
+                    {
+                        if(s == (static_cast<size_t>(2) << high))
+                        {
+                            high++;
+                        }
+                        const uint64_t* previous = table.data() + (s ^ (static_cast<size_t>(1) << high)) * blockWords;
+                        const uint64_t* source = b.row(k + high) + w0;
+                        uint64_t* target = table.data() + s * blockWords;
+                        for(size_t w = 0; w < width; w++)
+                        {
+                            target[w] = gf2 ? previous[w] ^ source[w] : previous[w] | source[w];
+                        }
+                    }
+
+                    for(size_t i = i0; i < i1; i++)
+                    {
+                        unsigned int bits = a.chunk(i, k);
+                        if(bits == 0)
+                        {
+                            continue;
+                        }
+                        const uint64_t* source = table.data() + bits * blockWords;
+                        uint64_t* target = result.row(i) + w0;
+                        if(gf2)
+                        {
+                            for(size_t w = 0; w < width; w++)
+                            {
+                                target[w] ^= source[w];
+                            }
+                        }
+                        else
+                        {
+                            for(size_t w = 0; w < width; w++)
+                            {
+                                target[w] |= source[w];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    return result;
+}
+
+/**
+ *  \brief Getter for dimension
+ *  \return int dimension n of nxn matrix
+ */
+int BitMatrix::getDimension() const
+{
+    return this->n;
+}
+
+/**
+ *  \brief Getter for memory used by elements
+ *  \return size_t bytes used by words
+ */
+size_t BitMatrix::getStorageBytes() const
+{
+    return words.size() * sizeof(uint64_t);
+}
+
+/**
+ *  \brief Getter for single element
+ *  \param [in] row size_t row index starting from 0
+ *  \param [in] col size_t column index starting from 0
+ *  \return bool element at row, col
+ */
+bool BitMatrix::getElement(size_t row, size_t col) const
+{
+    if(row >= static_cast<size_t>(n) || col >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    return (this->row(row)[col / 64] >> (col % 64)) & 1;
+}
+
+/**
+ *  \brief Setter for single element
+ *  \param [in] row size_t row index starting from 0
+ *  \param [in] col size_t column index starting from 0
+ *  \param [in] value bool new value
+ */
+void BitMatrix::setElement(size_t row, size_t col, bool value)
+{
+    if(row >= static_cast<size_t>(n) || col >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    uint64_t mask = static_cast<uint64_t>(1) << (col % 64);
+    uint64_t& word = this->row(row)[col / 64];
+    word = value ? word | mask : word & ~mask;
+}
+
+/**
+ *  \brief Number of ones, edges of a graph
+ *  \return size_t population count of all words
+ */
+size_t BitMatrix::count() const
+{
+    size_t ones = 0;
+    for(uint64_t word : words)
+    {
+        ones += std::bitset<64>(word).count();
+    }
+    return ones;
+}
+
+/**
+ *  \brief Number of ones in a row, out-degree of a node
+ *  \param [in] row size_t row index starting from 0
+ *  \return size_t population count of row
+ */
+size_t BitMatrix::countRow(size_t row) const
+{
+    if(row >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    size_t ones = 0;
+    const uint64_t* source = this->row(row);
+    for(size_t w = 0; w < wordsPerRow; w++)
+    {
+        ones += std::bitset<64>(source[w]).count();
+    }
+    return ones;
+}
+
+/**
+ *  \brief Expands into dense matrix of zeros and ones
+ *  \return SquareMatrix with all n*n elements
+ */
+SquareMatrix BitMatrix::toSquareMatrix() const
+{
+    SquareMatrix dense;
+    dense.allocate(this->n);
+    size_t t_n = this->n;
+
+    SquareMatrix::runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const uint64_t* source = row(i);
+            int* target = dense.elements.get() + i * t_n;
+            for(size_t j = 0; j < t_n; j++)
+            {
+                target[j] = (source[j / 64] >> (j % 64)) & 1;
+            }
+        }
+    });
+
+    return dense;
+}
+
+/**
+ *  \brief Write object to string in form of [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \return std::string object as a string
+ */
+std::string BitMatrix::toString() const
+{
+	std::stringstream result;
+	result << *this;
+	return result.str();
+}
+
+/**
+ *  \brief Overload of equal comparison
+ *  \param [in] m const BitMatrix& value for comparison
+ *  \return bool true if dimensions and all elements are the same
+ */
+bool BitMatrix::operator==(const BitMatrix& m) const
+{
+    return this->n == m.n && this->words == m.words;
+}
+
+/**
+ *  \brief Elementwise operation of same sized matrices, padding bits stay 0 for all of them
+ *  \param [in] a const BitMatrix& a
+ *  \param [in] b const BitMatrix& b
+ *  \param [in] operation int '|', '&' or '^'
+ *  \return BitMatrix a operation b
+ */
+BitMatrix BitMatrix::combine(const BitMatrix& a, const BitMatrix& b, int operation)
+{
+    if(a.n != b.n)
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    BitMatrix result(a);
+    uint64_t* target = result.words.data();
+    const uint64_t* source = b.words.data();
+    for(size_t w = 0; w < result.words.size(); w++)
+    {
+        target[w] = operation == '|' ? target[w] | source[w] : operation == '&' ? target[w] & source[w] : target[w] ^ source[w];
+    }
+    return result;
+}
+
+/**
+ *  \brief Elementwise OR, Boolean sum
+ *  \param [in] a const BitMatrix&
+ *  \param [in] b const BitMatrix&
+ *  \return a OR b
+ */
+BitMatrix operator|(const BitMatrix& a, const BitMatrix& b)
+{
+    return BitMatrix::combine(a, b, '|');
+}
+
+/**
+ *  \brief Elementwise AND
+ *  \param [in] a const BitMatrix&
+ *  \param [in] b const BitMatrix&
+ *  \return a AND b
+ */
+BitMatrix operator&(const BitMatrix& a, const BitMatrix& b)
+{
+    return BitMatrix::combine(a, b, '&');
+}
+
+/**
+ *  \brief Elementwise XOR, sum over GF(2)
+ *  \param [in] a const BitMatrix&
+ *  \param [in] b const BitMatrix&
+ *  \return a XOR b
+ */
+BitMatrix operator^(const BitMatrix& a, const BitMatrix& b)
+{
+    return BitMatrix::combine(a, b, '^');
+}
+
+/**
+ *  \brief Boolean product, element ij is 1 if a path i->k->j exists
+ *  \param [in] a const BitMatrix&
+ *  \param [in] b const BitMatrix&
+ *  \return BitMatrix Boolean dot-product of a and b
+ */
+BitMatrix operator*(const BitMatrix& a, const BitMatrix& b)
+{
+    return BitMatrix::multiply(a, b, BitMatrix::Boolean);
+}
+
+/**
+ *  \brief Write object to stream in form of [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \param [in,out] stream std::ostream&
+ *  \param [in] m const BitMatrix& m
+ *  \return stream appended by object
+ */
+std::ostream& operator<<(std::ostream& stream, const BitMatrix& m)
+{
+	stream << "[";
+    for(int i = 0; i < m.n; i++)
+    {
+        stream << "[";
+        for(int j = 0; j < m.n; j++)
+        {
+            if(j != 0)
+            {
+                stream << ",";
+            }
+            stream << m.getElement(i, j);
+        }
+        stream << "]";
+    }
+    stream << "]";
+
+    return stream;
+}
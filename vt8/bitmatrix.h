@@ -0,0 +1,65 @@
+#ifndef BITMATRIX_H
+#define BITMATRIX_H
+
+#include "squarematrix.h"
+#include "squarematrixview.h"
+
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+/**
+ * @file bitmatrix.h
+ * @version 1.0
+ * @brief Declaration of BitMatrix
+ * @author Niko Lehto
+ */
+class BitMatrix
+{
+public:
+    enum Algebra
+    {
+        Boolean, ///< sum is OR and product is AND, paths in graphs
+        GF2      ///< sum is XOR and product is AND, arithmetic modulo 2
+    };
+
+    static const size_t tableBits = 8;   ///< rows of right-hand side combined into one Four-Russians table
+    static const size_t blockRows = 512; ///< rows of result updated from one table before it is rebuilt
+    static const size_t blockWords = 16; ///< words of result row covered by one table
+
+private:
+	int n = 0;
+	size_t wordsPerRow = 0;
+	std::vector<uint64_t> words; // rows of wordsPerRow words, bit j%64 of word j/64 is column j, padding bits are 0
+
+	uint64_t* row(size_t i);
+	const uint64_t* row(size_t i) const;
+	unsigned int chunk(size_t i, size_t column) const;
+	static BitMatrix combine(const BitMatrix& a, const BitMatrix& b, int operation);
+
+public:
+	BitMatrix();
+	explicit BitMatrix(int n);
+	BitMatrix(const SquareMatrixView& m);
+	~BitMatrix();
+
+	static BitMatrix identity(int n);
+	static BitMatrix multiply(const BitMatrix& a, const BitMatrix& b, Algebra algebra);
+
+	int getDimension() const;
+	size_t getStorageBytes() const;
+	bool getElement(size_t row, size_t col) const;
+	void setElement(size_t row, size_t col, bool value);
+	size_t count() const;
+	size_t countRow(size_t row) const;
+	SquareMatrix toSquareMatrix() const;
+	std::string toString() const;
+
+	bool operator==(const BitMatrix& m) const;
+	friend BitMatrix operator|(const BitMatrix& a, const BitMatrix& b);
+	friend BitMatrix operator&(const BitMatrix& a, const BitMatrix& b);
+	friend BitMatrix operator^(const BitMatrix& a, const BitMatrix& b);
+	friend BitMatrix operator*(const BitMatrix& a, const BitMatrix& b);
+	friend std::ostream& operator<<(std::ostream& stream, const BitMatrix& m);
+};
+#endif
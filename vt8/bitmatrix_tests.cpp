@@ -0,0 +1,77 @@
+#include "catch.hpp"
+#include "bitmatrix.h"
+
+/**
+ *  @file bitmatrix_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for BitMatrix class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for BitMatrix, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("BitMatrix", "[BitMatrix]")
+{
+    SquareMatrix path("[[0,1,0,0][0,0,1,0][0,0,0,1][0,0,0,0]]");
+    BitMatrix p(path);
+    REQUIRE(p.getDimension() == 4);
+    REQUIRE(p.count() == 3);
+    REQUIRE(p.countRow(3) == 0);
+    REQUIRE(p.getElement(0, 1));
+    REQUIRE_FALSE(p.getElement(1, 0));
+    REQUIRE(p.toSquareMatrix() == path);
+    REQUIRE(p.toString() == path.toString());
+    REQUIRE(BitMatrix(SquareMatrix("[[5,0][-1,0]]")).toString() == "[[1,0][1,0]]");
+    REQUIRE((p * p).toSquareMatrix() == SquareMatrix("[[0,0,1,0][0,0,0,1][0,0,0,0][0,0,0,0]]"));
+    REQUIRE(p * BitMatrix::identity(4) == p);
+
+    // two paths 0->1->3 and 0->2->3 give 1 as Boolean sum and 0 over GF(2)
+    SquareMatrix diamond("[[0,1,1,0][0,0,0,1][0,0,0,1][0,0,0,0]]");
+    BitMatrix d(diamond);
+    REQUIRE((d * d).getElement(0, 3));
+    REQUIRE_FALSE(BitMatrix::multiply(d, d, BitMatrix::GF2).getElement(0, 3));
+    REQUIRE((d | p).count() == 5);
+    REQUIRE((d & p).count() == 2);
+    REQUIRE((d ^ p).count() == 3);
+
+    // sizes around word, table and block boundaries against dense products
+    for(int n : {1, 7, 63, 64, 65, 130, 600})
+    {
+        SquareMatrix a(n), b(n);
+        for(int i = 0; i < n; i++)
+        {
+            for(int j = 0; j < n; j++)
+            {
+                a.setElement(i, j, IntElement((i * 31 + j * 17) % 11 < 2 ? 1 : 0));
+                b.setElement(i, j, IntElement((i * 7 + j * 13) % 5 == 0 ? 1 : 0));
+            }
+        }
+        SquareMatrix dense = a * b;
+        SquareMatrix boolean(n), parity(n);
+        for(int i = 0; i < n; i++)
+        {
+            for(int j = 0; j < n; j++)
+            {
+                int value = dense.getElement(i, j).getVal();
+                boolean.setElement(i, j, IntElement(value != 0 ? 1 : 0));
+                parity.setElement(i, j, IntElement(value % 2));
+            }
+        }
+
+        BitMatrix ba(a), bb(b);
+        REQUIRE((ba * bb).toSquareMatrix() == boolean);
+        REQUIRE(BitMatrix::multiply(ba, bb, BitMatrix::GF2).toSquareMatrix() == parity);
+        REQUIRE(ba.getStorageBytes() == static_cast<size_t>(n) * ((n + 63) / 64) * 8);
+    }
+
+    BitMatrix e(4);
+    e.setElement(3, 2, true);
+    REQUIRE(e.getElement(3, 2));
+    e.setElement(3, 2, false);
+    REQUIRE(e == BitMatrix(4));
+    REQUIRE_THROWS_AS(e.getElement(4, 0), std::out_of_range);
+    REQUIRE_THROWS_WITH(e * BitMatrix(5), "operator requires same sized matrices");
+    REQUIRE_THROWS_WITH(e | BitMatrix(5), "operator requires same sized matrices");
+}
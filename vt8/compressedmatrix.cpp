@@ -0,0 +1,542 @@
+#include "compressedmatrix.h"
+#include "gemmkernel.h"
+#include "tuning.h"
+
+/**
+ *  @file compressedmatrix.cpp
+ *  @brief Implementation of CompressedMatrix
+ *  */
+
+ /**
+ *  @class CompressedMatrix
+ *  @version 1.0
+ *  @brief Read-only nxn matrix compressed with frame-of-reference bit-packing. Each row is split into blocks of
+ *      128 elements, a block stores its minimum and the offsets from it with as few bits as the largest offset needs.
+ *      Offsets are interleaved in 4 lanes so that unpacking is the same shift and mask for every lane and
+ *      vectorizes. Arithmetic unpacks one block at a time into a small buffer right before using it,
+ *      products one tile of blockSize x blockSize at a time, so the full matrix is never decompressed. Small matrices do not gain anything since every row takes
+ *      at least one whole block
+ *  @author Niko Lehto
+ *  */
+
+const size_t CompressedMatrix::blockSize;
+const size_t CompressedMatrix::lanes;
+
+/**
+ *  \brief Empty constructor, 0x0 matrix
+ */
+CompressedMatrix::CompressedMatrix() = default;
+
+/**
+ *  \brief Compresses a dense matrix
+ *  \param [in] m const SquareMatrixView& matrix to compress
+ */
+CompressedMatrix::CompressedMatrix(const SquareMatrixView& m)
+{
+    this->n = m.getDimension();
+    this->blocksPerRow = (n + blockSize - 1) / blockSize;
+    this->blocks.resize(blocksPerRow * n);
+
+    // first pass finds frame and width of every block to know where blocks start
+    SquareMatrix::runParallel(n, n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const int* row = m.row(i);
+            for(size_t b = 0; b < blocksPerRow; b++)
+            {
+                const int* first = row + b * blockSize;
+                const int* last = row + std::min((b + 1) * blockSize, static_cast<size_t>(n));
+                auto range = std::minmax_element(first, last);
+                uint32_t span = static_cast<uint32_t>(*range.second) - static_cast<uint32_t>(*range.first);
+
+                Block& block = blocks[i * blocksPerRow + b];
+                block.min = *range.first;
+                block.width = 0;
+                while(block.width < 32 && (span >> block.width) != 0)
+                {
+                    block.width++;
+                }
+            }
+        }
+    });
+
+    size_t offset = 0;
+    for(Block& block : blocks)
+    {
+        block.offset = offset;
+        offset += lanes * block.width;
+    }
+    this->words.assign(offset, 0);
+
+    SquareMatrix::runParallel(n, n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            for(size_t b = 0; b < blocksPerRow; b++)
+            {
+                size_t first = b * blockSize;
+                pack(i * blocksPerRow + b, m.row(i) + first, std::min(blockSize, n - first));
+            }
+        }
+    });
+}
+
+/**
+ *  \brief Destructor
+ */
+CompressedMatrix::~CompressedMatrix() = default;
+
+/**
+ *  \brief Bit-packs values into their block. Missing values of last block of a row are packed as zero offsets
+ *  \param [in] index size_t index of block in blocks
+ *  \param [in] values const int* values of block
+ *  \param [in] count size_t number of values, at most blockSize
+ */
+void CompressedMatrix::pack(size_t index, const int* values, size_t count)
+{
+    const Block& block = blocks[index];
+    uint32_t* target = words.data() + block.offset;
+    unsigned int width = block.width;
+
+    if(width == 0)
+    {
+        return;
+    }
+
+    for(size_t e = 0; e < count; e++)
+    {
+        uint32_t value = static_cast<uint32_t>(values[e]) - static_cast<uint32_t>(block.min);
+        size_t lane = e % lanes;
+        size_t bit = (e / lanes) * width;
+        size_t word = bit / 32;
+        unsigned int shift = bit % 32;
+
+        target[word * lanes + lane] |= value << shift;
+        if(shift + width > 32)
+        {
+            target[(word + 1) * lanes + lane] |= value >> (32 - shift);
+        }
+    }
+}
+
+/**
+ *  \brief Unpacks all blockSize values of a block. All lanes use same shifts, so inner loop vectorizes
+ *  \param [in] block const Block& block to unpack
+ *  \param [in] words const uint32_t* packed words of all blocks
+ *  \param [out] values int* blockSize values
+ */
+void CompressedMatrix::unpack(const Block& block, const uint32_t* words, int* values)
+{
+    unsigned int width = block.width;
+    uint32_t min = static_cast<uint32_t>(block.min);
+
+    if(width == 0)
+    {
+        std::fill(values, values + blockSize, block.min);
+        return;
+    }
+
+    const uint32_t* source = words + block.offset;
+    uint32_t mask = width == 32 ? 0xFFFFFFFFu : (1u << width) - 1;
+
+    for(size_t k = 0; k < blockSize / lanes; k++)
+    {
+        size_t bit = k * width;
+        const uint32_t* low = source + (bit / 32) * lanes;
+        unsigned int shift = bit % 32;
+
+        if(shift + width > 32)
+        {
+            const uint32_t* high = low + lanes;
+            for(size_t lane = 0; lane < lanes; lane++)
+            {
+                uint32_t value = (low[lane] >> shift) | (high[lane] << (32 - shift));
+                values[k * lanes + lane] = static_cast<int>((value & mask) + min);
+            }
+        }
+        else
+        {
+            for(size_t lane = 0; lane < lanes; lane++)
+            {
+                uint32_t value = low[lane] >> shift;
+                values[k * lanes + lane] = static_cast<int>((value & mask) + min);
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Unpacks a whole row
+ *  \param [in] row size_t row index, not checked
+ *  \param [out] target int* n values
+ */
+void CompressedMatrix::unpackRow(size_t row, int* target) const
+{
+    int values[blockSize];
+    for(size_t b = 0; b < blocksPerRow; b++)
+    {
+        size_t first = b * blockSize;
+        unpack(blocks[row * blocksPerRow + b], words.data(), values);
+        std::copy(values, values + std::min(blockSize, n - first), target + first);
+    }
+}
+
+/**
+ *  \brief Gives row of either operand type. Compressed rows are unpacked into scratch
+ *  \param [in] compressed const CompressedMatrix* compressed operand or nullptr
+ *  \param [in] dense const SquareMatrixView& dense operand, used if compressed is nullptr
+ *  \param [in] row size_t row index
+ *  \param [in] scratch int* buffer for n values
+ *  \return const int* values of the row
+ */
+const int* CompressedMatrix::rowOf(const CompressedMatrix* compressed, const SquareMatrixView& dense, size_t row, int* scratch)
+{
+    if(compressed == nullptr)
+    {
+        return dense.row(row);
+    }
+    compressed->unpackRow(row, scratch);
+    return scratch;
+}
+
+/**
+ *  \brief Getter for dimension
+ *  \return int dimension n of nxn matrix
+ */
+int CompressedMatrix::getDimension() const
+{
+    return this->n;
+}
+
+/**
+ *  \brief Getter for memory used by elements
+ *  \return size_t bytes used by packed words and block headers
+ */
+size_t CompressedMatrix::getStorageBytes() const
+{
+    return words.size() * sizeof(uint32_t) + blocks.size() * sizeof(Block);
+}
+
+/**
+ *  \brief Getter for widest block
+ *  \return unsigned int largest number of bits used for one element
+ */
+unsigned int CompressedMatrix::getMaxWidth() const
+{
+    unsigned int width = 0;
+    for(const Block& block : blocks)
+    {
+        width = std::max(width, block.width);
+    }
+    return width;
+}
+
+/**
+ *  \brief Getter for single element
+ *  \param [in] row size_t row index starting from 0
+ *  \param [in] col size_t column index starting from 0
+ *  \return IntElement element at row, col
+ */
+IntElement CompressedMatrix::getElement(size_t row, size_t col) const
+{
+    if(row >= static_cast<size_t>(n) || col >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    int values[blockSize];
+    unpack(blocks[row * blocksPerRow + col / blockSize], words.data(), values);
+    return IntElement(values[col % blockSize]);
+}
+
+/**
+ *  \brief Decompresses into dense matrix
+ *  \return SquareMatrix with all n*n elements
+ */
+SquareMatrix CompressedMatrix::toSquareMatrix() const
+{
+    SquareMatrix dense;
+    dense.allocate(this->n);
+
+    SquareMatrix::runParallel(n, n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            unpackRow(i, dense.elements.get() + i * n);
+        }
+    });
+
+    return dense;
+}
+
+/**
+ *  \brief Write object to string in form of [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \return std::string object as a string
+ */
+std::string CompressedMatrix::toString() const
+{
+	std::stringstream result;
+	result << *this;
+	return result.str();
+}
+
+/**
+ *  \brief Overload of equal comparison
+ *  \param [in] m const CompressedMatrix& value for comparison
+ *  \return bool true if this and m have identical elements
+ */
+bool CompressedMatrix::operator==(const CompressedMatrix& m) const
+{
+    if(this->n != m.n)
+    {
+        return false;
+    }
+
+    std::vector<int> row_this(n), row_m(n);
+    for(int i = 0; i < n; i++)
+    {
+        unpackRow(i, row_this.data());
+        m.unpackRow(i, row_m.data());
+        if(row_this != row_m)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ *  \brief Addition or substraction with compressed left-hand side, unpacked block by block
+ *  \param [in] a const CompressedMatrix& left-hand side
+ *  \param [in] compressed const CompressedMatrix* compressed right-hand side or nullptr
+ *  \param [in] dense const SquareMatrixView& dense right-hand side, used if compressed is nullptr
+ *  \param [in] add bool true for addition, false for substraction
+ *  \return SquareMatrix result
+ */
+SquareMatrix CompressedMatrix::combine(const CompressedMatrix& a, const CompressedMatrix* compressed, const SquareMatrixView& dense, bool add)
+{
+    int b_n = compressed != nullptr ? compressed->n : dense.getDimension();
+    if(a.n != b_n)
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    size_t t_n = a.n;
+    SquareMatrix result;
+    result.allocate(a.n);
+
+    SquareMatrix::runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        int values[blockSize];
+        std::vector<int> scratch(compressed != nullptr ? t_n : 0);
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const int* source = rowOf(compressed, dense, i, scratch.data());
+            int* target = result.elements.get() + i * t_n;
+            for(size_t b = 0; b < a.blocksPerRow; b++)
+            {
+                size_t first = b * blockSize;
+                size_t count = std::min(blockSize, t_n - first);
+                unpack(a.blocks[i * a.blocksPerRow + b], a.words.data(), values);
+                for(size_t j = 0; j < count; j++)
+                {
+                    target[first + j] = add ? values[j] + source[first + j] : values[j] - source[first + j];
+                }
+            }
+        }
+    });
+
+    return result;
+}
+
+/**
+ *  \brief Unpacks rows [row, row+rows) x columns [column, column+blockSize) of either operand type into a tile,
+ *      elements outside the rows or the matrix are zero
+ *  \param [in] compressed const CompressedMatrix* compressed operand or nullptr
+ *  \param [in] dense const SquareMatrixView& dense operand, used if compressed is nullptr
+ *  \param [in] row size_t first row
+ *  \param [in] rows size_t number of rows, at most blockSize
+ *  \param [in] column size_t first column, multiple of blockSize
+ *  \param [out] tile SquareMatrix& blockSize x blockSize tile with storage of its own
+ */
+void CompressedMatrix::tileOf(const CompressedMatrix* compressed, const SquareMatrixView& dense, size_t row, size_t rows, size_t column, SquareMatrix& tile)
+{
+    size_t t_n = compressed != nullptr ? compressed->n : dense.getDimension();
+    size_t count = std::min(blockSize, t_n - column);
+    int* target = tile.elements.get();
+    for(size_t r = 0; r < blockSize; r++, target += blockSize)
+    {
+        if(r >= rows)
+        {
+            std::fill(target, target + blockSize, 0);
+            continue;
+        }
+        if(compressed != nullptr)
+        {
+            unpack(compressed->blocks[(row + r) * compressed->blocksPerRow + column / blockSize], compressed->words.data(), target);
+        }
+        else
+        {
+            std::copy(dense.row(row + r) + column, dense.row(row + r) + column + count, target);
+        }
+        std::fill(target + count, target + blockSize, 0);
+    }
+}
+
+/**
+ *  \brief Dot-product with compressed left-hand side in tiles of blockSize. A worker unpacks the depth block of the
+ *      right-hand side once into a panel of tiles, then every tile of its rows of a once, and multiplies them with
+ *      GemmKernel like the dense operator*
+ *  \param [in] a const CompressedMatrix& left-hand side
+ *  \param [in] compressed const CompressedMatrix* compressed right-hand side or nullptr
+ *  \param [in] dense const SquareMatrixView& dense right-hand side, used if compressed is nullptr
+ *  \return SquareMatrix dot-product
+ */
+SquareMatrix CompressedMatrix::multiply(const CompressedMatrix& a, const CompressedMatrix* compressed, const SquareMatrixView& dense)
+{
+    int b_n = compressed != nullptr ? compressed->n : dense.getDimension();
+    if(a.n != b_n)
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    size_t t_n = a.n;
+    SquareMatrix result;
+    result.allocate(a.n);
+    Tuning::Profile tuning = Tuning::getProfile();
+
+    SquareMatrix::runParallel(t_n, t_n * t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        int* first = result.elements.get() + worker_start * t_n;
+        std::fill(first, first + (worker_stop - worker_start) * t_n, 0);
+
+        SquareMatrix left;
+        left.allocate(static_cast<int>(blockSize));
+        std::vector<SquareMatrix> panel(a.blocksPerRow);
+        for(SquareMatrix& tile : panel)
+        {
+            tile.allocate(static_cast<int>(blockSize));
+        }
+
+        for(size_t depth = 0; depth < t_n; depth += blockSize)
+        {
+            size_t depths = std::min(blockSize, t_n - depth);
+            for(size_t b = 0; b < a.blocksPerRow; b++)
+            {
+                tileOf(compressed, dense, depth, depths, b * blockSize, panel[b]);
+            }
+
+            for(size_t i = worker_start; i < worker_stop; i += blockSize)
+            {
+                size_t rows = std::min(blockSize, worker_stop - i);
+                tileOf(&a, SquareMatrixView(), i, rows, depth, left);
+                for(size_t b = 0; b < a.blocksPerRow; b++)
+                {
+                    size_t columns = std::min(blockSize, t_n - b * blockSize);
+                    GemmKernel::Path path = GemmKernel::choosePath(left, panel[b], tuning);
+                    GemmKernel::multiply(0, rows, 0, columns, 1, left, panel[b], result.elements.get() + i * t_n + b * blockSize, t_n, tuning, path);
+                }
+            }
+        }
+    });
+
+    return result;
+}
+
+/**
+ *  \brief Addition of compressed and dense matrix
+ *  \param [in] a const CompressedMatrix&
+ *  \param [in] b const SquareMatrixView&
+ *  \return Addition of a and b
+ */
+SquareMatrix operator+(const CompressedMatrix& a, const SquareMatrixView& b)
+{
+    return CompressedMatrix::combine(a, nullptr, b, true);
+}
+
+/**
+ *  \brief Addition of two compressed matrices
+ *  \param [in] a const CompressedMatrix&
+ *  \param [in] b const CompressedMatrix&
+ *  \return Addition of a and b
+ */
+SquareMatrix operator+(const CompressedMatrix& a, const CompressedMatrix& b)
+{
+    return CompressedMatrix::combine(a, &b, SquareMatrixView(), true);
+}
+
+/**
+ *  \brief Substraction of dense matrix from compressed matrix
+ *  \param [in] a const CompressedMatrix&
+ *  \param [in] b const SquareMatrixView&
+ *  \return Substraction of a and b
+ */
+SquareMatrix operator-(const CompressedMatrix& a, const SquareMatrixView& b)
+{
+    return CompressedMatrix::combine(a, nullptr, b, false);
+}
+
+/**
+ *  \brief Substraction of two compressed matrices
+ *  \param [in] a const CompressedMatrix&
+ *  \param [in] b const CompressedMatrix&
+ *  \return Substraction of a and b
+ */
+SquareMatrix operator-(const CompressedMatrix& a, const CompressedMatrix& b)
+{
+    return CompressedMatrix::combine(a, &b, SquareMatrixView(), false);
+}
+
+/**
+ *  \brief Dot-product of compressed and dense matrix
+ *  \param [in] a const CompressedMatrix&
+ *  \param [in] b const SquareMatrixView&
+ *  \return Dot-product of a and b
+ */
+SquareMatrix operator*(const CompressedMatrix& a, const SquareMatrixView& b)
+{
+    return CompressedMatrix::multiply(a, nullptr, b);
+}
+
+/**
+ *  \brief Dot-product of two compressed matrices
+ *  \param [in] a const CompressedMatrix&
+ *  \param [in] b const CompressedMatrix&
+ *  \return Dot-product of a and b
+ */
+SquareMatrix operator*(const CompressedMatrix& a, const CompressedMatrix& b)
+{
+    return CompressedMatrix::multiply(a, &b, SquareMatrixView());
+}
+
+/**
+ *  \brief Write object to stream in form of [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \param [in,out] stream std::ostream&
+ *  \param [in] m const CompressedMatrix& m
+ *  \return stream appended by object
+ */
+std::ostream& operator<<(std::ostream& stream, const CompressedMatrix& m)
+{
+    std::vector<int> row(m.n);
+	stream << "[";
+    for(int i = 0; i < m.n; i++)
+    {
+        m.unpackRow(i, row.data());
+        stream << "[";
+        for(int ind = 0; ind < m.n; ind++)
+        {
+            if(ind != m.n - 1)
+            {
+                stream << row[ind] << ",";
+            }
+            else
+            {
+                stream << row[ind];
+            }
+        }
+        stream << "]";
+    }
+    stream << "]";
+
+    return stream;
+}
@@ -0,0 +1,66 @@
+#ifndef COMPRESSEDMATRIX_H
+#define COMPRESSEDMATRIX_H
+
+#include "intelement.h"
+#include "squarematrix.h"
+#include "squarematrixview.h"
+
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+/**
+ * @file compressedmatrix.h
+ * @version 1.0
+ * @brief Declaration of CompressedMatrix
+ * @author Niko Lehto
+ */
+class CompressedMatrix
+{
+public:
+    static const size_t blockSize = 128; ///< elements per block, 4 lanes of 32 values
+    static const size_t lanes = 4;
+
+private:
+    struct Block
+    {
+        int min;           ///< frame of reference, smallest value in block
+        unsigned int width; ///< bits per value after substracting min, 0-32
+        size_t offset;     ///< first word of block in words
+    };
+
+	int n = 0;
+	size_t blocksPerRow = 0;
+	std::vector<Block> blocks;   // blocksPerRow blocks for each row
+	std::vector<uint32_t> words; // bit-packed values of all blocks
+
+	void pack(size_t index, const int* values, size_t count);
+	static void unpack(const Block& block, const uint32_t* words, int* values);
+	static const int* rowOf(const CompressedMatrix* compressed, const SquareMatrixView& dense, size_t row, int* scratch);
+	static void tileOf(const CompressedMatrix* compressed, const SquareMatrixView& dense, size_t row, size_t rows, size_t column, SquareMatrix& tile);
+	static SquareMatrix combine(const CompressedMatrix& a, const CompressedMatrix* compressed, const SquareMatrixView& dense, bool add);
+	static SquareMatrix multiply(const CompressedMatrix& a, const CompressedMatrix* compressed, const SquareMatrixView& dense);
+
+public:
+	CompressedMatrix();
+	CompressedMatrix(const SquareMatrixView& m);
+	~CompressedMatrix();
+
+	int getDimension() const;
+	size_t getStorageBytes() const;
+	unsigned int getMaxWidth() const;
+	IntElement getElement(size_t row, size_t col) const;
+	void unpackRow(size_t row, int* target) const;
+	SquareMatrix toSquareMatrix() const;
+	std::string toString() const;
+
+	bool operator==(const CompressedMatrix& m) const;
+	friend SquareMatrix operator+(const CompressedMatrix& a, const SquareMatrixView& b);
+	friend SquareMatrix operator+(const CompressedMatrix& a, const CompressedMatrix& b);
+	friend SquareMatrix operator-(const CompressedMatrix& a, const SquareMatrixView& b);
+	friend SquareMatrix operator-(const CompressedMatrix& a, const CompressedMatrix& b);
+	friend SquareMatrix operator*(const CompressedMatrix& a, const SquareMatrixView& b);
+	friend SquareMatrix operator*(const CompressedMatrix& a, const CompressedMatrix& b);
+	friend std::ostream& operator<<(std::ostream& stream, const CompressedMatrix& m);
+};
+#endif
@@ -0,0 +1,63 @@
+#include "catch.hpp"
+#include "compressedmatrix.h"
+
+/**
+ *  @file compressedmatrix_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for CompressedMatrix class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for CompressedMatrix, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("CompressedMatrix", "[CompressedMatrix]")
+{
+    SquareMatrix small("[[1,-2,3][4,5,-6][7,-2147483648,2147483647]]");
+    CompressedMatrix c_small(small);
+    REQUIRE(c_small.toSquareMatrix() == small);
+    REQUIRE(c_small.toString() == small.toString());
+    REQUIRE(c_small.getElement(2, 2) == IntElement(2147483647));
+    REQUIRE(c_small.getMaxWidth() == 32);
+    REQUIRE_THROWS_AS(c_small.getElement(0, 3), std::out_of_range);
+
+    // 300x300 matrix with values in [-8, 7] needs 4 bits per value
+    size_t n = 300;
+    SquareMatrix a(static_cast<int>(n)), b(static_cast<int>(n));
+    for(size_t i = 0; i < n; i++)
+    {
+        for(size_t j = 0; j < n; j++)
+        {
+            a.setElement(i, j, IntElement(static_cast<int>((i * 7 + j * 3) % 16) - 8));
+            b.setElement(i, j, IntElement(static_cast<int>((i + j * 5) % 9)));
+        }
+    }
+
+    CompressedMatrix ca(a), cb(b);
+    REQUIRE(ca.getMaxWidth() == 4);
+    REQUIRE(ca.getStorageBytes() < n * n);
+    REQUIRE(ca.toSquareMatrix() == a);
+    REQUIRE(ca.getElement(299, 131) == a.getElement(299, 131));
+    REQUIRE(ca == CompressedMatrix(a));
+    REQUIRE_FALSE(ca == cb);
+
+    REQUIRE(ca + b == a + b);
+    REQUIRE(ca + cb == a + b);
+    REQUIRE(ca - b == a - b);
+    REQUIRE(ca - cb == a - b);
+    REQUIRE(ca * b == a * b);
+    REQUIRE(ca * cb == a * b);
+    REQUIRE(ca * b.block(0, 0, 300) == a * b);
+
+    // full range values take the 32-bit kernel, sizes around tile edges
+    for(int size : {1, 127, 129, 260})
+    {
+        SquareMatrix x(size), y(size);
+        CompressedMatrix cx(x), cy(y);
+        REQUIRE(cx * cy == x * y);
+        REQUIRE(cx * y == x * y);
+    }
+    REQUIRE_THROWS_WITH(ca + small, "operator requires same sized matrices");
+    REQUIRE_THROWS_WITH(ca * c_small, "operator requires same sized matrices");
+}
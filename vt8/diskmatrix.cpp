@@ -0,0 +1,591 @@
+#include "diskmatrix.h"
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ *  @file diskmatrix.cpp
+ *  @brief Implementation of DiskMatrix
+ *  */
+
+ /**
+ *  @class DiskMatrix
+ *  @version 1.0
+ *  @brief Out-of-core nxn matrix stored in a file as square tiles. Operations read tiles with pread into pooled
+ *      SquareMatrix tiles, compute them with the normal in-memory operators and write results to a new file.
+ *      The tiles of the next step are read by a background task while the current ones are computed, and the
+ *      number of tiles held at once is checked against a process wide memory budget.
+ *      File layout: 4 KiB header with magic "SQMT", tile size and n, then tiles in row-major tile order.
+ *      Edge tiles are stored full size and padded with zeros
+ *  @author Niko Lehto
+ *  */
+
+/**
+ *  \brief Open file of a DiskMatrix, closed when last DiskMatrix using it is destroyed
+ */
+struct DiskMatrix::File
+{
+    int fd;
+    std::string path;
+
+    File(const std::string& path, int flags) : path(path)
+    {
+        fd = ::open(path.c_str(), flags, 0644);
+        if(fd < 0)
+        {
+            throw std::runtime_error("Can not open matrix file \"" + path + "\": " + std::strerror(errno));
+        }
+    }
+
+    ~File()
+    {
+        ::close(fd);
+    }
+};
+
+static const size_t headerSize = 4096;
+static const char magic[4] = {'S', 'Q', 'M', 'T'};
+
+/**
+ *  \brief Maximum bytes of tiles an operation may hold in memory, 1 GiB by default
+ */
+std::atomic<size_t> DiskMatrix::memoryBudget(1024 * 1024 * 1024);
+
+/**
+ *  \brief Reads exactly bytes from fd at offset
+ *  \param [in] fd int file descriptor
+ *  \param [out] target void* buffer
+ *  \param [in] bytes size_t number of bytes
+ *  \param [in] offset size_t position in file
+ */
+static void readFully(int fd, void* target, size_t bytes, size_t offset)
+{
+    char* position = static_cast<char*>(target);
+    while(bytes > 0)
+    {
+        ssize_t done = ::pread(fd, position, bytes, offset);
+        if(done < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(done <= 0)
+        {
+            throw std::runtime_error(std::string("Reading matrix file failed: ") + (done < 0 ? std::strerror(errno) : "unexpected end of file"));
+        }
+        position += done;
+        offset += done;
+        bytes -= done;
+    }
+}
+
+/**
+ *  \brief Writes exactly bytes to fd at offset
+ *  \param [in] fd int file descriptor
+ *  \param [in] source const void* buffer
+ *  \param [in] bytes size_t number of bytes
+ *  \param [in] offset size_t position in file
+ */
+static void writeFully(int fd, const void* source, size_t bytes, size_t offset)
+{
+    const char* position = static_cast<const char*>(source);
+    while(bytes > 0)
+    {
+        ssize_t done = ::pwrite(fd, position, bytes, offset);
+        if(done < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(done < 0)
+        {
+            throw std::runtime_error(std::string("Writing matrix file failed: ") + std::strerror(errno));
+        }
+        position += done;
+        offset += done;
+        bytes -= done;
+    }
+}
+
+/**
+ *  \brief Empty constructor, 0x0 matrix without file
+ */
+DiskMatrix::DiskMatrix() = default;
+
+/**
+ *  \brief Opens existing matrix file
+ *  \param [in] path const std::string& file written by create or by an operation
+ */
+DiskMatrix::DiskMatrix(const std::string& path)
+{
+    this->file = std::make_shared<File>(path, O_RDWR);
+
+    char header[16];
+    readFully(file->fd, header, sizeof(header), 0);
+    if(std::memcmp(header, magic, sizeof(magic)) != 0)
+    {
+        throw std::invalid_argument("Not a matrix file: \"" + path + "\"");
+    }
+
+    uint32_t t_tileSize;
+    uint64_t t_n;
+    std::memcpy(&t_tileSize, header + 4, sizeof(t_tileSize));
+    std::memcpy(&t_n, header + 8, sizeof(t_n));
+    if(t_tileSize == 0 || t_n > INT_MAX)
+    {
+        throw std::invalid_argument("Not a matrix file, invalid header: \"" + path + "\"");
+    }
+    this->n = static_cast<int>(t_n);
+    this->tileSize = t_tileSize;
+    this->tiles = (n + tileSize - 1) / tileSize;
+
+    // tiles must all be in the file, size is compared as double so that a huge header can not overflow tileOffset
+    struct stat status;
+    if(::fstat(file->fd, &status) != 0)
+    {
+        throw std::runtime_error("Can not stat matrix file \"" + path + "\": " + std::strerror(errno));
+    }
+    double side = static_cast<double>(tiles) * tileSize;
+    if(headerSize + side * side * sizeof(int) > static_cast<double>(status.st_size))
+    {
+        throw std::invalid_argument("Not a matrix file, too short for its header: \"" + path + "\"");
+    }
+}
+
+/**
+ *  \brief Creates new zero filled matrix file, overwriting existing one
+ *  \param [in] path const std::string& file to create
+ *  \param [in] n int dimension of matrix
+ *  \param [in] tileSize size_t dimension of square tiles
+ */
+DiskMatrix::DiskMatrix(const std::string& path, int n, size_t tileSize)
+{
+    if(n < 0 || tileSize == 0)
+    {
+        throw std::invalid_argument("Matrix dimension can not be negative and tile size must be positive");
+    }
+
+    this->file = std::make_shared<File>(path, O_RDWR | O_CREAT | O_TRUNC);
+    this->n = n;
+    this->tileSize = tileSize;
+    this->tiles = (n + tileSize - 1) / tileSize;
+
+    char header[16] = {};
+    uint32_t t_tileSize = static_cast<uint32_t>(tileSize);
+    uint64_t t_n = static_cast<uint64_t>(n);
+    std::memcpy(header, magic, sizeof(magic));
+    std::memcpy(header + 4, &t_tileSize, sizeof(t_tileSize));
+    std::memcpy(header + 8, &t_n, sizeof(t_n));
+    writeFully(file->fd, header, sizeof(header), 0);
+
+    if(::ftruncate(file->fd, tileOffset(tiles, 0)) != 0) // sparse file, unwritten tiles read as zeros
+    {
+        throw std::runtime_error("Can not resize matrix file \"" + path + "\": " + std::strerror(errno));
+    }
+}
+
+/**
+ *  \brief Destructor, file is closed when last copy is destroyed
+ */
+DiskMatrix::~DiskMatrix() = default;
+
+/**
+ *  \brief Creates new zero filled matrix file, overwriting existing one
+ *  \param [in] path const std::string& file to create
+ *  \param [in] n int dimension of matrix
+ *  \param [in] tileSize size_t dimension of square tiles, see tileSizeForBudget
+ *  \return DiskMatrix the new matrix
+ */
+DiskMatrix DiskMatrix::create(const std::string& path, int n, size_t tileSize)
+{
+    return DiskMatrix(path, n, tileSize);
+}
+
+/**
+ *  \brief Writes in-memory matrix into new matrix file
+ *  \param [in] path const std::string& file to create
+ *  \param [in] m const SquareMatrixView& matrix to store
+ *  \param [in] tileSize size_t dimension of square tiles
+ *  \return DiskMatrix the new matrix
+ */
+DiskMatrix DiskMatrix::fromSquareMatrix(const std::string& path, const SquareMatrixView& m, size_t tileSize)
+{
+    DiskMatrix result(path, m.getDimension(), tileSize);
+    SquareMatrix tile;
+    tile.allocate(static_cast<int>(tileSize));
+
+    for(size_t i = 0; i < result.tiles; i++)
+    {
+        for(size_t j = 0; j < result.tiles; j++)
+        {
+            std::fill(tile.elements.get(), tile.elements.get() + tileSize * tileSize, 0);
+            size_t rows = std::min(tileSize, result.n - i * tileSize);
+            size_t cols = std::min(tileSize, result.n - j * tileSize);
+            for(size_t r = 0; r < rows; r++)
+            {
+                const int* source = m.row(i * tileSize + r) + j * tileSize;
+                std::copy(source, source + cols, tile.elements.get() + r * tileSize);
+            }
+            result.writeTile(i, j, tile);
+        }
+    }
+    return result;
+}
+
+/**
+ *  \brief Largest tile size with which every operation stays inside given budget
+ *  \param [in] bytes size_t memory budget
+ *  \return size_t tile dimension, at least 1
+ */
+size_t DiskMatrix::tileSizeForBudget(size_t bytes)
+{
+    size_t size = static_cast<size_t>(std::sqrt(bytes / (6.0 * sizeof(int))));
+    return std::max(size, static_cast<size_t>(1));
+}
+
+/**
+ *  \brief Sets maximum bytes of tiles an operation may hold in memory
+ *  \param [in] bytes size_t memory budget
+ */
+void DiskMatrix::setMemoryBudget(size_t bytes)
+{
+    memoryBudget = bytes;
+}
+
+/**
+ *  \brief Getter for memory budget
+ *  \return size_t maximum bytes of tiles an operation may hold in memory
+ */
+size_t DiskMatrix::getMemoryBudget()
+{
+    return memoryBudget;
+}
+
+/**
+ *  \brief Position of a tile in file
+ *  \param [in] tileRow size_t tile row
+ *  \param [in] tileCol size_t tile column
+ *  \return size_t byte offset
+ */
+size_t DiskMatrix::tileOffset(size_t tileRow, size_t tileCol) const
+{
+    return headerSize + (tileRow * tiles + tileCol) * tileSize * tileSize * sizeof(int);
+}
+
+/**
+ *  \brief Checks that given number of tiles fits into memory budget
+ *  \param [in] tilesInMemory size_t tiles held at once by operation
+ */
+void DiskMatrix::requireBudget(size_t tilesInMemory) const
+{
+    if(tilesInMemory * tileSize * tileSize * sizeof(int) > memoryBudget)
+    {
+        throw std::invalid_argument("Memory budget too small for tile size");
+    }
+}
+
+/**
+ *  \brief Checks that operands have same dimension and tiling
+ *  \param [in] a const DiskMatrix& first operand
+ *  \param [in] b const DiskMatrix& second operand
+ */
+void DiskMatrix::requireSameLayout(const DiskMatrix& a, const DiskMatrix& b)
+{
+    if(a.n != b.n)
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+    if(a.tileSize != b.tileSize)
+    {
+        throw std::invalid_argument("operator requires same tile size");
+    }
+}
+
+/**
+ *  \brief Checks that result would not overwrite an operand
+ *  \param [in] path const std::string& file for result
+ *  \param [in] a const DiskMatrix& first operand
+ *  \param [in] b const DiskMatrix& second operand
+ */
+void DiskMatrix::requireOtherFile(const std::string& path, const DiskMatrix& a, const DiskMatrix& b)
+{
+    // the result is created with O_TRUNC, so compare files rather than path strings: "./a.bin" or a hard link is a.bin
+    struct stat target;
+    if(::stat(path.c_str(), &target) != 0)
+    {
+        return; // result file does not exist yet
+    }
+    for(const DiskMatrix* operand : {&a, &b})
+    {
+        struct stat source;
+        if(operand->file && ::fstat(operand->file->fd, &source) == 0 && source.st_dev == target.st_dev && source.st_ino == target.st_ino)
+        {
+            throw std::invalid_argument("Result file can not be an operand file");
+        }
+    }
+}
+
+/**
+ *  \brief Getter for dimension
+ *  \return int dimension n of nxn matrix
+ */
+int DiskMatrix::getDimension() const
+{
+    return this->n;
+}
+
+/**
+ *  \brief Getter for tile size
+ *  \return size_t dimension of square tiles
+ */
+size_t DiskMatrix::getTileSize() const
+{
+    return this->tileSize;
+}
+
+/**
+ *  \brief Getter for file path
+ *  \return std::string path of matrix file
+ */
+std::string DiskMatrix::getPath() const
+{
+    return file ? file->path : std::string();
+}
+
+/**
+ *  \brief Reads one tile
+ *  \param [in] tileRow size_t tile row
+ *  \param [in] tileCol size_t tile column
+ *  \return SquareMatrix tileSize x tileSize tile, zero padded on the edges
+ */
+SquareMatrix DiskMatrix::readTile(size_t tileRow, size_t tileCol) const
+{
+    if(tileRow >= tiles || tileCol >= tiles)
+    {
+        throw std::out_of_range("Tile index out of matrix");
+    }
+    SquareMatrix tile;
+    tile.allocate(static_cast<int>(tileSize));
+    readFully(file->fd, tile.elements.get(), tileSize * tileSize * sizeof(int), tileOffset(tileRow, tileCol));
+    return tile;
+}
+
+/**
+ *  \brief Writes one tile
+ *  \param [in] tileRow size_t tile row
+ *  \param [in] tileCol size_t tile column
+ *  \param [in] tile const SquareMatrixView& tileSize x tileSize tile
+ */
+void DiskMatrix::writeTile(size_t tileRow, size_t tileCol, const SquareMatrixView& tile)
+{
+    if(tileRow >= tiles || tileCol >= tiles)
+    {
+        throw std::out_of_range("Tile index out of matrix");
+    }
+    if(static_cast<size_t>(tile.getDimension()) != tileSize)
+    {
+        throw std::invalid_argument("Tile has wrong dimension");
+    }
+
+    size_t offset = tileOffset(tileRow, tileCol);
+    if(tile.getStride() == tileSize)
+    {
+        writeFully(file->fd, tile.row(0), tileSize * tileSize * sizeof(int), offset);
+        return;
+    }
+    for(size_t r = 0; r < tileSize; r++)
+    {
+        writeFully(file->fd, tile.row(r), tileSize * sizeof(int), offset + r * tileSize * sizeof(int));
+    }
+}
+
+/**
+ *  \brief Reads whole matrix into memory
+ *  \return SquareMatrix all n*n elements
+ */
+SquareMatrix DiskMatrix::toSquareMatrix() const
+{
+    SquareMatrix result;
+    result.allocate(this->n);
+
+    for(size_t i = 0; i < tiles; i++)
+    {
+        for(size_t j = 0; j < tiles; j++)
+        {
+            SquareMatrix tile = readTile(i, j);
+            size_t rows = std::min(tileSize, n - i * tileSize);
+            size_t cols = std::min(tileSize, n - j * tileSize);
+            for(size_t r = 0; r < rows; r++)
+            {
+                const int* source = tile.elements.get() + r * tileSize;
+                std::copy(source, source + cols, result.elements.get() + (i * tileSize + r) * n + j * tileSize);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ *  \brief Tile by tile addition or substraction, next pair of tiles is read while current is computed
+ *  \param [in] a const DiskMatrix& left-hand side
+ *  \param [in] b const DiskMatrix& right-hand side
+ *  \param [in] path const std::string& file for result
+ *  \param [in] add bool true for addition, false for substraction
+ *  \return DiskMatrix result
+ */
+DiskMatrix DiskMatrix::combine(const DiskMatrix& a, const DiskMatrix& b, const std::string& path, bool add)
+{
+    requireSameLayout(a, b);
+    requireOtherFile(path, a, b);
+    a.requireBudget(4); // current and prefetched pair
+
+    DiskMatrix result(path, a.n, a.tileSize);
+    size_t count = a.tiles * a.tiles;
+    auto load = [&](size_t tile)
+    {
+        return std::make_pair(a.readTile(tile / a.tiles, tile % a.tiles), b.readTile(tile / a.tiles, tile % a.tiles));
+    };
+
+    std::future<std::pair<SquareMatrix, SquareMatrix>> next;
+    if(count > 0)
+    {
+        next = std::async(std::launch::async, load, 0);
+    }
+    for(size_t tile = 0; tile < count; tile++)
+    {
+        std::pair<SquareMatrix, SquareMatrix> operands = next.get();
+        if(tile + 1 < count)
+        {
+            next = std::async(std::launch::async, load, tile + 1);
+        }
+
+        if(add)
+        {
+            operands.first += operands.second;
+        }
+        else
+        {
+            operands.first -= operands.second;
+        }
+        result.writeTile(tile / a.tiles, tile % a.tiles, operands.first);
+    }
+    return result;
+}
+
+/**
+ *  \brief Out-of-core addition
+ *  \param [in] a const DiskMatrix& left-hand side
+ *  \param [in] b const DiskMatrix& right-hand side with same tile size
+ *  \param [in] path const std::string& file for result
+ *  \return DiskMatrix addition of a and b
+ */
+DiskMatrix DiskMatrix::add(const DiskMatrix& a, const DiskMatrix& b, const std::string& path)
+{
+    return combine(a, b, path, true);
+}
+
+/**
+ *  \brief Out-of-core substraction
+ *  \param [in] a const DiskMatrix& left-hand side
+ *  \param [in] b const DiskMatrix& right-hand side with same tile size
+ *  \param [in] path const std::string& file for result
+ *  \return DiskMatrix substraction of a and b
+ */
+DiskMatrix DiskMatrix::substract(const DiskMatrix& a, const DiskMatrix& b, const std::string& path)
+{
+    return combine(a, b, path, false);
+}
+
+/**
+ *  \brief Out-of-core dot-product. Each result tile sums products of a tile row of a and a tile column of b,
+ *      the next pair of operand tiles is read while current pair is multiplied
+ *  \param [in] a const DiskMatrix& left-hand side
+ *  \param [in] b const DiskMatrix& right-hand side with same tile size
+ *  \param [in] path const std::string& file for result
+ *  \return DiskMatrix dot-product of a and b
+ */
+DiskMatrix DiskMatrix::multiply(const DiskMatrix& a, const DiskMatrix& b, const std::string& path)
+{
+    requireSameLayout(a, b);
+    requireOtherFile(path, a, b);
+    a.requireBudget(6); // current and prefetched pair, product and sum
+
+    DiskMatrix result(path, a.n, a.tileSize);
+    size_t t = a.tiles;
+    size_t steps = t * t * t; // step s multiplies a(i,k) and b(k,j) for i = s / t^2, j = s / t % t, k = s % t
+    auto load = [&](size_t step)
+    {
+        size_t i = step / (t * t), j = step / t % t, k = step % t;
+        return std::make_pair(a.readTile(i, k), b.readTile(k, j));
+    };
+
+    std::future<std::pair<SquareMatrix, SquareMatrix>> next;
+    if(steps > 0)
+    {
+        next = std::async(std::launch::async, load, 0);
+    }
+    SquareMatrix sum;
+    for(size_t step = 0; step < steps; step++)
+    {
+        std::pair<SquareMatrix, SquareMatrix> operands = next.get();
+        if(step + 1 < steps)
+        {
+            next = std::async(std::launch::async, load, step + 1);
+        }
+
+        if(step % t == 0)
+        {
+            sum = operands.first * operands.second;
+        }
+        else
+        {
+            sum += operands.first * operands.second;
+        }
+
+        if(step % t == t - 1)
+        {
+            result.writeTile(step / (t * t), step / t % t, sum);
+        }
+    }
+    return result;
+}
+
+/**
+ *  \brief Out-of-core transpose, tile (i, j) of result is transposed tile (j, i) of a
+ *  \param [in] a const DiskMatrix& matrix to transpose
+ *  \param [in] path const std::string& file for result
+ *  \return DiskMatrix transpose of a
+ */
+DiskMatrix DiskMatrix::transpose(const DiskMatrix& a, const std::string& path)
+{
+    requireOtherFile(path, a, a);
+    a.requireBudget(3); // current and prefetched tile, transposed tile
+
+    DiskMatrix result(path, a.n, a.tileSize);
+    size_t count = a.tiles * a.tiles;
+    auto load = [&](size_t tile)
+    {
+        return a.readTile(tile % a.tiles, tile / a.tiles);
+    };
+
+    std::future<SquareMatrix> next;
+    if(count > 0)
+    {
+        next = std::async(std::launch::async, load, 0);
+    }
+    for(size_t tile = 0; tile < count; tile++)
+    {
+        SquareMatrix source = next.get();
+        if(tile + 1 < count)
+        {
+            next = std::async(std::launch::async, load, tile + 1);
+        }
+        result.writeTile(tile / a.tiles, tile % a.tiles, source.transpose());
+    }
+    return result;
+}
@@ -0,0 +1,59 @@
+#ifndef DISKMATRIX_H
+#define DISKMATRIX_H
+
+#include "squarematrix.h"
+#include "squarematrixview.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @file diskmatrix.h
+ * @version 1.0
+ * @brief Declaration of DiskMatrix
+ * @author Niko Lehto
+ */
+class DiskMatrix
+{
+private:
+    struct File;
+
+	std::shared_ptr<File> file;
+	int n = 0;
+	size_t tileSize = 0;
+	size_t tiles = 0; // tiles per row and column
+	static std::atomic<size_t> memoryBudget;
+
+	DiskMatrix(const std::string& path, int n, size_t tileSize);
+	size_t tileOffset(size_t tileRow, size_t tileCol) const;
+	void requireBudget(size_t tilesInMemory) const;
+	static void requireSameLayout(const DiskMatrix& a, const DiskMatrix& b);
+	static void requireOtherFile(const std::string& path, const DiskMatrix& a, const DiskMatrix& b);
+	static DiskMatrix combine(const DiskMatrix& a, const DiskMatrix& b, const std::string& path, bool add);
+
+public:
+	DiskMatrix();
+	DiskMatrix(const std::string& path);
+	~DiskMatrix();
+
+	static DiskMatrix create(const std::string& path, int n, size_t tileSize);
+	static DiskMatrix fromSquareMatrix(const std::string& path, const SquareMatrixView& m, size_t tileSize);
+	static size_t tileSizeForBudget(size_t bytes);
+	static void setMemoryBudget(size_t bytes);
+	static size_t getMemoryBudget();
+
+	int getDimension() const;
+	size_t getTileSize() const;
+	std::string getPath() const;
+	SquareMatrix readTile(size_t tileRow, size_t tileCol) const;
+	void writeTile(size_t tileRow, size_t tileCol, const SquareMatrixView& tile);
+	SquareMatrix toSquareMatrix() const;
+
+	static DiskMatrix add(const DiskMatrix& a, const DiskMatrix& b, const std::string& path);
+	static DiskMatrix substract(const DiskMatrix& a, const DiskMatrix& b, const std::string& path);
+	static DiskMatrix multiply(const DiskMatrix& a, const DiskMatrix& b, const std::string& path);
+	static DiskMatrix transpose(const DiskMatrix& a, const std::string& path);
+};
+#endif
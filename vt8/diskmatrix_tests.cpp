@@ -0,0 +1,78 @@
+#include "catch.hpp"
+#include "diskmatrix.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+/**
+ *  @file diskmatrix_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for DiskMatrix class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for DiskMatrix, will run in main generated by catch.hpp. Writes temporary files into working directory
+*  \return 0 if tests passes
+*/
+TEST_CASE("DiskMatrix", "[DiskMatrix]")
+{
+    std::vector<std::string> paths = {"diskmatrix_test_a.bin", "diskmatrix_test_b.bin", "diskmatrix_test_c.bin"};
+
+    SquareMatrix a(7), b(7);
+    for(size_t i = 0; i < 7; i++)
+    {
+        for(size_t j = 0; j < 7; j++)
+        {
+            a.setElement(i, j, IntElement(static_cast<int>(i * 7 + j) - 20));
+            b.setElement(i, j, IntElement(static_cast<int>(i * 3) - static_cast<int>(j)));
+        }
+    }
+
+    DiskMatrix da = DiskMatrix::fromSquareMatrix(paths[0], a, 3); // 3x3 tiles, last tile row and column padded
+    DiskMatrix db = DiskMatrix::fromSquareMatrix(paths[1], b, 3);
+    REQUIRE(da.getDimension() == 7);
+    REQUIRE(da.toSquareMatrix() == a);
+    REQUIRE(DiskMatrix(paths[0]).toSquareMatrix() == a);
+    REQUIRE(da.readTile(2, 2).toString() == "[[28,0,0][0,0,0][0,0,0]]");
+
+    REQUIRE(DiskMatrix::multiply(da, db, paths[2]).toSquareMatrix() == a * b);
+    REQUIRE(DiskMatrix::add(da, db, paths[2]).toSquareMatrix() == a + b);
+    REQUIRE(DiskMatrix::substract(da, db, paths[2]).toSquareMatrix() == a - b);
+    REQUIRE(DiskMatrix::transpose(da, paths[2]).toSquareMatrix() == a.transpose());
+
+    REQUIRE_THROWS_WITH(DiskMatrix::add(da, db, paths[0]), "Result file can not be an operand file");
+    REQUIRE_THROWS_WITH(DiskMatrix::multiply(da, da, "./" + paths[0]), "Result file can not be an operand file");
+    REQUIRE_THROWS_WITH(DiskMatrix::transpose(db, "./" + paths[1]), "Result file can not be an operand file");
+    REQUIRE(da.toSquareMatrix() == a);
+    REQUIRE(db.toSquareMatrix() == b);
+    REQUIRE_THROWS_AS(da.readTile(3, 0), std::out_of_range);
+    REQUIRE_THROWS_WITH(DiskMatrix(paths[0]).writeTile(0, 0, a), "Tile has wrong dimension");
+
+    size_t budget = DiskMatrix::getMemoryBudget();
+    DiskMatrix::setMemoryBudget(3 * 3 * sizeof(int) * 5);
+    REQUIRE_THROWS_WITH(DiskMatrix::multiply(da, db, paths[2]), "Memory budget too small for tile size");
+    REQUIRE(DiskMatrix::tileSizeForBudget(DiskMatrix::getMemoryBudget()) == 2);
+    DiskMatrix::setMemoryBudget(budget);
+
+    // corrupt headers: zero tile size, dimension above INT_MAX, tiles missing from the file
+    for(int corruption = 0; corruption < 3; corruption++)
+    {
+        char header[16] = {'S', 'Q', 'M', 'T'};
+        uint32_t tileSize = corruption == 0 ? 0 : 3;
+        uint64_t n = corruption == 1 ? static_cast<uint64_t>(1) << 40 : 7;
+        std::memcpy(header + 4, &tileSize, sizeof(tileSize));
+        std::memcpy(header + 8, &n, sizeof(n));
+        std::FILE* corrupt = std::fopen(paths[2].c_str(), "wb");
+        REQUIRE(corrupt != nullptr);
+        std::fwrite(header, 1, sizeof(header), corrupt);
+        std::fclose(corrupt);
+        REQUIRE_THROWS_AS(DiskMatrix(paths[2]), std::invalid_argument);
+    }
+
+    for(const std::string& path : paths)
+    {
+        std::remove(path.c_str());
+    }
+}
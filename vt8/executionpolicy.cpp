@@ -0,0 +1,253 @@
+#include "executionpolicy.h"
+#include "numatopology.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <thread>
+
+/**
+ *  @file executionpolicy.cpp
+ *  @brief Implementation of ExecutionPolicy
+ *  */
+
+ /**
+ *  @class ExecutionPolicy
+ *  @version 1.0
+ *  @brief How matrix operations use threads: serial or parallel, how many workers and on which cpus.
+ *      The global policy is read on first use from SQUAREMATRIX_THREADS (worker count, or "serial") and
+ *      SQUAREMATRIX_CPUS (cpu list such as "0-3,8"). A Scope overrides it for operations started by one thread.
+ *      Workers never run outside the affinity mask of the process and by default their number follows the
+ *      cpus of that mask and the cgroup cpu quota, so jobs sharing a host do not oversubscribe it
+ *  @author Niko Lehto
+ *  */
+
+std::mutex ExecutionPolicy::lock;
+ExecutionPolicy::Policy ExecutionPolicy::global;
+bool ExecutionPolicy::loaded = false;
+thread_local const ExecutionPolicy::Policy* ExecutionPolicy::scoped = nullptr;
+
+/**
+ *  \brief Makes p the policy of the calling thread, validated against cpus of the process
+ *  \param [in] p const Policy& policy for operations started before destruction
+ */
+ExecutionPolicy::Scope::Scope(const Policy& p) : policy(p), previous(scoped)
+{
+    workerCpus(policy);
+    scoped = &policy;
+}
+
+/**
+ *  \brief Restores policy that was active before construction
+ */
+ExecutionPolicy::Scope::~Scope()
+{
+    scoped = previous;
+}
+
+/**
+ *  \brief Policy given by environment variables SQUAREMATRIX_THREADS and SQUAREMATRIX_CPUS.
+ *      Values that can not be parsed are ignored
+ *  \return Policy parallel policy with every usable cpu if variables are not set
+ */
+ExecutionPolicy::Policy ExecutionPolicy::fromEnvironment()
+{
+    Policy result;
+
+    const char* threads = std::getenv("SQUAREMATRIX_THREADS");
+    if(threads != nullptr && *threads != '\0')
+    {
+        std::string value = threads;
+        if(value == "serial")
+        {
+            result.mode = Serial;
+        }
+        else if(value.find_first_not_of("0123456789") == std::string::npos && value.size() < 8)
+        {
+            result.threads = std::stoi(value);
+        }
+    }
+
+    const char* cpus = std::getenv("SQUAREMATRIX_CPUS");
+    if(cpus != nullptr && *cpus != '\0')
+    {
+        try
+        {
+            result.cpus = NumaTopology::parseCpuList(cpus);
+        }
+        catch(const std::exception&)
+        {
+            result.cpus.clear();
+        }
+    }
+    return result;
+}
+
+/**
+ *  \brief Getter for global policy. First call reads environment
+ *  \return Policy policy of threads without a Scope
+ */
+ExecutionPolicy::Policy ExecutionPolicy::getGlobal()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(!loaded)
+    {
+        global = fromEnvironment();
+        loaded = true;
+    }
+    return global;
+}
+
+/**
+ *  \brief Replaces global policy for operations started afterwards
+ *  \param [in] p const Policy& new policy
+ *  \throws std::invalid_argument if none of the cpus of p belongs to the process
+ */
+void ExecutionPolicy::setGlobal(const Policy& p)
+{
+    workerCpus(p);
+    std::lock_guard<std::mutex> guard(lock);
+    global = p;
+    loaded = true;
+}
+
+/**
+ *  \brief Getter for policy of calling thread
+ *  \return Policy innermost Scope of the thread, global policy without one
+ */
+ExecutionPolicy::Policy ExecutionPolicy::current()
+{
+    if(scoped != nullptr)
+    {
+        return *scoped;
+    }
+    return getGlobal();
+}
+
+/**
+ *  \brief Cpus the calling thread may run on according to sched_getaffinity
+ *  \return std::vector<int> allowed cpus in ascending order, at least one
+ */
+std::vector<int> ExecutionPolicy::processCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if(sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if(CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    if(cpus.empty())
+    {
+        for(unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ *  \brief Cpu limit of the cgroup (v2) of the process and its parents, read once
+ *  \return unsigned int quota rounded up to whole cpus, 0 if there is no quota
+ */
+unsigned int ExecutionPolicy::quotaCpus()
+{
+    static const unsigned int quota = []()
+    {
+        std::ifstream cgroups("/proc/self/cgroup");
+        std::string line, path;
+        while(std::getline(cgroups, line))
+        {
+            if(line.compare(0, 3, "0::") == 0)
+            {
+                path = line.substr(3);
+            }
+        }
+
+        unsigned int result = 0;
+        while(!path.empty())
+        {
+            std::ifstream file("/sys/fs/cgroup" + path + "/cpu.max");
+            std::string max;
+            long long period = 0;
+            if(file >> max >> period && max != "max" && period > 0 && max.find_first_not_of("0123456789") == std::string::npos)
+            {
+                unsigned int cpus = std::max(1LL, (std::stoll(max) + period - 1) / period);
+                result = result == 0 ? cpus : std::min(result, cpus);
+            }
+            path = path == "/" ? "" : path.substr(0, std::max<size_t>(1, path.rfind('/')));
+        }
+        return result;
+    }();
+    return quota;
+}
+
+/**
+ *  \brief Cpus workers of policy may run on
+ *  \param [in] p const Policy& policy
+ *  \return std::vector<int> cpus of p that belong to the process, every cpu of the process if p names none
+ *  \throws std::invalid_argument if none of the cpus of p belongs to the process
+ */
+std::vector<int> ExecutionPolicy::workerCpus(const Policy& p)
+{
+    std::vector<int> allowed = processCpus();
+    if(p.cpus.empty())
+    {
+        return allowed;
+    }
+
+    std::vector<int> cpus;
+    for(int cpu : p.cpus)
+    {
+        if(std::binary_search(allowed.begin(), allowed.end(), cpu) && std::find(cpus.begin(), cpus.end(), cpu) == cpus.end())
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    if(cpus.empty())
+    {
+        throw std::invalid_argument("policy has no cpus the process may run on");
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+/**
+ *  \brief Number of cpus workers of policy can keep busy at the same time
+ *  \param [in] p const Policy& policy
+ *  \return unsigned int worker cpus, limited by cgroup quota
+ */
+unsigned int ExecutionPolicy::usableCpus(const Policy& p)
+{
+    unsigned int cpus = static_cast<unsigned int>(workerCpus(p).size());
+    unsigned int quota = quotaCpus();
+    return quota != 0 ? std::min(cpus, quota) : cpus;
+}
+
+/**
+ *  \brief Restricts calling thread to cpus
+ *  \param [in] cpus const std::vector<int>& allowed cpus
+ *  \return bool true if affinity was set
+ */
+bool ExecutionPolicy::pinCurrentThread(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
@@ -0,0 +1,64 @@
+#ifndef EXECUTIONPOLICY_H
+#define EXECUTIONPOLICY_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @file executionpolicy.h
+ * @version 1.0
+ * @brief Declaration of ExecutionPolicy
+ * @author Niko Lehto
+ */
+class ExecutionPolicy
+{
+public:
+    enum Mode
+    {
+        Parallel, ///< operations split work between worker threads
+        Serial    ///< operations run on the calling thread
+    };
+
+    struct Policy
+    {
+        Mode mode = Parallel;
+        unsigned int threads = 0; ///< workers per operation, 0 uses tuning profile or every usable cpu
+        std::vector<int> cpus;    ///< cpus workers may run on, empty allows every cpu of the process
+    };
+
+    /**
+     *  \brief Overrides policy for operations started by the constructing thread until destroyed
+     */
+    class Scope
+    {
+    private:
+        Policy policy;
+        const Policy* previous;
+
+    public:
+        explicit Scope(const Policy& p);
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope();
+    };
+
+private:
+    static std::mutex lock;
+    static Policy global;
+    static bool loaded;
+    static thread_local const Policy* scoped;
+
+public:
+    static Policy fromEnvironment();
+    static Policy getGlobal();
+    static void setGlobal(const Policy& p);
+    static Policy current();
+
+    static std::vector<int> processCpus();
+    static unsigned int quotaCpus();
+    static std::vector<int> workerCpus(const Policy& p);
+    static unsigned int usableCpus(const Policy& p);
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+};
+#endif
@@ -0,0 +1,87 @@
+#include "catch.hpp"
+#include "executionpolicy.h"
+#include "squarematrix.h"
+#include "tuning.h"
+
+#include <cstdlib>
+
+/**
+ *  @file executionpolicy_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for ExecutionPolicy class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for ExecutionPolicy, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("ExecutionPolicy", "[ExecutionPolicy]")
+{
+    std::vector<int> processCpus = ExecutionPolicy::processCpus();
+    REQUIRE_FALSE(processCpus.empty());
+
+    ExecutionPolicy::Policy all;
+    REQUIRE(ExecutionPolicy::workerCpus(all) == processCpus);
+    REQUIRE(ExecutionPolicy::usableCpus(all) >= 1);
+    REQUIRE(ExecutionPolicy::usableCpus(all) <= processCpus.size());
+
+    ExecutionPolicy::Policy first;
+    first.cpus = {processCpus.front(), -1, processCpus.front()};
+    REQUIRE(ExecutionPolicy::workerCpus(first) == std::vector<int>({processCpus.front()}));
+
+    ExecutionPolicy::Policy none;
+    none.cpus = {-1};
+    REQUIRE_THROWS_WITH(ExecutionPolicy::workerCpus(none), "policy has no cpus the process may run on");
+    REQUIRE_THROWS_AS(ExecutionPolicy::setGlobal(none), std::invalid_argument);
+
+    setenv("SQUAREMATRIX_THREADS", "3", 1);
+    setenv("SQUAREMATRIX_CPUS", "0-1,4", 1);
+    ExecutionPolicy::Policy environment = ExecutionPolicy::fromEnvironment();
+    REQUIRE(environment.mode == ExecutionPolicy::Parallel);
+    REQUIRE(environment.threads == 3);
+    REQUIRE(environment.cpus == std::vector<int>({0, 1, 4}));
+    setenv("SQUAREMATRIX_THREADS", "serial", 1);
+    setenv("SQUAREMATRIX_CPUS", "x", 1);
+    environment = ExecutionPolicy::fromEnvironment();
+    REQUIRE(environment.mode == ExecutionPolicy::Serial);
+    REQUIRE(environment.cpus.empty());
+    unsetenv("SQUAREMATRIX_THREADS");
+    unsetenv("SQUAREMATRIX_CPUS");
+
+    Tuning::Profile original = Tuning::getProfile();
+    Tuning::Profile profile = original;
+    profile.parallelGrain = 1024;
+    Tuning::setProfile(profile);
+    SquareMatrix a(64), b(64);
+    SquareMatrix expected = a * b;
+
+    ExecutionPolicy::Policy two;
+    two.threads = 2;
+    two.cpus = first.cpus;
+    ExecutionPolicy::Policy serial;
+    serial.mode = ExecutionPolicy::Serial;
+    {
+        ExecutionPolicy::Scope outer(two);
+        REQUIRE(SquareMatrix::getParallelStats().maxThreads == 2);
+        {
+            ExecutionPolicy::Scope inner(serial);
+            SquareMatrix::resetParallelStats();
+            REQUIRE(a * b == expected);
+            REQUIRE(SquareMatrix::getParallelStats().serialRuns == 1);
+            REQUIRE(SquareMatrix::getParallelStats().maxThreads == 1);
+        }
+        SquareMatrix::resetParallelStats();
+        REQUIRE(a * b == expected);
+        REQUIRE(SquareMatrix::getParallelStats().threadsStarted == 2);
+    }
+    REQUIRE(ExecutionPolicy::current().threads == ExecutionPolicy::getGlobal().threads);
+
+    ExecutionPolicy::Policy global = ExecutionPolicy::getGlobal();
+    ExecutionPolicy::setGlobal(serial);
+    SquareMatrix::resetParallelStats();
+    SquareMatrix c(64);
+    REQUIRE(SquareMatrix::getParallelStats().threadsStarted == 0);
+    ExecutionPolicy::setGlobal(global);
+    Tuning::setProfile(original);
+}
@@ -0,0 +1,697 @@
+#include "gemmkernel.h"
+#include "matrixpool.h"
+#include "reductionkernel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(__AVX2__) || defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+/**
+ *  @file gemmkernel.cpp
+ *  @brief Implementation of GemmKernel
+ *  */
+
+ /**
+ *  @class GemmKernel
+ *  @version 1.0
+ *  @brief Packed integer matrix multiplication in the style of GotoBLAS. Five loops around a micro-kernel:
+ *      columns of the result in blocks of tuning.columnBlock (NC), depth in blocks of tuning.depthBlock (KC) whose
+ *      right-hand side panel is packed once, rows in blocks of tuning.rowBlock (MC) whose left-hand side panel is
+ *      packed once, and inside them MR x NR register tiles. Packing stores both panels in the order the micro-kernel
+ *      reads them, so its loads are contiguous and aligned. With AVX2 the micro-kernel keeps a 6x16 tile in twelve
+ *      ymm registers, otherwise a portable kernel with fixed trip counts is left to the compiler to vectorize.
+ *      When both operands fit into 16 bits, pairs of elements are packed into one slot and multiplied by 16-bit
+ *      dot product instructions with 32-bit accumulation, which do twice the work of 32-bit multiplies per instruction.
+ *      When sums of a depth block can not reach 2^53, panels are packed as doubles and multiplied with FMA,
+ *      which is exact for such integers. Tuning::autotune() enables it where it beats 32-bit integer multiplies
+ *  @author Niko Lehto
+ *  */
+
+const size_t GemmKernel::rowRegisters;
+const size_t GemmKernel::columnRegisters;
+
+/**
+ *  \brief Packing buffer of a thread. Grows to the largest panel packed by the thread and is freed when it exits,
+ *      so multiplication into an existing matrix does not allocate from MatrixPool
+ */
+struct PackBuffer
+{
+    int* data = nullptr;
+    size_t capacity = 0;
+
+    ~PackBuffer()
+    {
+        std::free(data);
+    }
+
+    /**
+     *  \brief Makes room for count elements, previous contents are lost
+     *  \param [in] count size_t elements needed
+     *  \return int* buffer aligned to MatrixPool::alignment
+     */
+    int* reserve(size_t count)
+    {
+        if(count > capacity)
+        {
+            size_t bytes = (count * sizeof(int) + MatrixPool::alignment - 1) / MatrixPool::alignment * MatrixPool::alignment;
+            int* grown = static_cast<int*>(std::aligned_alloc(MatrixPool::alignment, bytes));
+            if(grown == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            std::free(data);
+            data = grown;
+            capacity = bytes / sizeof(int);
+        }
+        return data;
+    }
+};
+
+static thread_local PackBuffer leftBuffer, rightBuffer;
+
+/**
+ *  \brief Packs rows [row, row+rows) x columns [depth, depth+depths) of lhs, scaled by alpha, into micro-panels of
+ *      MR rows stored column by column. Missing rows of the last micro-panel are zero
+ *  \param [in] lhs const SquareMatrixView& left-hand side
+ *  \param [in] row size_t first row
+ *  \param [in] rows size_t number of rows
+ *  \param [in] depth size_t first column
+ *  \param [in] depths size_t number of columns
+ *  \param [in] alpha int scale of product
+ *  \param [out] packed int* ceil(rows/MR)*MR*depths elements
+ */
+void GemmKernel::packLeft(const SquareMatrixView& lhs, size_t row, size_t rows, size_t depth, size_t depths, int alpha, int* packed)
+{
+    for(size_t panel = 0; panel < rows; panel += rowRegisters)
+    {
+        size_t height = std::min(rowRegisters, rows - panel);
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            if(i < height)
+            {
+                const int* source = lhs.row(row + panel + i) + depth;
+                for(size_t p = 0; p < depths; p++)
+                {
+                    packed[p * rowRegisters + i] = alpha * source[p];
+                }
+            }
+            else
+            {
+                for(size_t p = 0; p < depths; p++)
+                {
+                    packed[p * rowRegisters + i] = 0;
+                }
+            }
+        }
+        packed += rowRegisters * depths;
+    }
+}
+
+/**
+ *  \brief Packs rows [depth, depth+depths) x columns [column, column+columns) of m into micro-panels of NR columns
+ *      stored row by row. Missing columns of the last micro-panel are zero
+ *  \param [in] m const SquareMatrixView& right-hand side
+ *  \param [in] depth size_t first row
+ *  \param [in] depths size_t number of rows
+ *  \param [in] column size_t first column
+ *  \param [in] columns size_t number of columns
+ *  \param [out] packed int* ceil(columns/NR)*NR*depths elements
+ */
+void GemmKernel::packRight(const SquareMatrixView& m, size_t depth, size_t depths, size_t column, size_t columns, int* packed)
+{
+    for(size_t panel = 0; panel < columns; panel += columnRegisters)
+    {
+        size_t width = std::min(columnRegisters, columns - panel);
+        for(size_t p = 0; p < depths; p++)
+        {
+            const int* source = m.row(depth + p) + column + panel;
+            int* target = packed + p * columnRegisters;
+            std::copy(source, source + width, target);
+            std::fill(target + width, target + columnRegisters, 0);
+        }
+        packed += columnRegisters * depths;
+    }
+}
+
+/**
+ *  \brief Adds product of a packed MR x depths micro-panel and a packed depths x NR micro-panel into c
+ *  \param [in] depths size_t length of the dot products
+ *  \param [in] a const int* packed left-hand side micro-panel
+ *  \param [in] b const int* packed right-hand side micro-panel
+ *  \param [in,out] c int* first element of result tile
+ *  \param [in] ldc size_t distance of result rows
+ *  \param [in] rows size_t rows of result tile to write, at most MR
+ *  \param [in] columns size_t columns of result tile to write, at most NR
+ */
+void GemmKernel::microKernel(size_t depths, const int* a, const int* b, int* c, size_t ldc, size_t rows, size_t columns)
+{
+    alignas(64) int tile[rowRegisters][columnRegisters];
+
+#if defined(__AVX2__)
+    __m256i acc[rowRegisters][2];
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+    for(size_t p = 0; p < depths; p++)
+    {
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + p * columnRegisters));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + p * columnRegisters + 8));
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            __m256i value = _mm256_set1_epi32(a[p * rowRegisters + i]);
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_mullo_epi32(value, b0));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_mullo_epi32(value, b1));
+        }
+    }
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i]), acc[i][0]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i] + 8), acc[i][1]);
+    }
+#else
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        std::fill(tile[i], tile[i] + columnRegisters, 0);
+    }
+    for(size_t p = 0; p < depths; p++)
+    {
+        const int* row = b + p * columnRegisters;
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            int value = a[p * rowRegisters + i];
+            for(size_t j = 0; j < columnRegisters; j++)
+            {
+                tile[i][j] += value * row[j];
+            }
+        }
+    }
+#endif
+
+    for(size_t i = 0; i < rows; i++)
+    {
+        int* target = c + i * ldc;
+        for(size_t j = 0; j < columns; j++)
+        {
+            target[j] += tile[i][j];
+        }
+    }
+}
+
+/**
+ *  \brief Two 16-bit values in one 32-bit slot, first in the low half, the layout read by pmaddwd and vpdpwssd
+ *  \param [in] low int value that fits into 16 bits
+ *  \param [in] high int value that fits into 16 bits
+ *  \return int slot
+ */
+static int pair(int low, int high)
+{
+    return static_cast<int>(static_cast<uint16_t>(low) | static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16);
+}
+
+/**
+ *  \brief Packs rows [row, row+rows) x columns [depth, depth+depths) of lhs into micro-panels of MR rows, two
+ *      consecutive columns per slot. Missing rows and the column after an odd last column are zero
+ *  \param [in] lhs const SquareMatrixView& left-hand side, elements fit into 16 bits
+ *  \param [in] row size_t first row
+ *  \param [in] rows size_t number of rows
+ *  \param [in] depth size_t first column
+ *  \param [in] depths size_t number of columns
+ *  \param [out] packed int* ceil(rows/MR)*MR*ceil(depths/2) slots
+ */
+void GemmKernel::packLeftNarrow(const SquareMatrixView& lhs, size_t row, size_t rows, size_t depth, size_t depths, int* packed)
+{
+    size_t slots = (depths + 1) / 2;
+    for(size_t panel = 0; panel < rows; panel += rowRegisters)
+    {
+        size_t height = std::min(rowRegisters, rows - panel);
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            const int* source = i < height ? lhs.row(row + panel + i) + depth : nullptr;
+            for(size_t q = 0; q < slots; q++)
+            {
+                int low = source != nullptr ? source[2 * q] : 0;
+                int high = source != nullptr && 2 * q + 1 < depths ? source[2 * q + 1] : 0;
+                packed[q * rowRegisters + i] = pair(low, high);
+            }
+        }
+        packed += rowRegisters * slots;
+    }
+}
+
+/**
+ *  \brief Packs rows [depth, depth+depths) x columns [column, column+columns) of m into micro-panels of NR columns,
+ *      two consecutive rows per slot. Missing columns and the row after an odd last row are zero
+ *  \param [in] m const SquareMatrixView& right-hand side, elements fit into 16 bits
+ *  \param [in] depth size_t first row
+ *  \param [in] depths size_t number of rows
+ *  \param [in] column size_t first column
+ *  \param [in] columns size_t number of columns
+ *  \param [out] packed int* ceil(columns/NR)*NR*ceil(depths/2) slots
+ */
+void GemmKernel::packRightNarrow(const SquareMatrixView& m, size_t depth, size_t depths, size_t column, size_t columns, int* packed)
+{
+    size_t slots = (depths + 1) / 2;
+    for(size_t panel = 0; panel < columns; panel += columnRegisters)
+    {
+        size_t width = std::min(columnRegisters, columns - panel);
+        for(size_t q = 0; q < slots; q++)
+        {
+            const int* first = m.row(depth + 2 * q) + column + panel;
+            const int* second = 2 * q + 1 < depths ? m.row(depth + 2 * q + 1) + column + panel : nullptr;
+            int* target = packed + q * columnRegisters;
+            for(size_t j = 0; j < columnRegisters; j++)
+            {
+                target[j] = j < width ? pair(first[j], second != nullptr ? second[j] : 0) : 0;
+            }
+        }
+        packed += columnRegisters * slots;
+    }
+}
+
+/**
+ *  \brief Adds alpha times the product of packed 16-bit micro-panels into c. Each slot contributes two products,
+ *      accumulated in 32 bits: by vpdpwssd with AVX-512 VNNI or AVX-VNNI, by pmaddwd with AVX2
+ *  \param [in] slots size_t slots per micro-panel row or column
+ *  \param [in] a const int* packed left-hand side micro-panel
+ *  \param [in] b const int* packed right-hand side micro-panel
+ *  \param [in] alpha int scale of product
+ *  \param [in,out] c int* first element of result tile
+ *  \param [in] ldc size_t distance of result rows
+ *  \param [in] rows size_t rows of result tile to write, at most MR
+ *  \param [in] columns size_t columns of result tile to write, at most NR
+ */
+void GemmKernel::microKernelNarrow(size_t slots, const int* a, const int* b, int alpha, int* c, size_t ldc, size_t rows, size_t columns)
+{
+    alignas(64) int tile[rowRegisters][columnRegisters];
+
+#if defined(__AVX2__)
+    __m256i acc[rowRegisters][2];
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+    for(size_t q = 0; q < slots; q++)
+    {
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + q * columnRegisters));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + q * columnRegisters + 8));
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            __m256i value = _mm256_set1_epi32(a[q * rowRegisters + i]);
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+            acc[i][0] = _mm256_dpwssd_epi32(acc[i][0], value, b0);
+            acc[i][1] = _mm256_dpwssd_epi32(acc[i][1], value, b1);
+#elif defined(__AVXVNNI__)
+            acc[i][0] = _mm256_dpwssd_avx_epi32(acc[i][0], value, b0);
+            acc[i][1] = _mm256_dpwssd_avx_epi32(acc[i][1], value, b1);
+#else
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_madd_epi16(value, b0));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_madd_epi16(value, b1));
+#endif
+        }
+    }
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i]), acc[i][0]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i] + 8), acc[i][1]);
+    }
+#else
+    // unsigned arithmetic wraps like the vector instructions
+    uint32_t sums[rowRegisters][columnRegisters] = {};
+    for(size_t q = 0; q < slots; q++)
+    {
+        const int* row = b + q * columnRegisters;
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            int32_t low = static_cast<int16_t>(a[q * rowRegisters + i]);
+            int32_t high = static_cast<int16_t>(a[q * rowRegisters + i] >> 16);
+            for(size_t j = 0; j < columnRegisters; j++)
+            {
+                sums[i][j] += static_cast<uint32_t>(low * static_cast<int16_t>(row[j])) + static_cast<uint32_t>(high * static_cast<int16_t>(row[j] >> 16));
+            }
+        }
+    }
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        for(size_t j = 0; j < columnRegisters; j++)
+        {
+            tile[i][j] = static_cast<int>(sums[i][j]);
+        }
+    }
+#endif
+
+    for(size_t i = 0; i < rows; i++)
+    {
+        int* target = c + i * ldc;
+        for(size_t j = 0; j < columns; j++)
+        {
+            target[j] += alpha * tile[i][j];
+        }
+    }
+}
+
+/**
+ *  \brief Packs rows [row, row+rows) x columns [depth, depth+depths) of lhs as doubles into micro-panels of MR rows
+ *      stored column by column. Missing rows of the last micro-panel are zero
+ *  \param [in] lhs const SquareMatrixView& left-hand side
+ *  \param [in] row size_t first row
+ *  \param [in] rows size_t number of rows
+ *  \param [in] depth size_t first column
+ *  \param [in] depths size_t number of columns
+ *  \param [out] packed double* ceil(rows/MR)*MR*depths elements
+ */
+void GemmKernel::packLeftDouble(const SquareMatrixView& lhs, size_t row, size_t rows, size_t depth, size_t depths, double* packed)
+{
+    for(size_t panel = 0; panel < rows; panel += rowRegisters)
+    {
+        size_t height = std::min(rowRegisters, rows - panel);
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            const int* source = i < height ? lhs.row(row + panel + i) + depth : nullptr;
+            for(size_t p = 0; p < depths; p++)
+            {
+                packed[p * rowRegisters + i] = source != nullptr ? source[p] : 0.0;
+            }
+        }
+        packed += rowRegisters * depths;
+    }
+}
+
+/**
+ *  \brief Packs rows [depth, depth+depths) x columns [column, column+columns) of m as doubles into micro-panels of
+ *      NR columns stored row by row. Missing columns of the last micro-panel are zero
+ *  \param [in] m const SquareMatrixView& right-hand side
+ *  \param [in] depth size_t first row
+ *  \param [in] depths size_t number of rows
+ *  \param [in] column size_t first column
+ *  \param [in] columns size_t number of columns
+ *  \param [out] packed double* ceil(columns/NR)*NR*depths elements
+ */
+void GemmKernel::packRightDouble(const SquareMatrixView& m, size_t depth, size_t depths, size_t column, size_t columns, double* packed)
+{
+    for(size_t panel = 0; panel < columns; panel += columnRegisters)
+    {
+        size_t width = std::min(columnRegisters, columns - panel);
+        for(size_t p = 0; p < depths; p++)
+        {
+            const int* source = m.row(depth + p) + column + panel;
+            double* target = packed + p * columnRegisters;
+            for(size_t j = 0; j < columnRegisters; j++)
+            {
+                target[j] = j < width ? source[j] : 0.0;
+            }
+        }
+        packed += columnRegisters * depths;
+    }
+}
+
+/**
+ *  \brief Adds alpha times the product of packed double micro-panels into c. Every partial sum is an integer below
+ *      2^53, so it is exact and converts back without rounding. With FMA the MR x NR tile is computed as two halves of
+ *      MR x NR/2, each held in twelve ymm registers
+ *  \param [in] depths size_t length of the dot products
+ *  \param [in] a const double* packed left-hand side micro-panel
+ *  \param [in] b const double* packed right-hand side micro-panel
+ *  \param [in] alpha int scale of product
+ *  \param [in,out] c int* first element of result tile
+ *  \param [in] ldc size_t distance of result rows
+ *  \param [in] rows size_t rows of result tile to write, at most MR
+ *  \param [in] columns size_t columns of result tile to write, at most NR
+ */
+void GemmKernel::microKernelDouble(size_t depths, const double* a, const double* b, int alpha, int* c, size_t ldc, size_t rows, size_t columns)
+{
+    alignas(64) double tile[rowRegisters][columnRegisters];
+
+#if defined(__AVX512F__)
+    __m512d acc[rowRegisters][2];
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        acc[i][0] = _mm512_setzero_pd();
+        acc[i][1] = _mm512_setzero_pd();
+    }
+    for(size_t p = 0; p < depths; p++)
+    {
+        __m512d b0 = _mm512_load_pd(b + p * columnRegisters);
+        __m512d b1 = _mm512_load_pd(b + p * columnRegisters + 8);
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            __m512d value = _mm512_set1_pd(a[p * rowRegisters + i]);
+            acc[i][0] = _mm512_fmadd_pd(value, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_pd(value, b1, acc[i][1]);
+        }
+    }
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        _mm512_store_pd(tile[i], acc[i][0]);
+        _mm512_store_pd(tile[i] + 8, acc[i][1]);
+    }
+#elif defined(__FMA__)
+    for(size_t half = 0; half < columnRegisters; half += 8)
+    {
+        __m256d acc[rowRegisters][2];
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            acc[i][0] = _mm256_setzero_pd();
+            acc[i][1] = _mm256_setzero_pd();
+        }
+        for(size_t p = 0; p < depths; p++)
+        {
+            __m256d b0 = _mm256_load_pd(b + p * columnRegisters + half);
+            __m256d b1 = _mm256_load_pd(b + p * columnRegisters + half + 4);
+            for(size_t i = 0; i < rowRegisters; i++)
+            {
+                __m256d value = _mm256_broadcast_sd(a + p * rowRegisters + i);
+                acc[i][0] = _mm256_fmadd_pd(value, b0, acc[i][0]);
+                acc[i][1] = _mm256_fmadd_pd(value, b1, acc[i][1]);
+            }
+        }
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            _mm256_store_pd(tile[i] + half, acc[i][0]);
+            _mm256_store_pd(tile[i] + half + 4, acc[i][1]);
+        }
+    }
+#else
+    for(size_t i = 0; i < rowRegisters; i++)
+    {
+        std::fill(tile[i], tile[i] + columnRegisters, 0.0);
+    }
+    for(size_t p = 0; p < depths; p++)
+    {
+        const double* row = b + p * columnRegisters;
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            double value = a[p * rowRegisters + i];
+            for(size_t j = 0; j < columnRegisters; j++)
+            {
+                tile[i][j] += value * row[j];
+            }
+        }
+    }
+#endif
+
+    for(size_t i = 0; i < rows; i++)
+    {
+        int* target = c + i * ldc;
+        for(size_t j = 0; j < columns; j++)
+        {
+            // low 32 bits of the exact sum, as the 32-bit kernel would have wrapped
+            int sum = static_cast<int>(static_cast<uint32_t>(static_cast<int64_t>(tile[i][j])));
+            target[j] += alpha * sum;
+        }
+    }
+}
+
+/**
+ *  \brief Getter for micro-kernel compiled in
+ *  \return const char* "avx2" or "portable"
+ */
+const char* GemmKernel::getName()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#else
+    return "portable";
+#endif
+}
+
+/**
+ *  \brief Getter for 16-bit micro-kernel compiled in
+ *  \return const char* "avx512-vnni", "avx-vnni", "avx2" or "portable"
+ */
+const char* GemmKernel::getNarrowName()
+{
+#if defined(__AVX2__) && defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return "avx512-vnni";
+#elif defined(__AVX2__) && defined(__AVXVNNI__)
+    return "avx-vnni";
+#elif defined(__AVX2__)
+    return "avx2";
+#else
+    return "portable";
+#endif
+}
+
+/**
+ *  \brief Smallest and largest element of m
+ *  \param [in] m const SquareMatrixView& matrix
+ *  \return Range bounds, 0 and 0 for an empty matrix
+ */
+GemmKernel::Range GemmKernel::range(const SquareMatrixView& m)
+{
+    Range result;
+    size_t t_n = m.getDimension();
+    for(size_t i = 0; i < t_n; i++)
+    {
+        result.low = std::min(result.low, ReductionKernel::min(m.row(i), t_n));
+        result.high = std::max(result.high, ReductionKernel::max(m.row(i), t_n));
+    }
+    return result;
+}
+
+/**
+ *  \brief Tells if every element of m fits into 16 bits, so that products of such matrices can use the narrow kernel
+ *  \param [in] m const SquareMatrixView& matrix
+ *  \return bool true if all elements are in [-32768, 32767]
+ */
+bool GemmKernel::fitsNarrow(const SquareMatrixView& m)
+{
+    Range r = range(m);
+    return r.low >= INT16_MIN && r.high <= INT16_MAX;
+}
+
+/**
+ *  \brief Chooses the fastest kernel that gives the same result as the 32-bit kernel. One pass over both operands
+ *  \param [in] lhs const SquareMatrixView& left-hand side
+ *  \param [in] m const SquareMatrixView& right-hand side
+ *  \param [in] tuning const Tuning::Profile& block sizes, a double sum covers at most depthBlock products
+ *  \return Path Narrow if both fit into 16 bits, Double if the profile enables it and every sum of depthBlock products
+ *      stays below 2^53, Wide otherwise
+ */
+GemmKernel::Path GemmKernel::choosePath(const SquareMatrixView& lhs, const SquareMatrixView& m, const Tuning::Profile& tuning)
+{
+    Range left = range(lhs), right = range(m);
+    if(left.low >= INT16_MIN && left.high <= INT16_MAX && right.low >= INT16_MIN && right.high <= INT16_MAX)
+    {
+        return Narrow;
+    }
+
+    if(tuning.doubleKernel)
+    {
+        double leftMagnitude = std::max(-static_cast<double>(left.low), static_cast<double>(left.high));
+        double rightMagnitude = std::max(-static_cast<double>(right.low), static_cast<double>(right.high));
+        double depths = static_cast<double>(std::min<size_t>(std::max<size_t>(1, tuning.depthBlock), m.getDimension()));
+        if(depths * leftMagnitude * rightMagnitude <= 9007199254740992.0) // 2^53, every partial sum is exact
+        {
+            return Double;
+        }
+    }
+    return Wide;
+}
+
+/**
+ *  \brief Adds alpha * lhs * m into rows [start, stop) x columns [column_start, column_stop) of result
+ *  \param [in] start size_t first row
+ *  \param [in] stop size_t one past last row
+ *  \param [in] column_start size_t first column
+ *  \param [in] column_stop size_t one past last column
+ *  \param [in] alpha int scale of product
+ *  \param [in] lhs const SquareMatrixView& left-hand side
+ *  \param [in] m const SquareMatrixView& right-hand side
+ *  \param [in,out] result int* result elements
+ *  \param [in] ldc size_t distance of result rows
+ *  \param [in] tuning const Tuning::Profile& block sizes NC, KC and MC
+ *  \param [in] path Path kernel, Narrow and Double only when chosen by choosePath() for lhs and m. Result is the same
+ *      bit for bit in every kernel, sums are exact modulo 2^32
+ */
+void GemmKernel::multiply(size_t start, size_t stop, size_t column_start, size_t column_stop, int alpha,
+                          const SquareMatrixView& lhs, const SquareMatrixView& m, int* result, size_t ldc, const Tuning::Profile& tuning, Path path)
+{
+    size_t t_n = m.getDimension();
+    if(start >= stop || column_start >= column_stop || t_n == 0)
+    {
+        return;
+    }
+
+    size_t nc = std::max<size_t>(columnRegisters, tuning.columnBlock / columnRegisters * columnRegisters);
+    size_t kc = std::max<size_t>(1, tuning.depthBlock);
+    size_t mc = std::max<size_t>(rowRegisters, tuning.rowBlock / rowRegisters * rowRegisters);
+    nc = std::min(nc, (column_stop - column_start + columnRegisters - 1) / columnRegisters * columnRegisters);
+    kc = std::min(kc, t_n);
+    mc = std::min(mc, (stop - start + rowRegisters - 1) / rowRegisters * rowRegisters);
+
+    // doubles take two int slots
+    size_t width = path == Double ? 2 : 1;
+    int* packedRight = rightBuffer.reserve(nc * kc * width);
+    int* packedLeft = leftBuffer.reserve(mc * kc * width);
+    double* packedRightDouble = reinterpret_cast<double*>(packedRight);
+    double* packedLeftDouble = reinterpret_cast<double*>(packedLeft);
+
+    for(size_t jc = column_start; jc < column_stop; jc += nc)
+    {
+        size_t columns = std::min(nc, column_stop - jc);
+        for(size_t pc = 0; pc < t_n; pc += kc)
+        {
+            size_t depths = std::min(kc, t_n - pc);
+            size_t slots = path == Narrow ? (depths + 1) / 2 : depths; // packed elements per row or column of a micro-panel
+            if(path == Narrow)
+            {
+                packRightNarrow(m, pc, depths, jc, columns, packedRight);
+            }
+            else if(path == Double)
+            {
+                packRightDouble(m, pc, depths, jc, columns, packedRightDouble);
+            }
+            else
+            {
+                packRight(m, pc, depths, jc, columns, packedRight);
+            }
+
+            for(size_t ic = start; ic < stop; ic += mc)
+            {
+                size_t rows = std::min(mc, stop - ic);
+                if(path == Narrow)
+                {
+                    packLeftNarrow(lhs, ic, rows, pc, depths, packedLeft);
+                }
+                else if(path == Double)
+                {
+                    packLeftDouble(lhs, ic, rows, pc, depths, packedLeftDouble);
+                }
+                else
+                {
+                    packLeft(lhs, ic, rows, pc, depths, alpha, packedLeft);
+                }
+
+                for(size_t jr = 0; jr < columns; jr += columnRegisters)
+                {
+                    for(size_t ir = 0; ir < rows; ir += rowRegisters)
+                    {
+                        int* c = result + (ic + ir) * ldc + jc + jr;
+                        size_t height = std::min(rowRegisters, rows - ir);
+                        size_t tileWidth = std::min(columnRegisters, columns - jr);
+                        if(path == Narrow)
+                        {
+                            microKernelNarrow(slots, packedLeft + ir * slots, packedRight + jr * slots, alpha, c, ldc, height, tileWidth);
+                        }
+                        else if(path == Double)
+                        {
+                            microKernelDouble(slots, packedLeftDouble + ir * slots, packedRightDouble + jr * slots, alpha, c, ldc, height, tileWidth);
+                        }
+                        else
+                        {
+                            microKernel(slots, packedLeft + ir * slots, packedRight + jr * slots, c, ldc, height, tileWidth);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef GEMMKERNEL_H
+#define GEMMKERNEL_H
+
+#include "squarematrixview.h"
+#include "tuning.h"
+
+#include <cstddef>
+
+/**
+ * @file gemmkernel.h
+ * @version 1.0
+ * @brief Declaration of GemmKernel
+ * @author Niko Lehto
+ */
+class GemmKernel
+{
+public:
+    enum Path
+    {
+        Wide,   ///< 32-bit integer kernel, any values
+        Narrow, ///< 16-bit dot product kernel, both operands fit into 16 bits
+        Double  ///< double precision FMA kernel, sums of a depth block below 2^53
+    };
+
+    struct Range
+    {
+        int low = 0;  ///< smallest element, at most 0
+        int high = 0; ///< largest element, at least 0
+    };
+
+    static const size_t rowRegisters = 6;     ///< MR, rows of result kept in registers by micro-kernel
+    static const size_t columnRegisters = 16; ///< NR, columns of result kept in registers by micro-kernel
+
+private:
+    static void packLeft(const SquareMatrixView& lhs, size_t row, size_t rows, size_t depth, size_t depths, int alpha, int* packed);
+    static void packRight(const SquareMatrixView& m, size_t depth, size_t depths, size_t column, size_t columns, int* packed);
+    static void microKernel(size_t depths, const int* a, const int* b, int* c, size_t ldc, size_t rows, size_t columns);
+    static void packLeftNarrow(const SquareMatrixView& lhs, size_t row, size_t rows, size_t depth, size_t depths, int* packed);
+    static void packRightNarrow(const SquareMatrixView& m, size_t depth, size_t depths, size_t column, size_t columns, int* packed);
+    static void microKernelNarrow(size_t slots, const int* a, const int* b, int alpha, int* c, size_t ldc, size_t rows, size_t columns);
+    static void packLeftDouble(const SquareMatrixView& lhs, size_t row, size_t rows, size_t depth, size_t depths, double* packed);
+    static void packRightDouble(const SquareMatrixView& m, size_t depth, size_t depths, size_t column, size_t columns, double* packed);
+    static void microKernelDouble(size_t depths, const double* a, const double* b, int alpha, int* c, size_t ldc, size_t rows, size_t columns);
+
+public:
+    static const char* getName();
+    static const char* getNarrowName();
+    static Range range(const SquareMatrixView& m);
+    static bool fitsNarrow(const SquareMatrixView& m);
+    static Path choosePath(const SquareMatrixView& lhs, const SquareMatrixView& m, const Tuning::Profile& tuning);
+    static void multiply(size_t start, size_t stop, size_t column_start, size_t column_stop, int alpha,
+                         const SquareMatrixView& lhs, const SquareMatrixView& m, int* result, size_t ldc, const Tuning::Profile& tuning,
+                         Path path = Wide);
+};
+#endif
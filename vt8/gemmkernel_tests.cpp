@@ -0,0 +1,162 @@
+#include "catch.hpp"
+#include "gemmkernel.h"
+#include "squarematrix.h"
+
+#include <string>
+#include <vector>
+
+/**
+ *  @file gemmkernel_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for GemmKernel class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for GemmKernel, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("GemmKernel", "[GemmKernel]")
+{
+    REQUIRE((std::string(GemmKernel::getName()) == "avx2" || std::string(GemmKernel::getName()) == "portable"));
+
+    Tuning::Profile tuning;
+    tuning.depthBlock = 5;
+    tuning.columnBlock = 20;
+    tuning.rowBlock = 7;
+
+    for(size_t n : {1, 6, 17, 45})
+    {
+        SquareMatrix a(static_cast<int>(n)), b(static_cast<int>(n));
+        std::vector<int> result(n * n, 1);
+
+        // partial tile in the middle of the matrix, blocks and register tiles with edges
+        size_t start = n / 3, stop = n, column_start = n / 4, column_stop = n - n / 5;
+        GemmKernel::multiply(start, stop, column_start, column_stop, -3, a, b, result.data(), n, tuning);
+
+        bool same = true;
+        for(size_t i = 0; i < n; i++)
+        {
+            for(size_t j = 0; j < n; j++)
+            {
+                int expected = 1;
+                if(i >= start && i < stop && j >= column_start && j < column_stop)
+                {
+                    for(size_t k = 0; k < n; k++)
+                    {
+                        expected += -3 * a.getElement(i, k).getVal() * b.getElement(k, j).getVal();
+                    }
+                }
+                same = same && result[i * n + j] == expected;
+            }
+        }
+        REQUIRE(same);
+    }
+}
+
+/**
+*  \brief Unit tests for 16-bit GemmKernel path, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("GemmKernel narrow", "[GemmKernelNarrow]")
+{
+    REQUIRE_FALSE(std::string(GemmKernel::getNarrowName()).empty());
+    REQUIRE(GemmKernel::fitsNarrow(SquareMatrix("[[-32768,32767][0,1]]")));
+    REQUIRE_FALSE(GemmKernel::fitsNarrow(SquareMatrix("[[-32769,0][0,1]]")));
+    REQUIRE_FALSE(GemmKernel::fitsNarrow(SquareMatrix("[[0,0][32768,1]]")));
+
+    Tuning::Profile tuning;
+    tuning.depthBlock = 9;
+    tuning.columnBlock = 20;
+    tuning.rowBlock = 7;
+
+    for(size_t n : {1, 2, 19, 40})
+    {
+        // extremes of 16 bits make sums wrap, both kernels must wrap the same way
+        SquareMatrix a(static_cast<int>(n)), b(static_cast<int>(n));
+        for(size_t i = 0; i < n; i++)
+        {
+            for(size_t j = 0; j < n; j++)
+            {
+                a.setElement(i, j, IntElement((i + j) % 3 == 0 ? -32768 : static_cast<int>(i * 131 + j * 17) % 65536 - 32768));
+                b.setElement(i, j, IntElement((i * j) % 4 == 0 ? -32768 : 32767 - static_cast<int>(i * 7 + j * 29) % 65536));
+            }
+        }
+        REQUIRE(GemmKernel::fitsNarrow(a));
+        REQUIRE(GemmKernel::fitsNarrow(b));
+
+        for(int alpha : {1, -7, 65537})
+        {
+            std::vector<int> wide(n * n, 5), narrow(n * n, 5);
+            GemmKernel::multiply(0, n, 0, n, alpha, a, b, wide.data(), n, tuning, GemmKernel::Wide);
+            GemmKernel::multiply(0, n, 0, n, alpha, a, b, narrow.data(), n, tuning, GemmKernel::Narrow);
+            REQUIRE(wide == narrow);
+        }
+    }
+
+    SquareMatrix small("[[1,-2,3][4,5,-6][-7,8,9]]");
+    REQUIRE(small * small == SquareMatrix("[[-28,12,42][66,-31,-72][-38,126,12]]"));
+}
+
+/**
+*  \brief Unit tests for double precision GemmKernel path, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("GemmKernel double", "[GemmKernelDouble]")
+{
+    Tuning::Profile tuning;
+    tuning.depthBlock = 9;
+    tuning.columnBlock = 20;
+    tuning.rowBlock = 7;
+
+    SquareMatrix narrow("[[1,-2][3,4]]");
+    REQUIRE(GemmKernel::choosePath(narrow, narrow, tuning) == GemmKernel::Narrow);
+    SquareMatrix huge("[[2147483647,-2147483648][1,0]]");
+    REQUIRE(GemmKernel::choosePath(huge, huge, tuning) == GemmKernel::Wide);
+    SquareMatrix wide("[[100000,-100000][1,0]]");
+    REQUIRE(GemmKernel::choosePath(wide, wide, tuning) == GemmKernel::Wide);
+    tuning.doubleKernel = true;
+    REQUIRE(GemmKernel::choosePath(wide, wide, tuning) == GemmKernel::Double);
+    REQUIRE(GemmKernel::choosePath(huge, huge, tuning) == GemmKernel::Wide);
+    GemmKernel::Range range = GemmKernel::range(huge);
+    REQUIRE(range.low == -2147483648);
+    REQUIRE(range.high == 2147483647);
+
+    for(size_t n : {1, 2, 19, 40})
+    {
+        // values above 16 bits whose products need more than 32 bits, so the result wraps
+        SquareMatrix a(static_cast<int>(n)), b(static_cast<int>(n));
+        for(size_t i = 0; i < n; i++)
+        {
+            for(size_t j = 0; j < n; j++)
+            {
+                a.setElement(i, j, IntElement(static_cast<int>(i * 40503 + j * 9973) % 800000 - 400000));
+                b.setElement(i, j, IntElement(399999 - static_cast<int>(i * 7919 + j * 104729) % 800000));
+            }
+        }
+
+        for(int alpha : {1, -7, 65537})
+        {
+            std::vector<int> wide(n * n, 5), exact(n * n, 5);
+            GemmKernel::multiply(0, n, 0, n, alpha, a, b, wide.data(), n, tuning, GemmKernel::Wide);
+            GemmKernel::multiply(0, n, 0, n, alpha, a, b, exact.data(), n, tuning, GemmKernel::Double);
+            REQUIRE(wide == exact);
+        }
+
+        Tuning::Profile original = Tuning::getProfile();
+        Tuning::Profile exact = original;
+        exact.doubleKernel = true;
+        Tuning::setProfile(exact);
+        SquareMatrix product = a * b;
+        Tuning::setProfile(original);
+        std::vector<int> wide(n * n, 0);
+        GemmKernel::multiply(0, n, 0, n, 1, a, b, wide.data(), n, tuning, GemmKernel::Wide);
+        for(size_t i = 0; i < n; i++)
+        {
+            for(size_t j = 0; j < n; j++)
+            {
+                REQUIRE(product.getElement(i, j).getVal() == wide[i * n + j]);
+            }
+        }
+    }
+}
@@ -0,0 +1,424 @@
+#include "intvector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ *  @file intvector.cpp
+ *  @brief Implementation of IntVector
+ *  */
+
+ /**
+ *  @class IntVector
+ *  @version 1.0
+ *  @brief Vector of n integers for matrix-vector products of iterative methods, which would waste n times the work as
+ *      products of square matrices. Arithmetic wraps modulo 2<SUP>32</SUP> like operator* of SquareMatrix, so A x is
+ *      the first column of A X when x is the first column of X. Matrix-vector products read the matrix once, rows in
+ *      blocks of 4 that share the loads of x, and split rows between workers. Vector-matrix products split columns
+ *      between workers, each streaming its columns of every row into its part of the result
+ *  @author Niko Lehto
+ *  */
+
+const size_t IntVector::rowBlock;
+
+#if defined(__AVX2__)
+/**
+ *  \brief Sum of the 8 lanes modulo 2<SUP>32</SUP>
+ *  \param [in] v __m256i lanes
+ *  \return int sum
+ */
+static int horizontalSum(__m256i v)
+{
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+/**
+ *  \brief Empty constructor, vector of dimension 0
+ */
+IntVector::IntVector() = default;
+
+/**
+ *  \brief Constructor of a vector with all elements equal
+ *  \param [in] n int dimension of vector
+ *  \param [in] value int value of every element
+ */
+IntVector::IntVector(int n, int value)
+{
+    if(n < 0)
+    {
+        throw std::invalid_argument("Vector dimension can not be negative");
+    }
+    this->elements.assign(n, value);
+}
+
+/**
+ *  \brief Constructs a vector from string of the form [a<SUB>1</SUB>,...,a<SUB>n</SUB>]
+ *  \param [in] s const std::string& string presentation of vector, [] is the empty vector
+ */
+IntVector::IntVector(const std::string& s)
+{
+    fromString(s);
+}
+
+/**
+ *  \brief Destructor
+ */
+IntVector::~IntVector() = default;
+
+/**
+ *  \brief Parses elements from string of the form [a<SUB>1</SUB>,...,a<SUB>n</SUB>]
+ *  \param [in] vector const std::string& string presentation of vector
+ */
+void IntVector::fromString(const std::string& vector)
+{
+    size_t illegal_char = vector.find_first_not_of("[]0123456789.,+-");
+    if(illegal_char != std::string::npos)
+    {
+        throw std::invalid_argument("Illegal character in vector: \"" + vector.substr(illegal_char, 1) + "\" ");
+    }
+    if(vector.length() < 2 || vector.front() != '[' || vector.back() != ']' || vector.find_first_of("[]", 1) != vector.length() - 1)
+    {
+        throw std::invalid_argument("Vector should be of the form [a1,...,an]");
+    }
+
+    std::vector<int> values;
+    size_t len = vector.length();
+    for(size_t elem_start_idx = 1; len > 2 && elem_start_idx < len;)
+    {
+        size_t elem_end_idx = std::min(vector.find(',', elem_start_idx), len - 1);
+        values.push_back(IntElement(vector.substr(elem_start_idx, elem_end_idx - elem_start_idx)).getVal());
+        elem_start_idx = elem_end_idx + 1;
+    }
+    this->elements = values;
+}
+
+/**
+ *  \brief Getter for dimension
+ *  \return int number of elements
+ */
+int IntVector::getDimension() const
+{
+    return static_cast<int>(elements.size());
+}
+
+/**
+ *  \brief Getter for element
+ *  \param [in] i size_t index
+ *  \return IntElement element i
+ */
+IntElement IntVector::getElement(size_t i) const
+{
+    if(i >= elements.size())
+    {
+        throw std::out_of_range("Element index out of vector");
+    }
+    return IntElement(elements[i]);
+}
+
+/**
+ *  \brief Setter for element
+ *  \param [in] i size_t index
+ *  \param [in] value const IntElement& new value
+ */
+void IntVector::setElement(size_t i, const IntElement& value)
+{
+    if(i >= elements.size())
+    {
+        throw std::out_of_range("Element index out of vector");
+    }
+    elements[i] = value.getVal();
+}
+
+/**
+ *  \brief Elements in order
+ *  \return const int* first element
+ */
+const int* IntVector::data() const
+{
+    return elements.data();
+}
+
+/**
+ *  \brief Sum of a<SUB>j</SUB> b<SUB>j</SUB> modulo 2<SUP>32</SUP>
+ *  \param [in] a const int* first operand
+ *  \param [in] b const int* second operand
+ *  \param [in] count size_t number of elements
+ *  \return int sum of products
+ */
+int IntVector::dotKernel(const int* a, const int* b, size_t count)
+{
+    size_t j = 0;
+    unsigned int sum = 0;
+#if defined(__AVX2__)
+    __m256i sum0 = _mm256_setzero_si256();
+    __m256i sum1 = _mm256_setzero_si256();
+    for(; j + 16 <= count; j += 16)
+    {
+        sum0 = _mm256_add_epi32(sum0, _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + j)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j))));
+        sum1 = _mm256_add_epi32(sum1, _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + j + 8)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j + 8))));
+    }
+    sum = static_cast<unsigned int>(horizontalSum(_mm256_add_epi32(sum0, sum1)));
+#endif
+    for(; j < count; j++)
+    {
+        sum += static_cast<unsigned int>(a[j]) * static_cast<unsigned int>(b[j]);
+    }
+    return static_cast<int>(sum);
+}
+
+/**
+ *  \brief Dot products of rowBlock rows with x, each load of x is shared by all rows
+ *  \param [in] rows const int* const* rowBlock rows of count elements
+ *  \param [in] x const int* vector
+ *  \param [in] count size_t number of elements
+ *  \param [out] y int* rowBlock sums of products modulo 2<SUP>32</SUP>
+ */
+void IntVector::dotRows(const int* const* rows, const int* x, size_t count, int* y)
+{
+    size_t j = 0;
+    unsigned int sums[rowBlock] = {};
+#if defined(__AVX2__)
+    __m256i sum[rowBlock];
+    for(size_t r = 0; r < rowBlock; r++)
+    {
+        sum[r] = _mm256_setzero_si256();
+    }
+    for(; j + 8 <= count; j += 8)
+    {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j));
+        for(size_t r = 0; r < rowBlock; r++)
+        {
+            sum[r] = _mm256_add_epi32(sum[r], _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + j)), value));
+        }
+    }
+    for(size_t r = 0; r < rowBlock; r++)
+    {
+        sums[r] = static_cast<unsigned int>(horizontalSum(sum[r]));
+    }
+#endif
+    for(; j < count; j++)
+    {
+        unsigned int value = static_cast<unsigned int>(x[j]);
+        for(size_t r = 0; r < rowBlock; r++)
+        {
+            sums[r] += static_cast<unsigned int>(rows[r][j]) * value;
+        }
+    }
+    for(size_t r = 0; r < rowBlock; r++)
+    {
+        y[r] = static_cast<int>(sums[r]);
+    }
+}
+
+/**
+ *  \brief y += alpha * x modulo 2<SUP>32</SUP>
+ *  \param [in,out] y int* elements to add into
+ *  \param [in] alpha int scale of x
+ *  \param [in] x const int* elements to add
+ *  \param [in] count size_t number of elements
+ */
+void IntVector::axpyKernel(int* y, int alpha, const int* x, size_t count)
+{
+    size_t j = 0;
+#if defined(__AVX2__)
+    __m256i scale = _mm256_set1_epi32(alpha);
+    for(; j + 8 <= count; j += 8)
+    {
+        __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + j)), _mm256_mullo_epi32(scale, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + j), sum);
+    }
+#endif
+    for(; j < count; j++)
+    {
+        y[j] = static_cast<int>(static_cast<unsigned int>(y[j]) + static_cast<unsigned int>(alpha) * static_cast<unsigned int>(x[j]));
+    }
+}
+
+/**
+ *  \brief Matrix-vector product
+ *  \param [in] a const SquareMatrixView& matrix
+ *  \param [in] x const IntVector& vector of same dimension as a
+ *  \return IntVector a x, element i is the dot product of row i of a with x
+ */
+IntVector IntVector::multiply(const SquareMatrixView& a, const IntVector& x)
+{
+    if(a.getDimension() != x.getDimension())
+    {
+        throw std::invalid_argument("operator requires same sized matrix and vector");
+    }
+
+    size_t t_n = x.elements.size();
+    IntVector result(x.getDimension());
+    const int* source = x.elements.data();
+    int* target = result.elements.data();
+
+    SquareMatrix::runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        size_t i = worker_start;
+        for(; i + rowBlock <= worker_stop; i += rowBlock)
+        {
+            const int* rows[rowBlock];
+            for(size_t r = 0; r < rowBlock; r++)
+            {
+                rows[r] = a.row(i + r);
+            }
+            dotRows(rows, source, t_n, target + i);
+        }
+        for(; i < worker_stop; i++)
+        {
+            target[i] = dotKernel(a.row(i), source, t_n);
+        }
+    });
+    return result;
+}
+
+/**
+ *  \brief Vector-matrix product
+ *  \param [in] x const IntVector& vector of same dimension as a
+ *  \param [in] a const SquareMatrixView& matrix
+ *  \return IntVector x<SUP>T</SUP> a, element j is the dot product of x with column j of a
+ */
+IntVector IntVector::multiply(const IntVector& x, const SquareMatrixView& a)
+{
+    if(a.getDimension() != x.getDimension())
+    {
+        throw std::invalid_argument("operator requires same sized matrix and vector");
+    }
+
+    size_t t_n = x.elements.size();
+    IntVector result(x.getDimension());
+    const int* source = x.elements.data();
+    int* target = result.elements.data();
+
+    // worker ranges are columns here, rows of a are added in order into the worker's part of the result
+    SquareMatrix::runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = 0; i < t_n; i++)
+        {
+            if(source[i] != 0)
+            {
+                axpyKernel(target + worker_start, source[i], a.row(i) + worker_start, worker_stop - worker_start);
+            }
+        }
+    });
+    return result;
+}
+
+/**
+ *  \brief Dot product
+ *  \param [in] x const IntVector& first operand
+ *  \param [in] y const IntVector& second operand of same dimension
+ *  \return int sum of x<SUB>j</SUB> y<SUB>j</SUB> modulo 2<SUP>32</SUP>
+ */
+int IntVector::dot(const IntVector& x, const IntVector& y)
+{
+    if(x.elements.size() != y.elements.size())
+    {
+        throw std::invalid_argument("operator requires same sized vectors");
+    }
+
+    std::atomic<unsigned int> sum(0);
+    SquareMatrix::runParallel(x.elements.size(), 1, [&](size_t worker_start, size_t worker_stop)
+    {
+        sum += static_cast<unsigned int>(dotKernel(x.elements.data() + worker_start, y.elements.data() + worker_start, worker_stop - worker_start));
+    });
+    return static_cast<int>(sum.load());
+}
+
+/**
+ *  \brief Scaled addition y = alpha * x + y into existing vector
+ *  \param [in,out] y IntVector& vector to add into
+ *  \param [in] alpha int scale of x
+ *  \param [in] x const IntVector& vector to add, same dimension as y
+ */
+void IntVector::axpy(IntVector& y, int alpha, const IntVector& x)
+{
+    if(y.elements.size() != x.elements.size())
+    {
+        throw std::invalid_argument("operator requires same sized vectors");
+    }
+
+    SquareMatrix::runParallel(y.elements.size(), 1, [&](size_t worker_start, size_t worker_stop)
+    {
+        axpyKernel(y.elements.data() + worker_start, alpha, x.elements.data() + worker_start, worker_stop - worker_start);
+    });
+}
+
+/**
+ *  \brief Write object to stream in form of [a<SUB>1</SUB>,...,a<SUB>n</SUB>]
+ *  \param [out] stream std::ostream& output stream
+ */
+void IntVector::print(std::ostream& stream) const
+{
+    stream << *this;
+}
+
+/**
+ *  \brief Write object to string in form of [a<SUB>1</SUB>,...,a<SUB>n</SUB>]
+ *  \return std::string presentation of vector
+ */
+std::string IntVector::toString() const
+{
+    std::stringstream result;
+    result << *this;
+    return result.str();
+}
+
+/**
+ *  \brief Overload of equal comparison
+ *  \param [in] v const IntVector& value for comparison
+ *  \return bool true if dimensions and all elements are the same
+ */
+bool IntVector::operator==(const IntVector& v) const
+{
+    return this->elements == v.elements;
+}
+
+/**
+ *  \brief Matrix-vector product
+ *  \param [in] a const SquareMatrixView& matrix
+ *  \param [in] x const IntVector& vector
+ *  \return IntVector a x
+ */
+IntVector operator*(const SquareMatrixView& a, const IntVector& x)
+{
+    return IntVector::multiply(a, x);
+}
+
+/**
+ *  \brief Vector-matrix product
+ *  \param [in] x const IntVector& vector
+ *  \param [in] a const SquareMatrixView& matrix
+ *  \return IntVector x<SUP>T</SUP> a
+ */
+IntVector operator*(const IntVector& x, const SquareMatrixView& a)
+{
+    return IntVector::multiply(x, a);
+}
+
+/**
+ *  \brief Overload of stream output
+ *  \param [out] stream std::ostream& output stream
+ *  \param [in] v const IntVector& vector to print in form of [a<SUB>1</SUB>,...,a<SUB>n</SUB>]
+ *  \return std::ostream& stream
+ */
+std::ostream& operator<<(std::ostream& stream, const IntVector& v)
+{
+    stream << "[";
+    for(size_t i = 0; i < v.elements.size(); i++)
+    {
+        stream << (i == 0 ? "" : ",") << v.elements[i];
+    }
+    stream << "]";
+    return stream;
+}
@@ -0,0 +1,53 @@
+#ifndef INTVECTOR_H
+#define INTVECTOR_H
+
+#include "intelement.h"
+#include "squarematrix.h"
+#include "squarematrixview.h"
+
+#include <sstream>
+#include <vector>
+
+/**
+ * @file intvector.h
+ * @version 1.0
+ * @brief Declaration of IntVector
+ * @author Niko Lehto
+ */
+class IntVector
+{
+public:
+    static const size_t rowBlock = 4; ///< rows of a matrix multiplied with a vector in one pass over it
+
+private:
+	std::vector<int> elements;
+
+	void fromString(const std::string& s);
+	static int dotKernel(const int* a, const int* b, size_t count);
+	static void dotRows(const int* const* rows, const int* x, size_t count, int* y);
+	static void axpyKernel(int* y, int alpha, const int* x, size_t count);
+
+public:
+	IntVector();
+	explicit IntVector(int n, int value = 0);
+	IntVector(const std::string& s);
+	~IntVector();
+
+	int getDimension() const;
+	IntElement getElement(size_t i) const;
+	void setElement(size_t i, const IntElement& value);
+	const int* data() const;
+	void print(std::ostream& os) const;
+	std::string toString() const;
+
+	static IntVector multiply(const SquareMatrixView& a, const IntVector& x);
+	static IntVector multiply(const IntVector& x, const SquareMatrixView& a);
+	static int dot(const IntVector& x, const IntVector& y);
+	static void axpy(IntVector& y, int alpha, const IntVector& x);
+
+	bool operator==(const IntVector& v) const;
+	friend IntVector operator*(const SquareMatrixView& a, const IntVector& x);
+	friend IntVector operator*(const IntVector& x, const SquareMatrixView& a);
+	friend std::ostream& operator<<(std::ostream& stream, const IntVector& v);
+};
+#endif
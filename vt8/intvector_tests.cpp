@@ -0,0 +1,68 @@
+#include "catch.hpp"
+#include "intvector.h"
+
+/**
+ *  @file intvector_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for IntVector class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for IntVector, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("IntVector", "[IntVector]")
+{
+    IntVector x("[1,2,3]");
+    REQUIRE(x.getDimension() == 3);
+    REQUIRE(x.toString() == "[1,2,3]");
+    REQUIRE(IntVector("[]").getDimension() == 0);
+    REQUIRE(IntVector(2, 7) == IntVector("[7,7]"));
+    REQUIRE(IntVector(3) == IntVector("[0,0,0]"));
+
+    SquareMatrix a("[[1,2,3][4,5,6][7,8,10]]");
+    REQUIRE(a * x == IntVector("[14,32,53]"));
+    REQUIRE(x * a == IntVector("[30,36,45]"));
+    REQUIRE(a.block(1, 1, 2) * IntVector("[1,-1]") == IntVector("[-1,-2]"));
+    REQUIRE(IntVector::dot(x, IntVector("[4,-5,6]")) == 12);
+
+    IntVector y("[1,1,1]");
+    IntVector::axpy(y, 2, x);
+    REQUIRE(y == IntVector("[3,5,7]"));
+    y.setElement(0, IntElement(-4));
+    REQUIRE(y.getElement(0) == IntElement(-4));
+
+    // sizes around SIMD widths and row blocks against columns of dense products
+    for(int n : {1, 5, 8, 17, 100, 1001})
+    {
+        SquareMatrix m(n), columns(n);
+        IntVector v(n), w(n);
+        for(int i = 0; i < n; i++)
+        {
+            v.setElement(i, columns.getElement(i, 0));
+            w.setElement(i, columns.getElement(i, 1 % n));
+        }
+        SquareMatrix product = m * columns;
+        SquareMatrix transposed = columns.transpose() * m;
+        IntVector mv = m * v;
+        IntVector vm = v * m;
+        int expected = 0;
+        for(int i = 0; i < n; i++)
+        {
+            REQUIRE(mv.getElement(i) == product.getElement(i, 0));
+            REQUIRE(vm.getElement(i) == transposed.getElement(0, i));
+            expected = static_cast<int>(static_cast<unsigned int>(expected) + static_cast<unsigned int>(v.getElement(i).getVal()) * static_cast<unsigned int>(w.getElement(i).getVal()));
+        }
+        REQUIRE(IntVector::dot(v, w) == expected);
+        REQUIRE(IntVector::dot(v, w) == IntVector::dot(w, v));
+    }
+
+    REQUIRE_THROWS_AS(x.getElement(3), std::out_of_range);
+    REQUIRE_THROWS_AS(IntVector("[1,,2]"), std::invalid_argument);
+    REQUIRE_THROWS_AS(IntVector("[[1]]"), std::invalid_argument);
+    REQUIRE_THROWS_AS(IntVector(-1), std::invalid_argument);
+    REQUIRE_THROWS_WITH(SquareMatrix(2) * x, "operator requires same sized matrix and vector");
+    REQUIRE_THROWS_WITH(IntVector::dot(x, IntVector(2)), "operator requires same sized vectors");
+    REQUIRE_THROWS_WITH(IntVector::axpy(y, 1, IntVector(2)), "operator requires same sized vectors");
+}
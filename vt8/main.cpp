@@ -2,6 +2,11 @@
 #include "catch.hpp"
 #include "intelement.h"
 #include "squarematrix.h"
+#include "matrixpool.h"
+#include "gemmkernel.h"
+#include "matrixexpression.h"
+#include "numatopology.h"
+#include "tuning.h"
 #include <chrono>
 
 /**
@@ -37,8 +42,10 @@ single-thread
 */
 void benchmark(int multi_n, int other_n)
 {
-    unsigned int threadsSupported = std::thread::hardware_concurrency();
-    std::cout << "Threads detected: " << threadsSupported << std::endl;
+    unsigned int threadsSupported = SquareMatrix::getParallelStats().maxThreads;
+    std::cout << "Threads used: " << threadsSupported << std::endl;
+    std::cout << "NUMA nodes detected: " << NumaTopology::instance().getNodeCount() << std::endl;
+    std::cout << "multiplication kernel: " << GemmKernel::getName() << std::endl;
 
     std::chrono::time_point<std::chrono::system_clock> t0, t1, t2;
     std::chrono::duration<double> elapsed_seconds;
@@ -53,6 +60,7 @@ void benchmark(int multi_n, int other_n)
     t2 = std::chrono::system_clock::now();
     elapsed_seconds = t2 - t1;
     std::cout << "constructors took: " << elapsed_seconds.count() << '\n';
+    std::cout << "large matrix memory: " << MatrixPool::backingName(o_a.getBacking()) << '\n';
     t1 = std::chrono::system_clock::now();
 
     result = o_a + o_b;
@@ -87,12 +95,34 @@ void benchmark(int multi_n, int other_n)
     t2 = std::chrono::system_clock::now();
     elapsed_seconds = t2 - t1;
     std::cout << "multiplication and transpose took: " << elapsed_seconds.count() << '\n';
+    t1 = std::chrono::system_clock::now();
+
+    // same additions as one expression: three passes instead of seven
+    MatrixExpression lazy_a(o_a), lazy_b(o_b);
+    MatrixExpression lazy_sum = lazy_a + lazy_b + lazy_a + lazy_b;
+    MatrixExpression lazy_twice = lazy_sum + lazy_sum + lazy_a + lazy_b;
+    result = (lazy_twice + lazy_twice).eval();
+
+    t2 = std::chrono::system_clock::now();
+    elapsed_seconds = t2 - t1;
+    std::cout << "lazy addition took: " << elapsed_seconds.count() << '\n';
+    t1 = std::chrono::system_clock::now();
+
+    MatrixExpression lazy_ma(m_a), lazy_mb(m_b);
+    result = (lazy_ma * lazy_mb.transpose() * lazy_ma).eval();
+
+    t2 = std::chrono::system_clock::now();
+    elapsed_seconds = t2 - t1;
+    std::cout << "lazy multiplication and transpose took: " << elapsed_seconds.count() << '\n';
 
 
     t2 = std::chrono::system_clock::now();
     elapsed_seconds = t2-t0;
     std::cout << "benchmark took: " << elapsed_seconds.count() << '\n';
 
+    MatrixPool::Stats poolStats = MatrixPool::instance().getStats();
+    std::cout << "buffer pool hits: " << poolStats.hits << ", misses: " << poolStats.misses << '\n';
+
 }
 
 /**
@@ -113,11 +143,23 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    else if(std::string(argv[1]) == "--autotune" || std::string(argv[1]) == "-t")
+    {
+        Tuning::Profile best = Tuning::autotune(1000, &std::cout);
+        Tuning::save(best, Tuning::defaultPath());
+        std::cout << "saved tuning profile to " << Tuning::defaultPath() << std::endl;
+        return 0;
+    }
+
     else
     {
         std::cout << "usage: \n"
                     << "  no arguments    : run catch tests \n"
-                    << "  -b  --benchmark : run benchmark \n" << std::endl;
+                    << "  -b  --benchmark : run benchmark \n"
+                    << "  -t  --autotune  : measure and save tuning profile for this machine \n"
+                    << "environment: \n"
+                    << "  SQUAREMATRIX_THREADS : workers per operation, or serial \n"
+                    << "  SQUAREMATRIX_CPUS    : cpus workers may run on, e.g. 0-3,8 \n" << std::endl;
         return 1;
     }
 }
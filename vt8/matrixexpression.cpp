@@ -0,0 +1,517 @@
+#include "matrixexpression.h"
+#include "squarematrix.h"
+
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ *  @file matrixexpression.cpp
+ *  @brief Implementation of MatrixExpression
+ *  */
+
+ /**
+ *  @class MatrixExpression
+ *  @version 1.0
+ *  @brief Lazily evaluated formula of square matrices. Operators only record a DAG, eval() computes it:
+ *      chains of additions and substractions become one pass over all their terms, products inside such a chain
+ *      are accumulated into the sum by gemm instead of into temporaries, independent subexpressions run
+ *      concurrently as MatrixTasks, and a temporary is released, or overwritten in place by the sum reading it,
+ *      as soon as its last reader starts. A subexpression used several times is evaluated once
+ *  @author Niko Lehto
+ *  */
+
+/**
+ *  \brief Recorded operation, immutable once built so expressions can share it
+ */
+struct MatrixExpression::Node
+{
+    enum Operation { Leaf, Add, Substract, Multiply, Transpose };
+
+    Operation operation = Leaf;
+    int n = 0;
+    SquareMatrix value;                      // matrix of leaf
+    std::shared_ptr<const Node> left, right; // operands, transpose has only left
+
+    /**
+     *  \brief Tells if operation is elementwise addition or substraction
+     *  \return bool true for Add and Substract
+     */
+    bool isElementwise() const
+    {
+        return operation == Add || operation == Substract;
+    }
+};
+
+/**
+ *  \brief Nodes computed by one kernel run, and the matrix they produce
+ */
+struct MatrixExpression::Group
+{
+    struct Term
+    {
+        const Node* node; // root node of group whose value is read
+        int sign;
+    };
+    struct Product
+    {
+        const Node* left;
+        const Node* right;
+        int sign;
+    };
+
+    const Node* root = nullptr;
+    std::vector<Term> terms;       // sum: elementwise terms, product and transpose: operands
+    std::vector<Product> products; // sum: products accumulated into result
+    SquareMatrix value;
+    std::atomic<size_t> uses;      // reads of value by groups that have not finished yet
+    MatrixTask task;
+
+    Group() : uses(0)
+    {
+    }
+};
+
+/**
+ *  \brief Groups of one evaluation, kept alive by its tasks
+ */
+struct MatrixExpression::Plan
+{
+    std::shared_ptr<const Node> root;
+    std::unordered_map<const Node*, std::unique_ptr<Group>> groups;
+    std::unordered_map<const Node*, size_t> readers;    // edges into node
+    std::unordered_map<const Node*, bool> elementwiseReader; // single reader is addition or substraction
+    EvalStats stats;
+    std::atomic<size_t> reusedBuffers;
+
+    Plan() : reusedBuffers(0)
+    {
+    }
+
+    /**
+     *  \brief Tells if node is computed as part of the group of its reader
+     *  \param [in] node const Node* node
+     *  \return bool true for non-root additions, substractions and products read only by an addition or substraction
+     */
+    bool isAbsorbed(const Node* node) const
+    {
+        return node != root.get() && readers.at(node) == 1 && elementwiseReader.at(node)
+            && (node->isElementwise() || node->operation == Node::Multiply);
+    }
+
+    /**
+     *  \brief Getter for group that computes node
+     *  \param [in] node const Node* node that is not absorbed
+     *  \return Group& group
+     */
+    Group& groupOf(const Node* node)
+    {
+        return *groups.at(node);
+    }
+};
+
+/**
+ *  \brief Constructor for leaf expression
+ *  \param [in] m const SquareMatrix& matrix, shared with the expression
+ */
+MatrixExpression::MatrixExpression(const SquareMatrix& m)
+{
+    std::shared_ptr<Node> leaf = std::make_shared<Node>();
+    leaf->n = m.getDimension();
+    leaf->value = m;
+    node = leaf;
+}
+
+/**
+ *  \brief Private constructor for recorded operation
+ *  \param [in] node const std::shared_ptr<const Node>& operation
+ */
+MatrixExpression::MatrixExpression(const std::shared_ptr<const Node>& node) : node(node)
+{
+}
+
+/**
+ *  \brief Records binary operation
+ *  \param [in] operation int Node::Operation
+ *  \param [in] a const MatrixExpression& left operand
+ *  \param [in] b const MatrixExpression& right operand
+ *  \return MatrixExpression recorded operation
+ */
+MatrixExpression MatrixExpression::combine(int operation, const MatrixExpression& a, const MatrixExpression& b)
+{
+    if(a.getDimension() != b.getDimension())
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    std::shared_ptr<Node> result = std::make_shared<Node>();
+    result->operation = static_cast<Node::Operation>(operation);
+    result->n = a.getDimension();
+    result->left = a.node;
+    result->right = b.node;
+    return MatrixExpression(result);
+}
+
+/**
+ *  \brief Getter for dimension of result
+ *  \return int n
+ */
+int MatrixExpression::getDimension() const
+{
+    return node->n;
+}
+
+/**
+ *  \brief Records transpose
+ *  \return MatrixExpression transpose of this expression
+ */
+MatrixExpression MatrixExpression::transpose() const
+{
+    std::shared_ptr<Node> result = std::make_shared<Node>();
+    result->operation = Node::Transpose;
+    result->n = getDimension();
+    result->left = node;
+    return MatrixExpression(result);
+}
+
+/**
+ *  \brief Splits DAG into groups computed by one kernel each and counts reads of their values
+ *  \param [in] root const std::shared_ptr<const Node>& expression to evaluate
+ *  \return std::shared_ptr<Plan> groups, without tasks
+ */
+std::shared_ptr<MatrixExpression::Plan> MatrixExpression::plan(const std::shared_ptr<const Node>& root)
+{
+    std::shared_ptr<Plan> p = std::make_shared<Plan>();
+    p->root = root;
+
+    // readers of every node, and whether a single reader is elementwise
+    std::vector<const Node*> order; // every operand before its readers
+    std::unordered_set<const Node*> visited;
+    std::function<void(const Node*)> visit = [&](const Node* node)
+    {
+        visited.insert(node);
+        for(const Node* operand : {node->left.get(), node->right.get()})
+        {
+            if(operand == nullptr)
+            {
+                continue;
+            }
+            if(visited.count(operand) == 0)
+            {
+                visit(operand);
+            }
+            p->readers[operand]++;
+            p->elementwiseReader[operand] = node->isElementwise();
+        }
+        if(node->operation != Node::Leaf)
+        {
+            p->stats.operations++;
+        }
+        order.push_back(node);
+    };
+    p->readers[root.get()] = 0;
+    p->elementwiseReader[root.get()] = false;
+    visit(root.get());
+
+    for(const Node* node : order)
+    {
+        if(p->isAbsorbed(node))
+        {
+            continue;
+        }
+        std::unique_ptr<Group> g(new Group());
+        g->root = node;
+
+        if(node->operation == Node::Leaf)
+        {
+            g->value = node->value;
+        }
+        else if(node->isElementwise())
+        {
+            std::function<void(const Node*, int)> flatten = [&](const Node* term, int sign)
+            {
+                if(term == node || (term->isElementwise() && p->isAbsorbed(term)))
+                {
+                    flatten(term->left.get(), sign);
+                    flatten(term->right.get(), term->operation == Node::Substract ? -sign : sign);
+                }
+                else if(p->isAbsorbed(term))
+                {
+                    g->products.push_back({term->left.get(), term->right.get(), sign});
+                }
+                else
+                {
+                    g->terms.push_back({term, sign});
+                }
+            };
+            flatten(node, 1);
+            p->stats.fusedProducts += g->products.size();
+            p->stats.passes += (g->terms.empty() ? 0 : 1) + g->products.size();
+        }
+        else
+        {
+            g->terms.push_back({node->left.get(), 1});
+            if(node->right)
+            {
+                g->terms.push_back({node->right.get(), 1});
+            }
+            p->stats.passes++;
+        }
+        p->groups.emplace(node, std::move(g));
+    }
+
+    for(auto& entry : p->groups)
+    {
+        for(const Group::Term& term : entry.second->terms)
+        {
+            p->groupOf(term.node).uses++;
+        }
+        for(const Group::Product& product : entry.second->products)
+        {
+            p->groupOf(product.left).uses++;
+            p->groupOf(product.right).uses++;
+        }
+    }
+    return p;
+}
+
+/**
+ *  \brief Computes value of a group whose operands are ready, then releases operands read for the last time
+ *  \param [in,out] p Plan& plan of evaluation
+ *  \param [in,out] g Group& group to compute
+ */
+void MatrixExpression::evaluate(Plan& p, Group& g)
+{
+    const Node* node = g.root;
+    size_t t_n = node->n;
+    SquareMatrix result;
+
+    if(node->operation == Node::Multiply)
+    {
+        SquareMatrix product = p.groupOf(g.terms[0].node).value * p.groupOf(g.terms[1].node).value;
+        result.n = product.n;
+        result.elements.swap(product.elements);
+    }
+    else if(node->operation == Node::Transpose)
+    {
+        SquareMatrix transposed = p.groupOf(g.terms[0].node).value.transpose();
+        result.n = transposed.n;
+        result.elements.swap(transposed.elements);
+    }
+    else
+    {
+        // a temporary read only by this sum becomes the result, so its buffer is written in place
+        std::vector<Group::Term> terms = g.terms;
+        bool accumulate = false;
+        for(size_t k = 0; k < terms.size(); k++)
+        {
+            Group& operand = p.groupOf(terms[k].node);
+            if(terms[k].sign > 0 && operand.root->operation != Node::Leaf && operand.uses == 1)
+            {
+                result.n = operand.value.n;
+                result.elements.swap(operand.value.elements);
+                terms.erase(terms.begin() + k);
+                accumulate = true;
+                p.reusedBuffers++;
+                break;
+            }
+        }
+        if(!accumulate)
+        {
+            result.allocate(node->n);
+        }
+
+        std::vector<const int*> sources;
+        for(const Group::Term& term : terms)
+        {
+            sources.push_back(p.groupOf(term.node).value.elements.get());
+        }
+
+        if(!terms.empty())
+        {
+            SquareMatrix::runParallel(t_n, t_n * terms.size(), [&](size_t worker_start, size_t worker_stop)
+            {
+                for(size_t i = worker_start; i < worker_stop; i++)
+                {
+                    int* target = result.elements.get() + i * t_n;
+                    size_t k = 0;
+                    if(!accumulate)
+                    {
+                        const int* source = sources[0] + i * t_n;
+                        int sign = terms[0].sign;
+                        for(size_t j = 0; j < t_n; j++)
+                        {
+                            target[j] = sign * source[j];
+                        }
+                        k = 1;
+                    }
+                    for(; k < terms.size(); k++)
+                    {
+                        const int* source = sources[k] + i * t_n;
+                        if(terms[k].sign > 0)
+                        {
+                            for(size_t j = 0; j < t_n; j++)
+                            {
+                                target[j] += source[j];
+                            }
+                        }
+                        else
+                        {
+                            for(size_t j = 0; j < t_n; j++)
+                            {
+                                target[j] -= source[j];
+                            }
+                        }
+                    }
+                }
+            });
+            accumulate = true;
+        }
+
+        for(const Group::Product& product : g.products)
+        {
+            SquareMatrix::gemm(result, p.groupOf(product.left).value, p.groupOf(product.right).value, product.sign, accumulate ? 1 : 0);
+            accumulate = true;
+        }
+    }
+
+    g.value.n = result.n;
+    g.value.elements.swap(result.elements);
+
+    auto release = [&p](const Node* operand)
+    {
+        Group& done = p.groupOf(operand);
+        if(--done.uses == 0 && operand->operation != Node::Leaf)
+        {
+            done.value.elements.reset(); // back to MatrixPool for the next temporary
+        }
+    };
+    for(const Group::Term& term : g.terms)
+    {
+        release(term.node);
+    }
+    for(const Group::Product& product : g.products)
+    {
+        release(product.left);
+        release(product.right);
+    }
+}
+
+/**
+ *  \brief Starts groups of a plan as tasks depending on the tasks of their operands
+ *  \param [in] p const std::shared_ptr<Plan>& plan, kept alive by the tasks
+ *  \return MatrixTask task of result
+ */
+MatrixTask MatrixExpression::schedule(const std::shared_ptr<Plan>& p)
+{
+    const Node* rootNode = p->root.get();
+    Group& root = p->groupOf(rootNode);
+    if(rootNode->operation == Node::Leaf)
+    {
+        return MatrixTask(root.value);
+    }
+
+    std::unordered_set<const Node*> scheduled;
+    std::function<void(Group&)> start = [&](Group& g)
+    {
+        if(g.root->operation == Node::Leaf || !scheduled.insert(g.root).second)
+        {
+            return;
+        }
+
+        std::vector<const Node*> operands;
+        for(const Group::Term& term : g.terms)
+        {
+            operands.push_back(term.node);
+        }
+        for(const Group::Product& product : g.products)
+        {
+            operands.push_back(product.left);
+            operands.push_back(product.right);
+        }
+
+        std::vector<MatrixTask> dependencies;
+        for(const Node* operand : operands)
+        {
+            if(operand->operation != Node::Leaf)
+            {
+                Group& dependency = p->groupOf(operand);
+                start(dependency);
+                dependencies.push_back(dependency.task);
+            }
+        }
+
+        Group* target = &g;
+        bool isRoot = g.root == rootNode;
+        g.task = MatrixTask::when(dependencies, [p, target, isRoot](const std::vector<const SquareMatrix*>&)
+        {
+            evaluate(*p, *target);
+            return isRoot ? target->value : SquareMatrix();
+        });
+    };
+    start(root);
+    return root.task;
+}
+
+/**
+ *  \brief Starts evaluation of expression on the shared task pool
+ *  \return MatrixTask task of result
+ */
+MatrixTask MatrixExpression::evalAsync() const
+{
+    return schedule(plan(node));
+}
+
+/**
+ *  \brief Evaluates expression and waits for result
+ *  \param [out] stats EvalStats* what evaluation did, may be nullptr
+ *  \return SquareMatrix value of expression
+ */
+SquareMatrix MatrixExpression::eval(EvalStats* stats) const
+{
+    std::shared_ptr<Plan> p = plan(node);
+    SquareMatrix result = schedule(p).get();
+
+    if(stats != nullptr)
+    {
+        *stats = p->stats;
+        stats->reusedBuffers = p->reusedBuffers;
+    }
+    return result;
+}
+
+/**
+ *  \brief Records addition
+ *  \param [in] a const MatrixExpression& left operand
+ *  \param [in] b const MatrixExpression& right operand
+ *  \return MatrixExpression a + b
+ */
+MatrixExpression operator+(const MatrixExpression& a, const MatrixExpression& b)
+{
+    return MatrixExpression::combine(MatrixExpression::Node::Add, a, b);
+}
+
+/**
+ *  \brief Records substraction
+ *  \param [in] a const MatrixExpression& left operand
+ *  \param [in] b const MatrixExpression& right operand
+ *  \return MatrixExpression a - b
+ */
+MatrixExpression operator-(const MatrixExpression& a, const MatrixExpression& b)
+{
+    return MatrixExpression::combine(MatrixExpression::Node::Substract, a, b);
+}
+
+/**
+ *  \brief Records multiplication
+ *  \param [in] a const MatrixExpression& left operand
+ *  \param [in] b const MatrixExpression& right operand
+ *  \return MatrixExpression a * b
+ */
+MatrixExpression operator*(const MatrixExpression& a, const MatrixExpression& b)
+{
+    return MatrixExpression::combine(MatrixExpression::Node::Multiply, a, b);
+}
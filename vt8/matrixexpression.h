@@ -0,0 +1,52 @@
+#ifndef MATRIXEXPRESSION_H
+#define MATRIXEXPRESSION_H
+
+#include "matrixtask.h"
+
+#include <cstddef>
+#include <memory>
+
+class SquareMatrix;
+
+/**
+ * @file matrixexpression.h
+ * @version 1.0
+ * @brief Declaration of MatrixExpression
+ * @author Niko Lehto
+ */
+class MatrixExpression
+{
+public:
+    struct EvalStats
+    {
+        size_t operations = 0;    ///< operators in the expression, shared subexpressions counted once
+        size_t passes = 0;        ///< kernels run over whole matrices
+        size_t fusedProducts = 0; ///< products accumulated into a sum instead of a temporary of their own
+        size_t reusedBuffers = 0; ///< temporaries overwritten in place by the sum reading them last
+    };
+
+private:
+    struct Node;
+    struct Group;
+    struct Plan;
+    std::shared_ptr<const Node> node;
+
+    explicit MatrixExpression(const std::shared_ptr<const Node>& node);
+    static MatrixExpression combine(int operation, const MatrixExpression& a, const MatrixExpression& b);
+    static std::shared_ptr<Plan> plan(const std::shared_ptr<const Node>& root);
+    static void evaluate(Plan& p, Group& g);
+    static MatrixTask schedule(const std::shared_ptr<Plan>& p);
+
+public:
+    MatrixExpression(const SquareMatrix& m);
+
+    int getDimension() const;
+    MatrixExpression transpose() const;
+    SquareMatrix eval(EvalStats* stats = nullptr) const;
+    MatrixTask evalAsync() const;
+
+    friend MatrixExpression operator+(const MatrixExpression& a, const MatrixExpression& b);
+    friend MatrixExpression operator-(const MatrixExpression& a, const MatrixExpression& b);
+    friend MatrixExpression operator*(const MatrixExpression& a, const MatrixExpression& b);
+};
+#endif
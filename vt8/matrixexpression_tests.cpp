@@ -0,0 +1,54 @@
+#include "catch.hpp"
+#include "matrixexpression.h"
+#include "squarematrix.h"
+
+/**
+ *  @file matrixexpression_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for MatrixExpression class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for MatrixExpression, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("MatrixExpression", "[MatrixExpression]")
+{
+    SquareMatrix a(40), b(40), c(40), d(40);
+    MatrixExpression A(a), B(b), C(c), D(d);
+    MatrixExpression::EvalStats stats;
+
+    // product accumulated into the one pass computing c - d
+    REQUIRE((A * B.transpose() * A + C - D).eval(&stats) == a * b.transpose() * a + c - d);
+    REQUIRE(stats.operations == 5);
+    REQUIRE(stats.fusedProducts == 1);
+    REQUIRE(stats.passes == 4);
+
+    // chain of additions is one pass, shared subexpression is computed once and its buffer reused
+    MatrixExpression sum = A + B + A + B;
+    MatrixExpression doubled = sum + sum + A + B;
+    SquareMatrix expected_sum = a + b + a + b;
+    SquareMatrix expected_doubled = expected_sum + expected_sum + a + b;
+    REQUIRE((doubled + doubled).eval(&stats) == expected_doubled + expected_doubled);
+    REQUIRE(stats.operations == 7);
+    REQUIRE(stats.passes == 3);
+    REQUIRE(stats.fusedProducts == 0);
+
+    // sum of products only, substraction of a product, leaf and single operation
+    REQUIRE((A * B - C * D).eval(&stats) == a * b - c * d);
+    REQUIRE(stats.passes == 2);
+    REQUIRE((C - A * B).eval() == c - a * b);
+    REQUIRE((A - (B - C)).eval() == a - (b - c));
+    REQUIRE(A.eval() == a);
+    REQUIRE((A * B).evalAsync().get() == a * b);
+
+    // temporary read only by the sum is overwritten in place
+    REQUIRE(((A * B) * C + D + (A * B) * C).eval(&stats) == (a * b) * c + d + (a * b) * c);
+    REQUIRE(stats.reusedBuffers == 0);
+    MatrixExpression product = A * B;
+    REQUIRE(((product * C).transpose() + D).eval(&stats) == (a * b * c).transpose() + d);
+    REQUIRE(stats.reusedBuffers == 1);
+
+    REQUIRE_THROWS_WITH(A + MatrixExpression(SquareMatrix("[[1]]")), "operator requires same sized matrices");
+}
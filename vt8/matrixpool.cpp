@@ -0,0 +1,418 @@
+#include "matrixpool.h"
+#include "numatopology.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ *  @file matrixpool.cpp
+ *  @brief Implementation of MatrixPool
+ *  */
+
+ /**
+ *  @class MatrixPool
+ *  @version 1.0
+ *  @brief Process wide pool of aligned element buffers. Released buffers are kept in size classes and
+ *      handed out again to matrices of the same size, so temporaries of matrix operations do not hit malloc.
+ *      Buffers from the huge page threshold up are mapped 2 MiB aligned and backed by huge pages when the
+ *      system allows it, which keeps strided access over large matrices from missing the TLB.
+ *      Buffers asked for a NUMA node are always mapped and bound to it, and are cached and reused per node.
+ *      On machines with several nodes, mapped buffers without a node are not cached: a reused buffer keeps the
+ *      placement of its earlier owner, a new one is placed by the workers that first write its rows
+ *  @author Niko Lehto
+ *  */
+
+const int MatrixPool::anyNode;
+const size_t MatrixPool::alignment;
+const size_t MatrixPool::hugePageSize;
+
+/**
+ *  \brief Small size classes grow by powers of two, large ones by this step to keep waste under 1%
+ */
+static const size_t largeClassStep = MatrixPool::hugePageSize;
+
+/**
+ *  \brief Private constructor, use instance()
+ */
+MatrixPool::MatrixPool()
+{
+    cacheLimit = 1024 * 1024 * 1024; // 1 GiB
+    hugePageMode = TransparentOnly;
+    hugePageThreshold = hugePageSize;
+}
+
+/**
+ *  \brief Getter for the process wide pool. Never destroyed so that matrices with static storage can release safely
+ *  \return MatrixPool& the pool
+ */
+MatrixPool& MatrixPool::instance()
+{
+    static MatrixPool* pool = new MatrixPool();
+    return *pool;
+}
+
+/**
+ *  \brief Rounds requested size up to its size class
+ *  \param [in] bytes size_t requested size in bytes
+ *  \return size_t size of the buffer that will be allocated
+ */
+size_t MatrixPool::sizeClass(size_t bytes)
+{
+    if(bytes <= alignment)
+    {
+        return alignment;
+    }
+    if(bytes >= largeClassStep)
+    {
+        return (bytes + largeClassStep - 1) / largeClassStep * largeClassStep;
+    }
+    size_t size = alignment;
+    while(size < bytes)
+    {
+        size *= 2;
+    }
+    return size;
+}
+
+/**
+ *  \brief Allocates an uninitialized buffer for count ints. The buffer returns to the pool when last owner releases it
+ *  \param [in] count size_t number of ints
+ *  \param [in] node int NUMA node index whose memory holds the buffer, anyNode to leave placement to first touch
+ *  \return std::shared_ptr<int> buffer aligned to MatrixPool::alignment, empty if count is 0
+ */
+std::shared_ptr<int> MatrixPool::allocate(size_t count, int node)
+{
+    if(count == 0)
+    {
+        return std::shared_ptr<int>();
+    }
+
+    size_t bytes = sizeClass(count * sizeof(int));
+    int* buffer = nullptr;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = freeBuffers.find(std::make_pair(node, bytes));
+        if(found != freeBuffers.end() && !found->second.empty())
+        {
+            buffer = found->second.back();
+            found->second.pop_back();
+            stats.cachedBytes -= bytes;
+            stats.hits++;
+        }
+        else
+        {
+            stats.misses++;
+        }
+    }
+
+    if(buffer == nullptr)
+    {
+        buffer = allocateBuffer(bytes, node);
+        if(buffer == nullptr)
+        {
+            trim();
+            buffer = allocateBuffer(bytes, node);
+        }
+        if(buffer == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    return std::shared_ptr<int>(buffer, [this, bytes, node](int* p)
+    {
+        release(p, bytes, node);
+    });
+}
+
+/**
+ *  \brief Takes buffer back for reuse, or frees it if the cache limit would be exceeded
+ *  \param [in] buffer int* buffer given by allocate
+ *  \param [in] bytes size_t size class of buffer
+ *  \param [in] node int node the buffer was allocated for
+ */
+void MatrixPool::release(int* buffer, size_t bytes, int node)
+{
+    bool multiNode = NumaTopology::instance().getNodeCount() > 1;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stats.releases++;
+        bool placed = node == anyNode && multiNode && mappedBuffers.count(buffer) > 0;
+        if(!placed && stats.cachedBytes + bytes <= cacheLimit)
+        {
+            freeBuffers[std::make_pair(node, bytes)].push_back(buffer);
+            stats.cachedBytes += bytes;
+            return;
+        }
+        stats.dropped++;
+    }
+    freeBuffer(buffer, bytes);
+}
+
+/**
+ *  \brief Getter for pool statistics
+ *  \return Stats copy of current statistics
+ */
+MatrixPool::Stats MatrixPool::getStats() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+/**
+ *  \brief Zeroes hit, miss, release and drop counters. Cached bytes are kept
+ */
+void MatrixPool::resetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t cached = stats.cachedBytes;
+    stats = Stats();
+    stats.cachedBytes = cached;
+}
+
+/**
+ *  \brief Sets how many bytes of released buffers may be kept for reuse. Does not free already cached buffers
+ *  \param [in] bytes size_t cache limit, 0 disables caching
+ */
+void MatrixPool::setCacheLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    cacheLimit = bytes;
+}
+
+/**
+ *  \brief Getter for cache limit
+ *  \return size_t bytes of released buffers that may be kept for reuse
+ */
+size_t MatrixPool::getCacheLimit() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return cacheLimit;
+}
+
+/**
+ *  \brief Frees all cached buffers
+ */
+void MatrixPool::trim()
+{
+    std::map<std::pair<int, size_t>, std::vector<int*>> buffers;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        buffers.swap(freeBuffers);
+        stats.cachedBytes = 0;
+    }
+    for(auto& sizeClass : buffers)
+    {
+        for(int* buffer : sizeClass.second)
+        {
+            freeBuffer(buffer, sizeClass.first.second);
+        }
+    }
+}
+
+/**
+ *  \brief Checks whether the kernel may back advised mappings with transparent huge pages
+ *  \return bool false if transparent huge pages are disabled or unknown
+ */
+static bool transparentHugePagesEnabled()
+{
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string setting;
+    if(!std::getline(file, setting))
+    {
+        return false;
+    }
+    return setting.find("[never]") == std::string::npos;
+}
+
+/**
+ *  \brief Gets new memory. Buffers of at least huge page threshold are mapped and try to get huge pages
+ *      as allowed by the huge page mode, others come from aligned heap allocation. Buffers for a node are always
+ *      mapped and bound to the node before they are touched
+ *  \param [in] bytes size_t size class of buffer
+ *  \param [in] node int node index or anyNode
+ *  \return int* new buffer or nullptr if memory ran out
+ */
+int* MatrixPool::allocateBuffer(size_t bytes, int node)
+{
+    HugePageMode mode;
+    size_t threshold;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        mode = hugePageMode;
+        threshold = hugePageThreshold;
+    }
+
+    if(node == anyNode && (bytes < threshold || bytes % hugePageSize != 0))
+    {
+        int* buffer = static_cast<int*>(std::aligned_alloc(alignment, bytes));
+        if(buffer != nullptr)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stats.heapBuffers++;
+        }
+        return buffer;
+    }
+
+    void* mapped = MAP_FAILED;
+    Backing backing = Pages;
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t pages = (bytes + pageSize - 1) / pageSize * pageSize; // small buffers for a node get whole pages
+
+#ifdef MAP_HUGETLB
+    if(mode == ExplicitFirst && bytes % hugePageSize == 0)
+    {
+        mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        backing = ExplicitHugePages;
+    }
+#endif
+
+    if(mapped == MAP_FAILED)
+    {
+        // over-allocate to be able to cut a 2 MiB aligned range, only aligned ranges can be huge pages
+        size_t length = mode == NoHugePages ? pages : pages + hugePageSize;
+        void* raw = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        backing = Pages;
+        mapped = raw;
+
+        if(mode != NoHugePages)
+        {
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (start + hugePageSize - 1) / hugePageSize * hugePageSize;
+            if(aligned > start)
+            {
+                munmap(raw, aligned - start);
+            }
+            if(aligned + pages < start + length)
+            {
+                munmap(reinterpret_cast<void*>(aligned + pages), start + length - aligned - pages);
+            }
+            mapped = reinterpret_cast<void*>(aligned);
+
+#ifdef MADV_HUGEPAGE
+            if(transparentHugePagesEnabled() && madvise(mapped, bytes, MADV_HUGEPAGE) == 0)
+            {
+                backing = TransparentHugePages;
+            }
+#endif
+        }
+    }
+
+    if(node != anyNode)
+    {
+        NumaTopology::instance().bindMemory(mapped, bytes, node); // pinned first touch still places it if not allowed
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    mappedBuffers[mapped] = backing;
+    switch(backing)
+    {
+        case ExplicitHugePages: stats.explicitHugeBuffers++; break;
+        case TransparentHugePages: stats.transparentHugeBuffers++; break;
+        default: stats.pageBuffers++; break;
+    }
+    return static_cast<int*>(mapped);
+}
+
+/**
+ *  \brief Gives memory back to the system the same way it was allocated
+ *  \param [in] buffer int* buffer from allocateBuffer
+ *  \param [in] bytes size_t size class of buffer
+ */
+void MatrixPool::freeBuffer(int* buffer, size_t bytes)
+{
+    bool mapped;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        mapped = mappedBuffers.erase(buffer) > 0;
+    }
+
+    if(mapped)
+    {
+        munmap(buffer, bytes);
+    }
+    else
+    {
+        std::free(buffer);
+    }
+}
+
+/**
+ *  \brief Name of backing for reports
+ *  \param [in] backing Backing backing type
+ *  \return const char* readable name
+ */
+const char* MatrixPool::backingName(Backing backing)
+{
+    switch(backing)
+    {
+        case Heap: return "heap";
+        case Pages: return "4 KiB pages";
+        case TransparentHugePages: return "transparent huge pages";
+        case ExplicitHugePages: return "explicit huge pages";
+    }
+    return "unknown";
+}
+
+/**
+ *  \brief Sets whether large buffers ask for huge pages. Affects only buffers allocated afterwards
+ *  \param [in] mode HugePageMode new mode
+ */
+void MatrixPool::setHugePageMode(HugePageMode mode)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    hugePageMode = mode;
+}
+
+/**
+ *  \brief Getter for huge page mode
+ *  \return HugePageMode current mode
+ */
+MatrixPool::HugePageMode MatrixPool::getHugePageMode() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return hugePageMode;
+}
+
+/**
+ *  \brief Sets smallest buffer that is mapped instead of taken from heap
+ *  \param [in] bytes size_t threshold, raised to at least one huge page
+ */
+void MatrixPool::setHugePageThreshold(size_t bytes)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    hugePageThreshold = std::max(bytes, hugePageSize);
+}
+
+/**
+ *  \brief Getter for huge page threshold
+ *  \return size_t smallest buffer that is mapped
+ */
+size_t MatrixPool::getHugePageThreshold() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return hugePageThreshold;
+}
+
+/**
+ *  \brief Tells what kind of memory a buffer got
+ *  \param [in] buffer const void* buffer given by allocate
+ *  \return Backing backing of buffer, Heap for buffers not mapped by the pool
+ */
+MatrixPool::Backing MatrixPool::getBacking(const void* buffer) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = mappedBuffers.find(buffer);
+    return found != mappedBuffers.end() ? found->second : Heap;
+}
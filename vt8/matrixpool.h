@@ -0,0 +1,84 @@
+#ifndef MATRIXPOOL_H
+#define MATRIXPOOL_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @file matrixpool.h
+ * @version 1.0
+ * @brief Declaration of MatrixPool
+ * @author Niko Lehto
+ */
+class MatrixPool
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;        ///< allocations served from cached buffers
+        size_t misses = 0;      ///< allocations that needed new memory
+        size_t releases = 0;    ///< buffers returned to the pool
+        size_t dropped = 0;     ///< returned buffers freed because cache was full
+        size_t cachedBytes = 0; ///< bytes currently held for reuse
+        size_t heapBuffers = 0;          ///< new buffers from aligned heap allocation
+        size_t pageBuffers = 0;          ///< new mapped buffers that got normal pages
+        size_t transparentHugeBuffers = 0; ///< new mapped buffers advised to use transparent huge pages
+        size_t explicitHugeBuffers = 0;  ///< new mapped buffers backed by reserved huge pages
+    };
+
+    enum Backing
+    {
+        Heap,                 ///< aligned_alloc, used below huge page threshold
+        Pages,                ///< mmap with normal pages, huge pages were not available
+        TransparentHugePages, ///< mmap aligned to 2 MiB and madvise(MADV_HUGEPAGE)
+        ExplicitHugePages     ///< mmap with MAP_HUGETLB
+    };
+
+    enum HugePageMode
+    {
+        NoHugePages,      ///< large buffers use normal pages
+        TransparentOnly,  ///< large buffers ask for transparent huge pages, default
+        ExplicitFirst     ///< large buffers try reserved huge pages first, then transparent ones
+    };
+
+    static const int anyNode = -1; ///< allocate placement, pages go where they are first touched
+    static const size_t alignment = 64;
+    static const size_t hugePageSize = 2 * 1024 * 1024;
+
+    static MatrixPool& instance();
+    static size_t sizeClass(size_t bytes);
+    static const char* backingName(Backing backing);
+
+    std::shared_ptr<int> allocate(size_t count, int node = anyNode);
+    Stats getStats() const;
+    void resetStats();
+    void setCacheLimit(size_t bytes);
+    size_t getCacheLimit() const;
+    void trim();
+    void setHugePageMode(HugePageMode mode);
+    HugePageMode getHugePageMode() const;
+    void setHugePageThreshold(size_t bytes);
+    size_t getHugePageThreshold() const;
+    Backing getBacking(const void* buffer) const;
+
+private:
+    MatrixPool();
+    MatrixPool(const MatrixPool&) = delete;
+    MatrixPool& operator=(const MatrixPool&) = delete;
+
+    void release(int* buffer, size_t bytes, int node);
+    int* allocateBuffer(size_t bytes, int node);
+    void freeBuffer(int* buffer, size_t bytes);
+
+    mutable std::mutex lock;
+    std::map<std::pair<int, size_t>, std::vector<int*>> freeBuffers; // by node and size class
+    std::map<const void*, Backing> mappedBuffers;
+    size_t cacheLimit;
+    HugePageMode hugePageMode;
+    size_t hugePageThreshold;
+    Stats stats;
+};
+#endif
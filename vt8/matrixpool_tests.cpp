@@ -0,0 +1,131 @@
+#include "catch.hpp"
+#include "matrixpool.h"
+#include "numatopology.h"
+#include "squarematrix.h"
+
+/**
+ *  @file matrixpool_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for MatrixPool class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for MatrixPool, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("MatrixPool", "[MatrixPool]")
+{
+    MatrixPool& pool = MatrixPool::instance();
+
+    REQUIRE(MatrixPool::sizeClass(1) == MatrixPool::alignment);
+    REQUIRE(MatrixPool::sizeClass(65) == 128);
+    REQUIRE(MatrixPool::sizeClass(3 * 1024 * 1024) == 4 * 1024 * 1024);
+    REQUIRE(MatrixPool::sizeClass(5 * 1024 * 1024) == 6 * 1024 * 1024);
+    REQUIRE_FALSE(pool.allocate(0));
+
+    pool.trim();
+    pool.resetStats();
+
+    int* first;
+    {
+        std::shared_ptr<int> buffer = pool.allocate(1000);
+        first = buffer.get();
+        REQUIRE(reinterpret_cast<size_t>(first) % MatrixPool::alignment == 0);
+    }
+    REQUIRE(pool.getStats().misses == 1);
+    REQUIRE(pool.getStats().releases == 1);
+    REQUIRE(pool.getStats().cachedBytes == 4096);
+
+    {
+        std::shared_ptr<int> buffer = pool.allocate(900); // same size class
+        REQUIRE(buffer.get() == first);
+    }
+    REQUIRE(pool.getStats().hits == 1);
+
+    SquareMatrix a("[[1,2][3,4]]"), b("[[2,3][4,5]]");
+    pool.resetStats();
+    for(int i = 0; i < 10; i++)
+    {
+        a *= b;
+        a -= b;
+    }
+    REQUIRE(pool.getStats().misses <= 1);
+
+    size_t limit = pool.getCacheLimit();
+    pool.setCacheLimit(0);
+    pool.trim();
+    pool.resetStats();
+    {
+        std::shared_ptr<int> buffer = pool.allocate(10);
+    }
+    REQUIRE(pool.getStats().dropped == 1);
+    REQUIRE(pool.getStats().cachedBytes == 0);
+    pool.setCacheLimit(limit);
+
+    // buffers for a node are cached for that node only, and their pages are on it once touched
+    const NumaTopology& topology = NumaTopology::instance();
+    pool.trim();
+    for(size_t node = 0; node < topology.getNodeCount(); node++)
+    {
+        int* bound;
+        {
+            std::shared_ptr<int> buffer = pool.allocate(1000, static_cast<int>(node));
+            bound = buffer.get();
+            REQUIRE(reinterpret_cast<size_t>(bound) % MatrixPool::alignment == 0);
+            std::fill(bound, bound + 1000, 1);
+            int placed = topology.nodeOfAddress(bound);
+            REQUIRE((placed == -1 || placed == static_cast<int>(node)));
+        }
+        REQUIRE(pool.allocate(1000).get() != bound);
+        REQUIRE(pool.allocate(1000, static_cast<int>(node)).get() == bound);
+    }
+}
+
+/**
+*  \brief Unit tests for huge page backed buffers of MatrixPool, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("MatrixPool huge pages", "[MatrixPoolHuge]")
+{
+    MatrixPool& pool = MatrixPool::instance();
+    size_t large = 3 * MatrixPool::hugePageSize / sizeof(int);
+
+    REQUIRE(pool.getHugePageMode() == MatrixPool::TransparentOnly);
+    pool.setHugePageThreshold(0);
+    REQUIRE(pool.getHugePageThreshold() == MatrixPool::hugePageSize);
+
+    {
+        std::shared_ptr<int> small = pool.allocate(1000);
+        REQUIRE(pool.getBacking(small.get()) == MatrixPool::Heap);
+    }
+
+    pool.trim();
+    {
+        std::shared_ptr<int> buffer = pool.allocate(large);
+        MatrixPool::Backing backing = pool.getBacking(buffer.get());
+        REQUIRE(backing != MatrixPool::Heap);
+        REQUIRE(backing != MatrixPool::ExplicitHugePages);
+        REQUIRE(reinterpret_cast<size_t>(buffer.get()) % MatrixPool::hugePageSize == 0);
+        buffer.get()[large - 1] = 1;
+    }
+
+    pool.setHugePageMode(MatrixPool::ExplicitFirst);
+    pool.trim();
+    {
+        std::shared_ptr<int> buffer = pool.allocate(large); // falls back if no huge pages are reserved
+        REQUIRE(pool.getBacking(buffer.get()) != MatrixPool::Heap);
+        buffer.get()[0] = 1;
+    }
+
+    pool.setHugePageMode(MatrixPool::NoHugePages);
+    pool.trim();
+    {
+        std::shared_ptr<int> buffer = pool.allocate(large);
+        REQUIRE(pool.getBacking(buffer.get()) == MatrixPool::Pages);
+    }
+
+    pool.setHugePageMode(MatrixPool::TransparentOnly);
+    pool.trim();
+    REQUIRE(std::string(MatrixPool::backingName(MatrixPool::TransparentHugePages)) == "transparent huge pages");
+}
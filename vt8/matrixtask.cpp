@@ -0,0 +1,285 @@
+#include "matrixtask.h"
+#include "executionpolicy.h"
+#include "squarematrix.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/**
+ *  @file matrixtask.cpp
+ *  @brief Implementation of MatrixTask
+ *  */
+
+ /**
+ *  @class MatrixTask
+ *  @version 1.0
+ *  @brief Handle to a matrix that is computed asynchronously on a shared pool of threads. A task starts when all
+ *      tasks it depends on are ready; waiting for them is done by continuations, not by a blocked thread, so
+ *      independent tasks run concurrently. Tasks run with the execution policy of the thread that created them.
+ *      An exception thrown by a task is rethrown by get() of the task and of every task depending on it
+ *  @author Niko Lehto
+ *  */
+
+/**
+ *  \brief Shared state of a task
+ */
+struct MatrixTask::State
+{
+    std::mutex lock;
+    std::condition_variable ready;
+    bool done = false;
+    SquareMatrix result;
+    std::exception_ptr error;
+    std::vector<std::function<void()>> continuations; // run once when done
+};
+
+/**
+ *  \brief Threads running submitted jobs in order of submission
+ */
+struct TaskPool
+{
+    std::mutex lock;
+    std::condition_variable available;
+    std::deque<std::function<void()>> jobs;
+    size_t threads = 0;
+
+    /**
+     *  \brief Starts one thread per usable cpu of the global policy, at least two so that a long task
+     *      does not hold back all others. Threads are detached and live until exit
+     */
+    TaskPool()
+    {
+        threads = std::max(2u, ExecutionPolicy::usableCpus(ExecutionPolicy::getGlobal()));
+        for(size_t i = 0; i < threads; i++)
+        {
+            std::thread([this]()
+            {
+                for(;;)
+                {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock<std::mutex> guard(lock);
+                        available.wait(guard, [this]() { return !jobs.empty(); });
+                        job = std::move(jobs.front());
+                        jobs.pop_front();
+                    }
+                    job();
+                }
+            }).detach();
+        }
+    }
+
+    /**
+     *  \brief Getter for pool shared by all tasks. Intentionally leaked, detached threads use it until exit
+     *  \return TaskPool& pool
+     */
+    static TaskPool& instance()
+    {
+        static TaskPool* pool = new TaskPool();
+        return *pool;
+    }
+};
+
+/**
+ *  \brief Default constructor, task that is ready with an empty matrix
+ */
+MatrixTask::MatrixTask() : MatrixTask(SquareMatrix())
+{
+}
+
+/**
+ *  \brief Constructor for a task that is already ready, lets matrices be given where tasks are expected
+ *  \param [in] ready const SquareMatrix& result of task
+ */
+MatrixTask::MatrixTask(const SquareMatrix& ready) : state(std::make_shared<State>())
+{
+    state->result = ready;
+    state->done = true;
+}
+
+/**
+ *  \brief Queues job to the shared pool
+ *  \param [in] job const std::function<void()>& job, must not throw
+ */
+void MatrixTask::submit(const std::function<void()>& job)
+{
+    TaskPool& pool = TaskPool::instance();
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        pool.jobs.push_back(job);
+    }
+    pool.available.notify_one();
+}
+
+/**
+ *  \brief Stores result or error of a task, wakes waiting threads and runs continuations
+ *  \param [in] s const std::shared_ptr<State>& state of task
+ *  \param [in] result const SquareMatrix* result, nullptr if error is set
+ *  \param [in] error std::exception_ptr exception thrown by task
+ */
+void MatrixTask::complete(const std::shared_ptr<State>& s, const SquareMatrix* result, std::exception_ptr error)
+{
+    std::vector<std::function<void()>> continuations;
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        if(result != nullptr)
+        {
+            s->result = *result;
+        }
+        s->error = error;
+        s->done = true;
+        continuations.swap(s->continuations);
+    }
+    s->ready.notify_all();
+
+    for(auto& continuation : continuations)
+    {
+        continuation();
+    }
+}
+
+/**
+ *  \brief Runs continuation when task is ready, immediately on calling thread if it already is
+ *  \param [in] continuation const std::function<void()>& cheap function that must not throw
+ */
+void MatrixTask::onReady(const std::function<void()>& continuation) const
+{
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        if(!state->done)
+        {
+            state->continuations.push_back(continuation);
+            return;
+        }
+    }
+    continuation();
+}
+
+/**
+ *  \brief Runs work on the shared pool
+ *  \param [in] work const std::function<SquareMatrix()>& computes result
+ *  \return MatrixTask task of result
+ */
+MatrixTask MatrixTask::run(const std::function<SquareMatrix()>& work)
+{
+    return when(std::vector<MatrixTask>(), [work](const std::vector<const SquareMatrix*>&)
+    {
+        return work();
+    });
+}
+
+/**
+ *  \brief Runs work on the shared pool when all dependencies are ready. No thread waits for the dependencies
+ *  \param [in] dependencies const std::vector<MatrixTask>& tasks whose results work needs
+ *  \param [in] work const std::function<SquareMatrix(const std::vector<const SquareMatrix*>&)>& computes result
+ *      from results of dependencies, in the same order
+ *  \return MatrixTask task of result, fails without running work if a dependency failed
+ */
+MatrixTask MatrixTask::when(const std::vector<MatrixTask>& dependencies, const std::function<SquareMatrix(const std::vector<const SquareMatrix*>&)>& work)
+{
+    MatrixTask next;
+    next.state = std::make_shared<State>();
+
+    std::shared_ptr<State> target = next.state;
+    ExecutionPolicy::Policy policy = ExecutionPolicy::current();
+    auto pending = std::make_shared<std::atomic<size_t>>(dependencies.size() + 1);
+
+    auto start = [=]()
+    {
+        if(--*pending != 0)
+        {
+            return;
+        }
+        submit([=]()
+        {
+            std::vector<const SquareMatrix*> values;
+            for(const MatrixTask& dependency : dependencies)
+            {
+                if(dependency.state->error)
+                {
+                    complete(target, nullptr, dependency.state->error);
+                    return;
+                }
+                values.push_back(&dependency.state->result);
+            }
+
+            try
+            {
+                ExecutionPolicy::Scope scope(policy);
+                SquareMatrix result = work(values);
+                complete(target, &result, nullptr);
+            }
+            catch(...)
+            {
+                complete(target, nullptr, std::current_exception());
+            }
+        });
+    };
+
+    for(const MatrixTask& dependency : dependencies)
+    {
+        dependency.onReady(start);
+    }
+    start();
+    return next;
+}
+
+/**
+ *  \brief Getter for number of threads in the shared pool
+ *  \return size_t threads, starts the pool if not yet running
+ */
+size_t MatrixTask::getPoolThreads()
+{
+    return TaskPool::instance().threads;
+}
+
+/**
+ *  \brief Chains work to run on the result of this task when it is ready
+ *  \param [in] work const std::function<SquareMatrix(const SquareMatrix&)>& computes new result
+ *  \return MatrixTask task of new result
+ */
+MatrixTask MatrixTask::then(const std::function<SquareMatrix(const SquareMatrix&)>& work) const
+{
+    return when(std::vector<MatrixTask>({*this}), [work](const std::vector<const SquareMatrix*>& values)
+    {
+        return work(*values[0]);
+    });
+}
+
+/**
+ *  \brief Tells if result or error is available
+ *  \return bool true if get() does not block
+ */
+bool MatrixTask::isReady() const
+{
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->done;
+}
+
+/**
+ *  \brief Blocks calling thread until task is ready. Must not be called from work of another task
+ */
+void MatrixTask::wait() const
+{
+    std::unique_lock<std::mutex> guard(state->lock);
+    state->ready.wait(guard, [this]() { return state->done; });
+}
+
+/**
+ *  \brief Waits for result
+ *  \return SquareMatrix result of task
+ *  \throws exception thrown by the task or by a task it depends on
+ */
+SquareMatrix MatrixTask::get() const
+{
+    wait();
+    if(state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+    return state->result;
+}
@@ -0,0 +1,42 @@
+#ifndef MATRIXTASK_H
+#define MATRIXTASK_H
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class SquareMatrix;
+
+/**
+ * @file matrixtask.h
+ * @version 1.0
+ * @brief Declaration of MatrixTask
+ * @author Niko Lehto
+ */
+class MatrixTask
+{
+private:
+    struct State;
+    std::shared_ptr<State> state;
+
+    static void submit(const std::function<void()>& job);
+    static void complete(const std::shared_ptr<State>& s, const SquareMatrix* result, std::exception_ptr error);
+    void onReady(const std::function<void()>& continuation) const;
+
+    friend class SquareMatrix;
+
+public:
+    MatrixTask();
+    MatrixTask(const SquareMatrix& ready);
+
+    static MatrixTask run(const std::function<SquareMatrix()>& work);
+    static MatrixTask when(const std::vector<MatrixTask>& dependencies, const std::function<SquareMatrix(const std::vector<const SquareMatrix*>&)>& work);
+    static size_t getPoolThreads();
+
+    MatrixTask then(const std::function<SquareMatrix(const SquareMatrix&)>& work) const;
+    bool isReady() const;
+    void wait() const;
+    SquareMatrix get() const;
+};
+#endif
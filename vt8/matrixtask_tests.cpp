@@ -0,0 +1,68 @@
+#include "catch.hpp"
+#include "matrixtask.h"
+#include "squarematrix.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/**
+ *  @file matrixtask_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for MatrixTask class and asynchronous SquareMatrix operations
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for MatrixTask, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("MatrixTask", "[MatrixTask]")
+{
+    REQUIRE(MatrixTask::getPoolThreads() >= 2);
+
+    SquareMatrix a("[[1,2][3,4]]"), b("[[2,3][4,5]]");
+    MatrixTask ready(a);
+    REQUIRE(ready.isReady());
+    REQUIRE(ready.get() == a);
+
+    // parse, multiply, add and transpose chained without waiting in between
+    MatrixTask parsed = SquareMatrix::parseAsync("[[2,3][4,5]]");
+    MatrixTask product = SquareMatrix::multiplyAsync(a, parsed);
+    MatrixTask sum = SquareMatrix::addAsync(product, parsed);
+    MatrixTask transposed = SquareMatrix::transposeAsync(sum);
+    std::future<std::string> text = SquareMatrix::toStringAsync(transposed);
+
+    REQUIRE(product.get() == a * b);
+    REQUIRE(sum.get() == a * b + b);
+    REQUIRE(transposed.get() == (a * b + b).transpose());
+    REQUIRE(text.get() == (a * b + b).transpose().toString());
+
+    // dependent task does not start before its gate, an independent task is not held back by it
+    std::atomic<bool> open(false);
+    MatrixTask gate = MatrixTask::run([&open]()
+    {
+        while(!open)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return SquareMatrix("[[1]]");
+    });
+    MatrixTask dependent = gate.then([](const SquareMatrix& m)
+    {
+        return m + m;
+    });
+    MatrixTask independent = SquareMatrix::multiplyAsync(a, b);
+    REQUIRE(independent.get() == a * b);
+    REQUIRE_FALSE(dependent.isReady());
+    open = true;
+    REQUIRE(dependent.get() == SquareMatrix("[[2]]"));
+
+    // errors reach every task depending on the failed one
+    MatrixTask bad = SquareMatrix::parseAsync("[[1,2][3]]");
+    MatrixTask badProduct = SquareMatrix::multiplyAsync(bad, a);
+    REQUIRE_THROWS_AS(bad.get(), std::invalid_argument);
+    REQUIRE_THROWS_AS(badProduct.get(), std::invalid_argument);
+    REQUIRE_THROWS_AS(SquareMatrix::toStringAsync(badProduct).get(), std::invalid_argument);
+    REQUIRE_THROWS_WITH(SquareMatrix::addAsync(a, SquareMatrix("[[1]]")).get(), "operator requires same sized matrices");
+}
@@ -0,0 +1,391 @@
+#include "modularelimination.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ *  @file modularelimination.cpp
+ *  @brief Implementation of ModularElimination
+ *  */
+
+ /**
+ *  @class ModularElimination
+ *  @version 1.0
+ *  @brief Gaussian elimination over the integers modulo a prime p below 2<SUP>31</SUP>, for rank, determinant and
+ *      inverse. Columns are eliminated in panels of 64. Within a panel each pivot updates the panel columns of the
+ *      rows below it, then the rows below the panel are updated with all of its pivots in one pass over each row,
+ *      split between workers. Products of reduced values are below 2<SUP>62</SUP>, so they are added to 64-bit elements without a division; an element
+ *      that reaches 2<SUP>63</SUP> drops a multiple of p with a compare and a subtract, which vectorizes. Elements are
+ *      reduced only when they are read as pivots, multipliers or sources
+ *  @author Niko Lehto
+ *  */
+
+const size_t ModularElimination::panelWidth;
+const size_t ModularElimination::columnBlock;
+
+/**
+ *  \brief Copies m reduced modulo p, augmented with identity for inverse
+ *  \param [in] m const SquareMatrixView& matrix to eliminate
+ *  \param [in] p int prime modulus
+ *  \param [in] augmented bool append identity columns
+ */
+ModularElimination::ModularElimination(const SquareMatrixView& m, int p, bool augmented)
+{
+    checkModulus(p);
+    this->p = p;
+    this->reduceStep = (static_cast<uint64_t>(1) << 63) / this->p * this->p;
+    this->rows = m.getDimension();
+    this->pivotColumns = rows;
+    this->columns = augmented ? 2 * rows : rows;
+    this->w.assign(rows * columns, 0);
+
+    SquareMatrix::runParallel(rows, columns, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const int* source = m.row(i);
+            uint64_t* target = row(i);
+            for(size_t j = 0; j < rows; j++)
+            {
+                int value = source[j] % p;
+                target[j] = value < 0 ? value + p : value;
+            }
+            if(augmented)
+            {
+                target[rows + i] = 1;
+            }
+        }
+    });
+}
+
+/**
+ *  \brief Elements of row
+ *  \param [in] i size_t row index
+ *  \return uint64_t* first element of row
+ */
+uint64_t* ModularElimination::row(size_t i)
+{
+    return w.data() + i * columns;
+}
+
+/**
+ *  \brief Validates modulus
+ *  \param [in] p int modulus
+ */
+void ModularElimination::checkModulus(int p)
+{
+    bool prime = p >= 2;
+    for(int d = 2; prime && d <= p / d; d++)
+    {
+        prime = p % d != 0;
+    }
+    if(!prime)
+    {
+        throw std::invalid_argument("modulus must be prime");
+    }
+}
+
+/**
+ *  \brief Multiplicative inverse by extended Euclid
+ *  \param [in] a uint64_t nonzero value below p
+ *  \param [in] p uint64_t prime modulus
+ *  \return uint64_t x with a * x = 1 mod p
+ */
+uint64_t ModularElimination::inverse(uint64_t a, uint64_t p)
+{
+    int64_t r0 = p, r1 = a, s0 = 0, s1 = 1;
+    while(r1 != 0)
+    {
+        int64_t q = r0 / r1;
+        std::swap(r0, r1);
+        r1 -= q * r0;
+        std::swap(s0, s1);
+        s1 -= q * s0;
+    }
+    return s0 < 0 ? s0 + p : s0;
+}
+
+/**
+ *  \brief sums += factor * source for count elements, dropping reduceStep from sums that reach 2<SUP>63</SUP>
+ *  \param [in,out] sums uint64_t* elements below 2<SUP>63</SUP>
+ *  \param [in] factor uint64_t value below p
+ *  \param [in] source const uint32_t* reduced elements
+ *  \param [in] count size_t number of elements
+ */
+void ModularElimination::addMultiple(uint64_t* sums, uint64_t factor, const uint32_t* source, size_t count) const
+{
+    size_t j = 0;
+#if defined(__AVX2__)
+    __m256i scale = _mm256_set1_epi64x(factor);
+    __m256i step = _mm256_set1_epi64x(reduceStep);
+    __m256i zero = _mm256_setzero_si256();
+    for(; j + 4 <= count; j += 4)
+    {
+        __m256i value = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + j)));
+        __m256i sum = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + j)), _mm256_mul_epu32(scale, value));
+        sum = _mm256_sub_epi64(sum, _mm256_and_si256(_mm256_cmpgt_epi64(zero, sum), step));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + j), sum);
+    }
+#endif
+    for(; j < count; j++)
+    {
+        uint64_t sum = sums[j] + factor * source[j];
+        sums[j] = sum - (reduceStep & (0 - (sum >> 63)));
+    }
+}
+
+/**
+ *  \brief Adds multipliers[t] times row t of sources into columns [column, columns) of rows [first, last).
+ *      Multipliers are read from the rows themselves, sources are reduced
+ *  \param [in] first size_t first row to update
+ *  \param [in] last size_t one past last row to update
+ *  \param [in] multipliers const std::vector<size_t>& column of each row holding the reduced value subtracted for source t
+ *  \param [in] sources const std::vector<uint32_t>& multipliers.size() rows of columns - column reduced elements
+ *  \param [in] column size_t first column to update
+ */
+void ModularElimination::updateRows(size_t first, size_t last, const std::vector<size_t>& multipliers, const std::vector<uint32_t>& sources, size_t column)
+{
+    size_t width = columns - column;
+    if(first >= last || width == 0 || multipliers.empty())
+    {
+        return;
+    }
+
+    SquareMatrix::runParallel(last - first, multipliers.size() * width, [&](size_t worker_start, size_t worker_stop)
+    {
+        std::vector<uint64_t> factors(multipliers.size());
+        for(size_t i = first + worker_start; i < first + worker_stop; i++)
+        {
+            uint64_t* target = row(i);
+            for(size_t t = 0; t < multipliers.size(); t++)
+            {
+                uint64_t value = target[multipliers[t]] % p;
+                factors[t] = value == 0 ? 0 : p - value;
+            }
+
+            // a block of the row takes every source before moving on, so it is loaded once per panel
+            for(size_t jb = 0; jb < width; jb += columnBlock)
+            {
+                size_t block = std::min(columnBlock, width - jb);
+                uint64_t* sums = target + column + jb;
+                for(size_t t = 0; t < multipliers.size(); t++)
+                {
+                    uint64_t factor = factors[t];
+                    if(factor == 0)
+                    {
+                        continue;
+                    }
+                    addMultiple(sums, factor, sources.data() + t * width + jb, block);
+                }
+            }
+        }
+    });
+}
+
+/**
+ *  \brief Reduces rows to echelon form. Pivots are searched column by column in [0, pivotColumns), columns without
+ *      pivot are skipped. Below a pivot the eliminated element keeps its multiplier
+ */
+void ModularElimination::forward()
+{
+    size_t rank = 0;
+    std::vector<uint32_t> sources, pivotRow;
+    for(size_t c0 = 0; c0 < pivotColumns && rank < rows; c0 += panelWidth)
+    {
+        size_t c1 = std::min(c0 + panelWidth, pivotColumns);
+        size_t first = rank;
+
+        std::vector<size_t> panel;
+        for(size_t c = c0; c < c1 && rank < rows; c++)
+        {
+            size_t r = rows;
+            for(size_t i = rank; i < rows; i++)
+            {
+                row(i)[c] %= p;
+                if(r == rows && row(i)[c] != 0)
+                {
+                    r = i;
+                }
+            }
+            if(r == rows)
+            {
+                continue; // no pivot, this column depends on earlier ones
+            }
+            if(r != rank)
+            {
+                std::swap_ranges(row(r), row(r) + columns, row(rank));
+                negative = !negative;
+            }
+
+            // rest of the panel in the pivot row is final, rows below take it with the multiplier left in column c
+            uint64_t* pivotElements = row(rank);
+            pivotRow.resize(c1 - c - 1);
+            for(size_t j = c + 1; j < c1; j++)
+            {
+                pivotElements[j] %= p;
+                pivotRow[j - c - 1] = static_cast<uint32_t>(pivotElements[j]);
+            }
+            uint64_t pivot = pivotElements[c];
+            uint64_t scale = inverse(pivot, p);
+            pivotProduct = pivotProduct * pivot % p;
+            SquareMatrix::runParallel(rows - rank - 1, c1 - c, [&](size_t worker_start, size_t worker_stop)
+            {
+                for(size_t i = rank + 1 + worker_start; i < rank + 1 + worker_stop; i++)
+                {
+                    uint64_t* target = row(i);
+                    uint64_t multiplier = target[c] * scale % p;
+                    target[c] = multiplier;
+                    if(multiplier != 0)
+                    {
+                        addMultiple(target + c + 1, p - multiplier, pivotRow.data(), pivotRow.size());
+                    }
+                }
+            });
+
+            pivots.push_back(c);
+            panel.push_back(c);
+            rank++;
+        }
+
+        size_t width = columns - c1;
+        if(panel.empty() || width == 0)
+        {
+            continue;
+        }
+
+        // pivot rows of the panel take the earlier pivots of the panel into the columns right of it
+        sources.resize(panel.size() * width);
+        for(size_t t = first; t < rank; t++)
+        {
+            uint64_t* source = row(t) + c1;
+            uint32_t* reduced = sources.data() + (t - first) * width;
+            for(size_t j = 0; j < width; j++)
+            {
+                reduced[j] = static_cast<uint32_t>(source[j] % p);
+            }
+            for(size_t u = t + 1; u < rank; u++)
+            {
+                uint64_t multiplier = row(u)[panel[t - first]];
+                if(multiplier != 0)
+                {
+                    addMultiple(row(u) + c1, p - multiplier, reduced, width);
+                }
+            }
+        }
+
+        updateRows(rank, rows, panel, sources, c1);
+    }
+}
+
+/**
+ *  \brief Turns [U | Y] after forward() with full rank into [U | U<SUP>-1</SUP>Y], panel by panel from the bottom
+ */
+void ModularElimination::backSubstitute()
+{
+    size_t n = rows;
+    std::vector<uint32_t> sources;
+    std::vector<size_t> panel;
+    for(size_t t1 = n; t1 > 0;)
+    {
+        size_t t0 = t1 > panelWidth ? t1 - panelWidth : 0;
+        sources.resize((t1 - t0) * n);
+
+        // rows of the panel from the bottom, each final once the rows below it in the panel are subtracted
+        for(size_t t = t1; t-- > t0;)
+        {
+            uint64_t* source = row(t) + n;
+            uint32_t* solved = sources.data() + (t - t0) * n;
+            uint64_t scale = inverse(row(t)[t] % p, p);
+            for(size_t j = 0; j < n; j++)
+            {
+                solved[j] = static_cast<uint32_t>(source[j] % p * scale % p);
+                source[j] = solved[j];
+            }
+            for(size_t u = t0; u < t; u++)
+            {
+                uint64_t multiplier = row(u)[t] % p;
+                if(multiplier != 0)
+                {
+                    addMultiple(row(u) + n, p - multiplier, solved, n);
+                }
+            }
+        }
+
+        panel.clear();
+        for(size_t t = t0; t < t1; t++)
+        {
+            panel.push_back(t);
+        }
+        updateRows(0, t0, panel, sources, n);
+        t1 = t0;
+    }
+}
+
+/**
+ *  \brief Rank modulo p, equals rank over the integers unless p divides all the largest nonzero minors
+ *  \param [in] m const SquareMatrixView& matrix
+ *  \param [in] p int prime modulus below 2<SUP>31</SUP>
+ *  \return int number of linearly independent rows modulo p
+ */
+int ModularElimination::rank(const SquareMatrixView& m, int p)
+{
+    ModularElimination e(m, p, false);
+    e.forward();
+    return static_cast<int>(e.pivots.size());
+}
+
+/**
+ *  \brief Determinant modulo p
+ *  \param [in] m const SquareMatrixView& matrix
+ *  \param [in] p int prime modulus below 2<SUP>31</SUP>
+ *  \return int determinant in [0, p)
+ */
+int ModularElimination::determinant(const SquareMatrixView& m, int p)
+{
+    ModularElimination e(m, p, false);
+    e.forward();
+    if(e.pivots.size() < e.rows)
+    {
+        return 0;
+    }
+    return static_cast<int>(e.negative && e.pivotProduct != 0 ? e.p - e.pivotProduct : e.pivotProduct);
+}
+
+/**
+ *  \brief Inverse modulo p by elimination of [m | I]
+ *  \param [in] m const SquareMatrixView& matrix
+ *  \param [in] p int prime modulus below 2<SUP>31</SUP>
+ *  \return SquareMatrix x with elements in [0, p) and m * x = I mod p
+ */
+SquareMatrix ModularElimination::inverse(const SquareMatrixView& m, int p)
+{
+    ModularElimination e(m, p, true);
+    e.forward();
+    if(e.pivots.size() < e.rows)
+    {
+        throw std::invalid_argument("Matrix is singular modulo p");
+    }
+    e.backSubstitute();
+
+    SquareMatrix result;
+    result.allocate(m.getDimension());
+    size_t t_n = e.rows;
+    SquareMatrix::runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const uint64_t* source = e.row(i) + t_n;
+            int* target = result.elements.get() + i * t_n;
+            for(size_t j = 0; j < t_n; j++)
+            {
+                target[j] = static_cast<int>(source[j] % e.p);
+            }
+        }
+    });
+    return result;
+}
@@ -0,0 +1,48 @@
+#ifndef MODULARELIMINATION_H
+#define MODULARELIMINATION_H
+
+#include "squarematrix.h"
+#include "squarematrixview.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file modularelimination.h
+ * @version 1.0
+ * @brief Declaration of ModularElimination
+ * @author Niko Lehto
+ */
+class ModularElimination
+{
+public:
+    static const size_t panelWidth = 64;   ///< columns eliminated before the rows below them are updated
+    static const size_t columnBlock = 256; ///< columns of a row updated from one panel at a time
+
+private:
+	uint64_t p = 0;
+	uint64_t reduceStep = 0;  // largest multiple of p not above 2^63, subtracted from sums that reach 2^63
+	size_t rows = 0;
+	size_t columns = 0;
+	size_t pivotColumns = 0;  // only columns [0, pivotColumns) may hold pivots
+	std::vector<uint64_t> w;  // rows x columns, every element below 2^63 and congruent to its value mod p
+	std::vector<size_t> pivots; // pivot column of each pivot row
+	uint64_t pivotProduct = 1;
+	bool negative = false;
+
+	ModularElimination(const SquareMatrixView& m, int p, bool augmented);
+	uint64_t* row(size_t i);
+	void forward();
+	void addMultiple(uint64_t* sums, uint64_t factor, const uint32_t* source, size_t count) const;
+	void updateRows(size_t first, size_t last, const std::vector<size_t>& multipliers, const std::vector<uint32_t>& sources, size_t column);
+	void backSubstitute();
+	static uint64_t inverse(uint64_t a, uint64_t p);
+	static void checkModulus(int p);
+
+public:
+	static int rank(const SquareMatrixView& m, int p);
+	static int determinant(const SquareMatrixView& m, int p);
+	static SquareMatrix inverse(const SquareMatrixView& m, int p);
+};
+#endif
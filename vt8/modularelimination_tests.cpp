@@ -0,0 +1,92 @@
+#include "catch.hpp"
+#include "modularelimination.h"
+
+/**
+ *  @file modularelimination_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for ModularElimination class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for ModularElimination, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("ModularElimination", "[ModularElimination]")
+{
+    SquareMatrix small("[[1,2,3][4,5,6][7,8,10]]");
+    REQUIRE(small.determinantMod(7) == 4);
+    REQUIRE(small.determinantMod(3) == 0);
+    REQUIRE(small.rankMod(3) == 2);
+    REQUIRE(small.rankMod(7) == 3);
+    SquareMatrix inverse = small.inverseMod(7);
+    REQUIRE(SquareMatrix::powMod(small * inverse, 1, 7) == SquareMatrix::identity(3));
+    REQUIRE_THROWS_WITH(small.inverseMod(3), "Matrix is singular modulo p");
+    REQUIRE_THROWS_WITH(small.determinantMod(9), "modulus must be prime");
+    REQUIRE_THROWS_WITH(small.rankMod(1), "modulus must be prime");
+
+    // sizes across panels, against exact determinants and products modulo p
+    for(int n : {1, 2, 63, 64, 65, 150})
+    {
+        for(int p : {2, 65521, 2147483647})
+        {
+            SquareMatrix a(n);
+            int64_t exact = 0;
+            if(n <= 2)
+            {
+                exact = a.determinant();
+                int64_t reduced = exact % p;
+                REQUIRE(a.determinantMod(p) == (reduced < 0 ? reduced + p : reduced));
+            }
+
+            if(a.determinantMod(p) != 0)
+            {
+                SquareMatrix x = a.inverseMod(p);
+                std::vector<int64_t> reduced(n * n);
+                for(int i = 0; i < n * n; i++)
+                {
+                    reduced[i] = (a.getElement(i / n, i % n).getVal() % static_cast<int64_t>(p) + p) % p;
+                }
+                for(int i = 0; i < n; i++)
+                {
+                    for(int j = 0; j < n; j++)
+                    {
+                        int64_t sum = 0;
+                        for(int k = 0; k < n; k++)
+                        {
+                            sum = (sum + reduced[i * n + k] * x.getElement(k, j).getVal()) % p;
+                        }
+                        REQUIRE(sum == (i == j ? 1 : 0));
+                    }
+                }
+                REQUIRE(a.rankMod(p) == n);
+            }
+        }
+    }
+
+    // rank of a product of n x r and r x n matrices is r
+    for(int r : {0, 1, 40, 70})
+    {
+        int n = 100;
+        SquareMatrix left(n), right(n);
+        for(int i = 0; i < n; i++)
+        {
+            for(int j = 0; j < n; j++)
+            {
+                left.setElement(i, j, IntElement(j < r ? (i * 7 + j * 3) % 11 : 0));
+                right.setElement(j, i, IntElement(j < r ? (i * 5 + j * 13) % 17 : 0));
+            }
+        }
+        for(int i = 0; i < r; i++)
+        {
+            for(int j = 0; j < r; j++)
+            {
+                left.setElement(i, j, IntElement(i == j ? 1 : 0));
+                right.setElement(i, j, IntElement(i == j ? 1 : 0));
+            }
+        }
+        SquareMatrix product = left * right;
+        REQUIRE(product.rankMod(1000003) == r);
+        REQUIRE(product.determinantMod(1000003) == (r == n ? 1 : 0));
+    }
+}
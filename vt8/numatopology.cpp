@@ -0,0 +1,228 @@
+#include "numatopology.h"
+
+#include <dirent.h>
+#include <algorithm>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+/**
+ *  @file numatopology.cpp
+ *  @brief Implementation of NumaTopology
+ *  */
+
+ /**
+ *  @class NumaTopology
+ *  @version 1.0
+ *  @brief NUMA nodes and their cpus as reported by /sys/devices/system/node. Used to place worker threads so that
+ *      each row strip is computed, and its pages first touched, on one node. Without /sys information the whole
+ *      machine is one node
+ *  @author Niko Lehto
+ *  */
+
+/**
+ *  \brief Node the calling thread was pinned to, 0 for threads that are not pinned
+ */
+thread_local int NumaTopology::currentNode = 0;
+
+/**
+ *  \brief Private constructor, use instance()
+ */
+NumaTopology::NumaTopology()
+{
+    const std::string root = "/sys/devices/system/node/";
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+
+    DIR* dir = opendir(root.c_str());
+    if(dir != nullptr)
+    {
+        while(dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if(name.compare(0, 4, "node") != 0 || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos)
+            {
+                continue;
+            }
+
+            std::ifstream file(root + name + "/cpulist");
+            std::string list;
+            if(std::getline(file, list))
+            {
+                std::vector<int> cpus = parseCpuList(list);
+                if(!cpus.empty()) // memory only nodes can not run workers
+                {
+                    nodes.push_back(std::make_pair(std::stoi(name.substr(4)), cpus));
+                }
+            }
+        }
+        closedir(dir);
+    }
+
+    std::sort(nodes.begin(), nodes.end());
+    for(auto& node : nodes)
+    {
+        nodeIds.push_back(node.first);
+        nodeCpus.push_back(node.second);
+    }
+
+    if(nodeCpus.empty())
+    {
+        nodeIds.push_back(0);
+        std::vector<int> cpus;
+        for(unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+        nodeCpus.push_back(cpus);
+    }
+}
+
+/**
+ *  \brief Getter for topology of this machine, read once
+ *  \return const NumaTopology& topology
+ */
+const NumaTopology& NumaTopology::instance()
+{
+    static NumaTopology topology;
+    return topology;
+}
+
+/**
+ *  \brief Parses cpu list of the form "0-5,12,14-17" used by /sys
+ *  \param [in] list const std::string& cpu list
+ *  \return std::vector<int> listed cpus
+ */
+std::vector<int> NumaTopology::parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+
+    while(std::getline(stream, range, ','))
+    {
+        if(range.find_first_not_of(" \n") == std::string::npos)
+        {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for(int cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ *  \brief Getter for node of calling thread
+ *  \return int node index the thread was pinned to by pinCurrentThread, 0 if not pinned
+ */
+int NumaTopology::getCurrentNode()
+{
+    return currentNode;
+}
+
+/**
+ *  \brief Getter for number of nodes with cpus
+ *  \return size_t number of nodes, at least 1
+ */
+size_t NumaTopology::getNodeCount() const
+{
+    return nodeCpus.size();
+}
+
+/**
+ *  \brief Getter for cpus of a node
+ *  \param [in] node size_t node index
+ *  \return const std::vector<int>& cpus of node
+ */
+const std::vector<int>& NumaTopology::getCpus(size_t node) const
+{
+    return nodeCpus.at(node);
+}
+
+/**
+ *  \brief Node for a worker when workers are split into contiguous groups, one group per node
+ *  \param [in] worker size_t worker index
+ *  \param [in] workers size_t number of workers
+ *  \return size_t node index
+ */
+size_t NumaTopology::nodeOfWorker(size_t worker, size_t workers) const
+{
+    return worker * nodeCpus.size() / workers;
+}
+
+/**
+ *  \brief Restricts calling thread to the cpus of a node
+ *  \param [in] node size_t node index
+ *  \param [in] allowed const std::vector<int>& cpus the thread may use, empty allows all. If the node has none of them
+ *      the thread is restricted to allowed cpus only
+ *  \return bool true if affinity was set
+ */
+bool NumaTopology::pinCurrentThread(size_t node, const std::vector<int>& allowed) const
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int cpu : getCpus(node))
+    {
+        if(allowed.empty() || std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if(CPU_COUNT(&set) == 0)
+    {
+        for(int cpu : allowed)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        return false;
+    }
+    currentNode = static_cast<int>(node);
+    return true;
+}
+
+/**
+ *  \brief Binds a mapped range that is not yet touched to the memory of a node with mbind, so its pages are placed
+ *      there whichever thread touches them first. Uses the system call directly, libnuma is not needed
+ *  \param [in] address void* page aligned start of range
+ *  \param [in] bytes size_t length of range
+ *  \param [in] node size_t node index
+ *  \return bool true if the range was bound, false if the kernel does not allow it, e.g. in containers
+ */
+bool NumaTopology::bindMemory(void* address, size_t bytes, size_t node) const
+{
+    const size_t bits = 8 * sizeof(unsigned long);
+    size_t id = static_cast<size_t>(nodeIds.at(node));
+    std::vector<unsigned long> mask(id / bits + 1, 0);
+    mask[id / bits] = 1ul << (id % bits);
+    return syscall(SYS_mbind, address, bytes, MPOL_BIND, mask.data(), mask.size() * bits + 1, 0) == 0;
+}
+
+/**
+ *  \brief Node whose memory holds the page of an address, asked from the kernel with get_mempolicy
+ *  \param [in] address const void* address in a touched page
+ *  \return int node index, -1 if the kernel does not tell or the node has no cpus
+ */
+int NumaTopology::nodeOfAddress(const void* address) const
+{
+    int id = -1;
+    if(syscall(SYS_get_mempolicy, &id, nullptr, 0, address, MPOL_F_NODE | MPOL_F_ADDR) != 0)
+    {
+        return -1;
+    }
+    auto found = std::find(nodeIds.begin(), nodeIds.end(), id);
+    return found != nodeIds.end() ? static_cast<int>(found - nodeIds.begin()) : -1;
+}
@@ -0,0 +1,37 @@
+#ifndef NUMATOPOLOGY_H
+#define NUMATOPOLOGY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @file numatopology.h
+ * @version 1.0
+ * @brief Declaration of NumaTopology
+ * @author Niko Lehto
+ */
+class NumaTopology
+{
+private:
+	std::vector<std::vector<int>> nodeCpus; // cpus of each node, nodes in ascending id order
+	std::vector<int> nodeIds;               // kernel id of each node
+	static thread_local int currentNode;
+
+	NumaTopology();
+	NumaTopology(const NumaTopology&) = delete;
+	NumaTopology& operator=(const NumaTopology&) = delete;
+
+public:
+	static const NumaTopology& instance();
+	static std::vector<int> parseCpuList(const std::string& list);
+	static int getCurrentNode();
+
+	size_t getNodeCount() const;
+	const std::vector<int>& getCpus(size_t node) const;
+	size_t nodeOfWorker(size_t worker, size_t workers) const;
+	bool pinCurrentThread(size_t node, const std::vector<int>& allowed = std::vector<int>()) const;
+	bool bindMemory(void* address, size_t bytes, size_t node) const;
+	int nodeOfAddress(const void* address) const;
+};
+#endif
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+#include "numatopology.h"
+
+#include <thread>
+
+/**
+ *  @file numatopology_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for NumaTopology class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for NumaTopology, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("NumaTopology", "[NumaTopology]")
+{
+    REQUIRE(NumaTopology::parseCpuList("0-3,8,10-11\n") == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    REQUIRE(NumaTopology::parseCpuList("5") == std::vector<int>({5}));
+    REQUIRE(NumaTopology::parseCpuList("\n").empty());
+
+    const NumaTopology& topology = NumaTopology::instance();
+    REQUIRE(topology.getNodeCount() >= 1);
+    REQUIRE_FALSE(topology.getCpus(0).empty());
+    REQUIRE_THROWS_AS(topology.getCpus(topology.getNodeCount()), std::out_of_range);
+
+    REQUIRE(topology.nodeOfWorker(0, 12) == 0);
+    REQUIRE(topology.nodeOfWorker(11, 12) == topology.getNodeCount() - 1);
+
+    size_t last = topology.getNodeCount() - 1;
+    int pinnedNode = -1;
+    std::thread worker([&]()
+    {
+        if(topology.pinCurrentThread(last))
+        {
+            pinnedNode = NumaTopology::getCurrentNode();
+        }
+    });
+    worker.join();
+    REQUIRE(pinnedNode == static_cast<int>(last));
+    REQUIRE(NumaTopology::getCurrentNode() == 0);
+
+    // -1 where get_mempolicy is not allowed, otherwise a node with cpus
+    std::vector<int> touched(1024, 1);
+    int node = topology.nodeOfAddress(touched.data());
+    REQUIRE(node >= -1);
+    REQUIRE(node < static_cast<int>(topology.getNodeCount()));
+}
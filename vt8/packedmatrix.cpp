@@ -0,0 +1,493 @@
+#include "packedmatrix.h"
+
+/**
+ *  @file packedmatrix.cpp
+ *  @brief Implementation of PackedMatrix
+ *  */
+
+ /**
+ *  @class PackedMatrix
+ *  @version 1.0
+ *  @brief Symmetric or triangular nxn matrix that stores only one triangle, n(n+1)/2 elements row by row.
+ *      Upper and symmetric matrices store columns i..n-1 of row i, lower matrices columns 0..i
+ *  @author Niko Lehto
+ *  */
+
+/**
+ *  \brief Runs work(row) for every row in parallel. Rows are paired as i and n-1-i so that strips of a triangle get even work
+ *  \param [in] n size_t number of rows
+ *  \param [in] pairCost size_t estimated element operations of two paired rows
+ *  \param [in] work const std::function<void(size_t)>& called once per row
+ */
+void PackedMatrix::runTriangle(size_t n, size_t pairCost, const std::function<void(size_t)>& work)
+{
+    SquareMatrix::runParallel((n + 1) / 2, pairCost, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t pair = worker_start; pair < worker_stop; pair++)
+        {
+            work(pair);
+            if(n - 1 - pair != pair)
+            {
+                work(n - 1 - pair);
+            }
+        }
+    });
+}
+
+/**
+ *  \brief Empty constructor, 0x0 symmetric matrix
+ */
+PackedMatrix::PackedMatrix() = default;
+
+/**
+ *  \brief Packs a dense matrix
+ *  \param [in] m const SquareMatrixView& dense matrix, must be symmetric or triangular as requested by kind
+ *  \param [in] kind Kind storage type
+ */
+PackedMatrix::PackedMatrix(const SquareMatrixView& m, Kind kind)
+{
+    this->kind = kind;
+    allocate(m.getDimension());
+
+    for(int i = 0; i < n; i++)
+    {
+        const int* row = m.row(i);
+        for(int j = 0; j < n; j++)
+        {
+            if(isStored(i, j))
+            {
+                this->elements.get()[rowOffset(i) + (kind == Lower ? j : j - i)] = row[j];
+            }
+            else if(kind == Symmetric && row[j] != m.row(j)[i])
+            {
+                throw std::invalid_argument("Matrix is not symmetric");
+            }
+            else if(kind != Symmetric && row[j] != 0)
+            {
+                throw std::invalid_argument("Matrix is not triangular");
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Clone constructor, shares storage until either matrix is modified
+ *  \param [in] m const PackedMatrix& object to clone
+ */
+PackedMatrix::PackedMatrix(const PackedMatrix& m) = default;
+
+/**
+ *  \brief Destructor
+ */
+PackedMatrix::~PackedMatrix() = default;
+
+/**
+ *  \brief Assignment, shares storage until either matrix is modified
+ *  \param [in] m const PackedMatrix& m
+ *  \return Reference to this
+ */
+PackedMatrix& PackedMatrix::operator=(const PackedMatrix& m) = default;
+
+/**
+ *  \brief Replaces storage with uninitialized buffer from MatrixPool
+ *  \param [in] n int dimension of matrix
+ */
+void PackedMatrix::allocate(int n)
+{
+    this->n = n;
+    this->elements = MatrixPool::instance().allocate(static_cast<size_t>(n) * (n + 1) / 2);
+}
+
+/**
+ *  \brief Gives this matrix storage of its own if storage is shared with another matrix
+ */
+void PackedMatrix::detach()
+{
+    if(this->elements.use_count() > 1)
+    {
+        std::shared_ptr<int> shared = this->elements;
+        allocate(this->n);
+        std::copy(shared.get(), shared.get() + getStorageSize(), this->elements.get());
+    }
+}
+
+/**
+ *  \brief Position of first stored element of row
+ *  \param [in] row size_t row index
+ *  \return size_t index into elements
+ */
+size_t PackedMatrix::rowOffset(size_t row) const
+{
+    if(kind == Lower)
+    {
+        return row * (row + 1) / 2;
+    }
+    return row * (2 * n - row + 1) / 2;
+}
+
+/**
+ *  \brief Checks if element is inside stored triangle
+ *  \param [in] row size_t row index
+ *  \param [in] col size_t column index
+ *  \return bool true if element is stored
+ */
+bool PackedMatrix::isStored(size_t row, size_t col) const
+{
+    return kind == Lower ? col <= row : col >= row;
+}
+
+/**
+ *  \brief Unchecked element access, mirrors symmetric and gives 0 outside triangle
+ *  \param [in] row size_t row index
+ *  \param [in] col size_t column index
+ *  \return int element value
+ */
+int PackedMatrix::at(size_t row, size_t col) const
+{
+    if(!isStored(row, col))
+    {
+        if(kind != Symmetric)
+        {
+            return 0;
+        }
+        std::swap(row, col);
+    }
+    return this->elements.get()[rowOffset(row) + (kind == Lower ? col : col - row)];
+}
+
+/**
+ *  \brief Computes symmetric a * a<SUP>T</SUP> by calculating only its upper triangle
+ *  \param [in] a const SquareMatrixView& a
+ *  \return PackedMatrix symmetric product
+ */
+PackedMatrix PackedMatrix::syrk(const SquareMatrixView& a)
+{
+    PackedMatrix result;
+    result.allocate(a.getDimension());
+    size_t t_n = result.n;
+
+    runTriangle(t_n, t_n * t_n, [&](size_t i)
+    {
+        const int* row_i = a.row(i);
+        int* target = result.elements.get() + result.rowOffset(i);
+        for(size_t j = i; j < t_n; j++)
+        {
+            const int* row_j = a.row(j);
+            int sum = 0;
+            for(size_t x = 0; x < t_n; x++)
+            {
+                sum += row_i[x] * row_j[x];
+            }
+            target[j - i] = sum;
+        }
+    });
+
+    return result;
+}
+
+/**
+ *  \brief Getter for storage type
+ *  \return Kind storage type
+ */
+PackedMatrix::Kind PackedMatrix::getKind() const
+{
+    return this->kind;
+}
+
+/**
+ *  \brief Getter for dimension
+ *  \return int dimension n of nxn matrix
+ */
+int PackedMatrix::getDimension() const
+{
+    return this->n;
+}
+
+/**
+ *  \brief Getter for number of stored elements
+ *  \return size_t n(n+1)/2
+ */
+size_t PackedMatrix::getStorageSize() const
+{
+    return static_cast<size_t>(n) * (n + 1) / 2;
+}
+
+/**
+ *  \brief Getter for single element
+ *  \param [in] row size_t row index starting from 0
+ *  \param [in] col size_t column index starting from 0
+ *  \return IntElement element at row, col
+ */
+IntElement PackedMatrix::getElement(size_t row, size_t col) const
+{
+    if(row >= static_cast<size_t>(n) || col >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    return IntElement(at(row, col));
+}
+
+/**
+ *  \brief Unpacks into dense matrix
+ *  \return SquareMatrix with all n*n elements
+ */
+SquareMatrix PackedMatrix::toSquareMatrix() const
+{
+    SquareMatrix dense;
+    dense.allocate(this->n);
+    size_t t_n = this->n;
+
+    SquareMatrix::runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            int* target = dense.elements.get() + i * t_n;
+            for(size_t j = 0; j < t_n; j++)
+            {
+                target[j] = at(i, j);
+            }
+        }
+    });
+
+    return dense;
+}
+
+/**
+ *  \brief Write object to stream in dense form [[<a<SUB>11</SUB>>,...,<a<SUB>1n</SUB>>]...[<a<SUB>n1</SUB>>,...,<a<SUB>nn</SUB>>]]
+ *  \param [out] stream std::ostream& output stream
+ */
+void PackedMatrix::print(std::ostream& stream) const
+{
+	stream << *this;
+}
+
+/**
+ *  \brief Write object to string in dense form [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \return std::string object as a string
+ */
+std::string PackedMatrix::toString() const
+{
+	std::stringstream result;
+	result << *this;
+	return result.str();
+}
+
+/**
+ *  \brief Overload of equal comparison
+ *  \param [in] m const PackedMatrix& value for comparison
+ *  \return bool true if this and m are same kind and have identical elements
+ */
+bool PackedMatrix::operator==(const PackedMatrix& m) const
+{
+    if(this->n != m.n || this->kind != m.kind)
+    {
+        return false;
+    }
+    return std::equal(this->elements.get(), this->elements.get() + getStorageSize(), m.elements.get());
+}
+
+/**
+ *  \brief Addition assignment of same kind packed matrices
+ *  \param [in] m const PackedMatrix& m
+ *  \return Reference to this added by m
+ */
+PackedMatrix& PackedMatrix::operator+=(const PackedMatrix& m)
+{
+    if(this->n != m.n || this->kind != m.kind)
+    {
+        throw std::invalid_argument("operator requires same sized matrices of same kind");
+    }
+
+    detach();
+    int* target = this->elements.get();
+    const int* source = m.elements.get();
+    for(size_t i = 0; i < getStorageSize(); i++)
+    {
+        target[i] += source[i];
+    }
+    return *this;
+}
+
+/**
+ *  \brief Substraction assignment of same kind packed matrices
+ *  \param [in] m const PackedMatrix& m
+ *  \return Reference to this substracted by m
+ */
+PackedMatrix& PackedMatrix::operator-=(const PackedMatrix& m)
+{
+    if(this->n != m.n || this->kind != m.kind)
+    {
+        throw std::invalid_argument("operator requires same sized matrices of same kind");
+    }
+
+    detach();
+    int* target = this->elements.get();
+    const int* source = m.elements.get();
+    for(size_t i = 0; i < getStorageSize(); i++)
+    {
+        target[i] -= source[i];
+    }
+    return *this;
+}
+
+/**
+ *  \brief Addition of same kind packed matrices
+ *  \param [in] a const PackedMatrix&
+ *  \param [in] b const PackedMatrix&
+ *  \return Addition of a and b
+ */
+PackedMatrix operator+(const PackedMatrix& a, const PackedMatrix& b)
+{
+	PackedMatrix t_a(a);
+	t_a += b;
+	return t_a;
+}
+
+/**
+ *  \brief Substraction of same kind packed matrices
+ *  \param [in] a const PackedMatrix&
+ *  \param [in] b const PackedMatrix&
+ *  \return Substraction of a and b
+ */
+PackedMatrix operator-(const PackedMatrix& a, const PackedMatrix& b)
+{
+	PackedMatrix t_a(a);
+	t_a -= b;
+	return t_a;
+}
+
+/**
+ *  \brief Triangular multiplication. Product of two upper or two lower triangular matrices stays triangular,
+ *      only terms inside the triangles are computed
+ *  \param [in] a const PackedMatrix& triangular matrix
+ *  \param [in] b const PackedMatrix& triangular matrix of same kind
+ *  \return PackedMatrix triangular dot-product of a and b
+ */
+PackedMatrix operator*(const PackedMatrix& a, const PackedMatrix& b)
+{
+    if(a.n != b.n)
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+    if(a.kind != b.kind || a.kind == PackedMatrix::Symmetric)
+    {
+        throw std::invalid_argument("operator requires triangular matrices of same kind");
+    }
+
+    PackedMatrix result;
+    result.kind = a.kind;
+    result.allocate(a.n);
+    size_t t_n = a.n;
+    bool upper = a.kind == PackedMatrix::Upper;
+
+    PackedMatrix::runTriangle(t_n, t_n * t_n, [&](size_t i)
+    {
+        // row i of result covers columns [first, last)
+        size_t first = upper ? i : 0;
+        size_t last = upper ? t_n : i + 1;
+        int* target = result.elements.get() + result.rowOffset(i);
+        std::fill(target, target + (last - first), 0);
+
+        const int* source = a.elements.get() + a.rowOffset(i);
+        for(size_t k = first; k < last; k++)
+        {
+            int value = source[k - first];
+            // row k of b covers columns [k, n) or [0, k], intersected with the columns of row i
+            const int* row = b.elements.get() + b.rowOffset(k);
+            if(upper)
+            {
+                for(size_t j = k; j < t_n; j++)
+                {
+                    target[j - i] += value * row[j - k];
+                }
+            }
+            else
+            {
+                for(size_t j = 0; j <= k; j++)
+                {
+                    target[j] += value * row[j];
+                }
+            }
+        }
+    });
+
+    return result;
+}
+
+/**
+ *  \brief Multiplication of packed and dense matrix. Zero triangle of triangular matrix is skipped
+ *  \param [in] a const PackedMatrix& packed left-hand side
+ *  \param [in] b const SquareMatrixView& dense right-hand side
+ *  \return SquareMatrix dot-product of a and b
+ */
+SquareMatrix operator*(const PackedMatrix& a, const SquareMatrixView& b)
+{
+    return PackedMatrix::multiplyDense(a, b);
+}
+
+/**
+ *  \brief Implementation of packed times dense multiplication, has access to storage of the result
+ *  \param [in] a const PackedMatrix& packed left-hand side
+ *  \param [in] b const SquareMatrixView& dense right-hand side
+ *  \return SquareMatrix dot-product of a and b
+ */
+SquareMatrix PackedMatrix::multiplyDense(const PackedMatrix& a, const SquareMatrixView& b)
+{
+    if(a.n != b.getDimension())
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    SquareMatrix result;
+    result.allocate(a.n);
+    size_t t_n = a.n;
+
+    runTriangle(t_n, t_n * t_n, [&](size_t i)
+    {
+        size_t first = a.kind == PackedMatrix::Upper ? i : 0;
+        size_t last = a.kind == PackedMatrix::Lower ? i + 1 : t_n;
+        int* target = result.elements.get() + i * t_n;
+        std::fill(target, target + t_n, 0);
+        for(size_t k = first; k < last; k++)
+        {
+            int value = a.at(i, k);
+            const int* row = b.row(k);
+            for(size_t j = 0; j < t_n; j++)
+            {
+                target[j] += value * row[j];
+            }
+        }
+    });
+
+    return result;
+}
+
+/**
+ *  \brief Write object to stream in dense form [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \param [in,out] stream std::ostream&
+ *  \param [in] m const PackedMatrix& m
+ *  \return stream appended by object
+ */
+std::ostream& operator<<(std::ostream& stream, const PackedMatrix& m)
+{
+	stream << "[";
+    for(int i = 0; i < m.n; i++)
+    {
+        stream << "[";
+        for(int j = 0; j < m.n; j++)
+        {
+            if(j != m.n - 1)
+            {
+                stream << m.at(i, j) << ",";
+            }
+            else
+            {
+                stream << m.at(i, j);
+            }
+        }
+        stream << "]";
+    }
+    stream << "]";
+
+    return stream;
+}
@@ -0,0 +1,68 @@
+#ifndef PACKEDMATRIX_H
+#define PACKEDMATRIX_H
+
+#include "intelement.h"
+#include "matrixpool.h"
+#include "squarematrix.h"
+#include "squarematrixview.h"
+
+#include <functional>
+#include <memory>
+#include <sstream>
+
+/**
+ * @file packedmatrix.h
+ * @version 1.0
+ * @brief Declaration of PackedMatrix
+ * @author Niko Lehto
+ */
+class PackedMatrix
+{
+public:
+    enum Kind
+    {
+        Symmetric, ///< a<SUB>ij</SUB> = a<SUB>ji</SUB>, upper triangle stored
+        Upper,     ///< a<SUB>ij</SUB> = 0 when i > j
+        Lower      ///< a<SUB>ij</SUB> = 0 when i < j
+    };
+
+private:
+	Kind kind = Symmetric;
+	int n = 0;
+	std::shared_ptr<int> elements; // n*(n+1)/2 elements of the stored triangle, row by row
+
+	void allocate(int n);
+	void detach();
+	size_t rowOffset(size_t row) const;
+	bool isStored(size_t row, size_t col) const;
+	int at(size_t row, size_t col) const;
+	static void runTriangle(size_t n, size_t pairCost, const std::function<void(size_t)>& work);
+	static SquareMatrix multiplyDense(const PackedMatrix& a, const SquareMatrixView& b);
+
+public:
+	PackedMatrix();
+	PackedMatrix(const SquareMatrixView& m, Kind kind);
+	PackedMatrix(const PackedMatrix& m);
+	~PackedMatrix();
+
+	static PackedMatrix syrk(const SquareMatrixView& a);
+
+	Kind getKind() const;
+	int getDimension() const;
+	size_t getStorageSize() const;
+	IntElement getElement(size_t row, size_t col) const;
+	SquareMatrix toSquareMatrix() const;
+	void print(std::ostream& os) const;
+	std::string toString() const;
+
+	bool operator==(const PackedMatrix& m) const;
+	PackedMatrix& operator=(const PackedMatrix& m);
+	PackedMatrix& operator+=(const PackedMatrix& m);
+	PackedMatrix& operator-=(const PackedMatrix& m);
+	friend PackedMatrix operator+(const PackedMatrix& a, const PackedMatrix& b);
+	friend PackedMatrix operator-(const PackedMatrix& a, const PackedMatrix& b);
+	friend PackedMatrix operator*(const PackedMatrix& a, const PackedMatrix& b);
+	friend SquareMatrix operator*(const PackedMatrix& a, const SquareMatrixView& b);
+	friend std::ostream& operator<<(std::ostream& stream, const PackedMatrix& m);
+};
+#endif
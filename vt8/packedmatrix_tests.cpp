@@ -0,0 +1,50 @@
+#include "catch.hpp"
+#include "packedmatrix.h"
+
+/**
+ *  @file packedmatrix_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for PackedMatrix class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for PackedMatrix, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("PackedMatrix", "[PackedMatrix]")
+{
+    SquareMatrix a("[[1,2,3][4,5,6][7,8,9]]");
+    SquareMatrix upper("[[1,2,3][0,4,5][0,0,6]]");
+    SquareMatrix lower("[[1,0,0][2,3,0][4,5,6]]");
+
+    PackedMatrix gram = PackedMatrix::syrk(a);
+    REQUIRE(gram.getKind() == PackedMatrix::Symmetric);
+    REQUIRE(gram.getStorageSize() == 6);
+    REQUIRE(gram.toSquareMatrix() == a * a.transpose());
+    REQUIRE(gram == PackedMatrix(a * a.transpose(), PackedMatrix::Symmetric));
+    REQUIRE(gram.getElement(2, 0) == gram.getElement(0, 2));
+    REQUIRE(gram.toString() == (a * a.transpose()).toString());
+
+    PackedMatrix pu(upper, PackedMatrix::Upper), pl(lower, PackedMatrix::Lower);
+    REQUIRE(pu.toSquareMatrix() == upper);
+    REQUIRE(pl.toSquareMatrix() == lower);
+    REQUIRE(pl.getElement(0, 2) == IntElement(0));
+    REQUIRE((pu * pu).toSquareMatrix() == upper * upper);
+    REQUIRE((pl * pl).toSquareMatrix() == lower * lower);
+    REQUIRE(pu * a == upper * a);
+    REQUIRE(pl * a == lower * a);
+    REQUIRE(gram * a == (a * a.transpose()) * a);
+    REQUIRE((pu + pu).toSquareMatrix() == upper + upper);
+    REQUIRE((pl - pl).toSquareMatrix() == lower - lower);
+
+    REQUIRE_THROWS_WITH(PackedMatrix(a, PackedMatrix::Symmetric), "Matrix is not symmetric");
+    REQUIRE_THROWS_WITH(PackedMatrix(lower, PackedMatrix::Upper), "Matrix is not triangular");
+    REQUIRE_THROWS_WITH(pu * pl, "operator requires triangular matrices of same kind");
+    REQUIRE_THROWS_WITH(pu + pl, "operator requires same sized matrices of same kind");
+    REQUIRE_THROWS_AS(pu.getElement(3, 0), std::out_of_range);
+
+    PackedMatrix copy(pu);
+    copy += pu;
+    REQUIRE(pu.toSquareMatrix() == upper);
+}
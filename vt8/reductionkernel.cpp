@@ -0,0 +1,215 @@
+#include "reductionkernel.h"
+
+#include <algorithm>
+#include <climits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ *  @file reductionkernel.cpp
+ *  @brief Implementation of ReductionKernel
+ *  */
+
+ /**
+ *  @class ReductionKernel
+ *  @version 1.0
+ *  @brief Reductions of a row of elements for SquareMatrix::sum, rowSums, columnSums, frobeniusNorm, maxAbs,
+ *      minElement and maxElement. With AVX2 each loads 8 elements at a time into ymm accumulators: sums widen to
+ *      64 bits so they are exact, squares are summed as doubles, and extremes use packed min and max. Otherwise
+ *      portable loops are used. Callers split rows between workers and combine the results of rows
+ *  @author Niko Lehto
+ *  */
+
+#if defined(__AVX2__)
+/**
+ *  \brief Sum of the 4 lanes
+ *  \param [in] v __m256i 64-bit lanes
+ *  \return int64_t sum
+ */
+static int64_t horizontalSum(__m256i v)
+{
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1);
+}
+
+/**
+ *  \brief 8 lanes folded into one with operation
+ *  \param [in] v __m256i 32-bit lanes
+ *  \param [in] operation Operation packed min or max of 32-bit lanes
+ *  \return int lane 0 of the result
+ */
+template<class Operation>
+static int horizontal(__m256i v, Operation operation)
+{
+    __m128i folded = operation(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    folded = operation(folded, _mm_shuffle_epi32(folded, _MM_SHUFFLE(1, 0, 3, 2)));
+    folded = operation(folded, _mm_shuffle_epi32(folded, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(folded);
+}
+#endif
+
+/**
+ *  \brief Exact sum
+ *  \param [in] x const int* elements
+ *  \param [in] count size_t number of elements, below 2<SUP>32</SUP> so that the sum fits into 64 bits
+ *  \return int64_t sum of elements
+ */
+int64_t ReductionKernel::sum(const int* x, size_t count)
+{
+    size_t j = 0;
+    int64_t result = 0;
+#if defined(__AVX2__)
+    __m256i sum0 = _mm256_setzero_si256();
+    __m256i sum1 = _mm256_setzero_si256();
+    for(; j + 8 <= count; j += 8)
+    {
+        sum0 = _mm256_add_epi64(sum0, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + j))));
+        sum1 = _mm256_add_epi64(sum1, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + j + 4))));
+    }
+    result = horizontalSum(_mm256_add_epi64(sum0, sum1));
+#endif
+    for(; j < count; j++)
+    {
+        result += x[j];
+    }
+    return result;
+}
+
+/**
+ *  \brief Sum of squares in double precision
+ *  \param [in] x const int* elements
+ *  \param [in] count size_t number of elements
+ *  \return double sum of x<SUB>j</SUB><SUP>2</SUP>, relative error about count times machine epsilon at most
+ */
+double ReductionKernel::sumOfSquares(const int* x, size_t count)
+{
+    size_t j = 0;
+    double result = 0;
+#if defined(__AVX2__)
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    for(; j + 8 <= count; j += 8)
+    {
+        __m256d low = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + j)));
+        __m256d high = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + j + 4)));
+#if defined(__FMA__)
+        sum0 = _mm256_fmadd_pd(low, low, sum0);
+        sum1 = _mm256_fmadd_pd(high, high, sum1);
+#else
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(low, low));
+        sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(high, high));
+#endif
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for(; j < count; j++)
+    {
+        double value = x[j];
+        result += value * value;
+    }
+    return result;
+}
+
+/**
+ *  \brief Largest absolute value
+ *  \param [in] x const int* elements
+ *  \param [in] count size_t number of elements
+ *  \return int64_t largest |x<SUB>j</SUB>|, 2<SUP>31</SUP> for INT_MIN and 0 for no elements
+ */
+int64_t ReductionKernel::maxAbs(const int* x, size_t count)
+{
+    size_t j = 0;
+    uint32_t result = 0;
+#if defined(__AVX2__)
+    // abs of INT_MIN stays 0x80000000, which is 2^31 as unsigned
+    __m256i largest = _mm256_setzero_si256();
+    for(; j + 8 <= count; j += 8)
+    {
+        largest = _mm256_max_epu32(largest, _mm256_abs_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j))));
+    }
+    result = static_cast<uint32_t>(horizontal(largest, [](__m128i a, __m128i b) { return _mm_max_epu32(a, b); }));
+#endif
+    for(; j < count; j++)
+    {
+        uint32_t value = static_cast<uint32_t>(x[j]);
+        result = std::max(result, x[j] < 0 ? 0 - value : value);
+    }
+    return result;
+}
+
+/**
+ *  \brief Smallest element
+ *  \param [in] x const int* elements
+ *  \param [in] count size_t number of elements
+ *  \return int smallest x<SUB>j</SUB>, INT_MAX for no elements
+ */
+int ReductionKernel::min(const int* x, size_t count)
+{
+    size_t j = 0;
+    int result = INT_MAX;
+#if defined(__AVX2__)
+    __m256i smallest = _mm256_set1_epi32(INT_MAX);
+    for(; j + 8 <= count; j += 8)
+    {
+        smallest = _mm256_min_epi32(smallest, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j)));
+    }
+    result = horizontal(smallest, [](__m128i a, __m128i b) { return _mm_min_epi32(a, b); });
+#endif
+    for(; j < count; j++)
+    {
+        result = std::min(result, x[j]);
+    }
+    return result;
+}
+
+/**
+ *  \brief Largest element
+ *  \param [in] x const int* elements
+ *  \param [in] count size_t number of elements
+ *  \return int largest x<SUB>j</SUB>, INT_MIN for no elements
+ */
+int ReductionKernel::max(const int* x, size_t count)
+{
+    size_t j = 0;
+    int result = INT_MIN;
+#if defined(__AVX2__)
+    __m256i largest = _mm256_set1_epi32(INT_MIN);
+    for(; j + 8 <= count; j += 8)
+    {
+        largest = _mm256_max_epi32(largest, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j)));
+    }
+    result = horizontal(largest, [](__m128i a, __m128i b) { return _mm_max_epi32(a, b); });
+#endif
+    for(; j < count; j++)
+    {
+        result = std::max(result, x[j]);
+    }
+    return result;
+}
+
+/**
+ *  \brief Elementwise sums[j] += x[j] into 64-bit sums
+ *  \param [in,out] sums int64_t* sums to add into
+ *  \param [in] x const int* elements to add
+ *  \param [in] count size_t number of elements
+ */
+void ReductionKernel::addTo(int64_t* sums, const int* x, size_t count)
+{
+    size_t j = 0;
+#if defined(__AVX2__)
+    for(; j + 4 <= count; j += 4)
+    {
+        __m256i value = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + j)));
+        __m256i* target = reinterpret_cast<__m256i*>(sums + j);
+        _mm256_storeu_si256(target, _mm256_add_epi64(_mm256_loadu_si256(target), value));
+    }
+#endif
+    for(; j < count; j++)
+    {
+        sums[j] += x[j];
+    }
+}
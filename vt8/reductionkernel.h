@@ -0,0 +1,23 @@
+#ifndef REDUCTIONKERNEL_H
+#define REDUCTIONKERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file reductionkernel.h
+ * @version 1.0
+ * @brief Declaration of ReductionKernel
+ * @author Niko Lehto
+ */
+class ReductionKernel
+{
+public:
+	static int64_t sum(const int* x, size_t count);
+	static double sumOfSquares(const int* x, size_t count);
+	static int64_t maxAbs(const int* x, size_t count);
+	static int min(const int* x, size_t count);
+	static int max(const int* x, size_t count);
+	static void addTo(int64_t* sums, const int* x, size_t count);
+};
+#endif
@@ -0,0 +1,68 @@
+#include "catch.hpp"
+#include "reductionkernel.h"
+
+#include <climits>
+#include <cmath>
+#include <vector>
+
+/**
+ *  @file reductionkernel_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for ReductionKernel class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for ReductionKernel, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("ReductionKernel", "[ReductionKernel]")
+{
+    REQUIRE(ReductionKernel::sum(nullptr, 0) == 0);
+    REQUIRE(ReductionKernel::maxAbs(nullptr, 0) == 0);
+    REQUIRE(ReductionKernel::min(nullptr, 0) == INT_MAX);
+    REQUIRE(ReductionKernel::max(nullptr, 0) == INT_MIN);
+
+    // lengths around SIMD widths, extremes placed in the vector part and in the tail
+    for(size_t count : {1, 3, 4, 7, 8, 9, 16, 17, 100})
+    {
+        std::vector<int> x(count);
+        for(size_t j = 0; j < count; j++)
+        {
+            x[j] = static_cast<int>(j * 2654435761u % 2001) - 1000;
+        }
+        for(size_t place : {static_cast<size_t>(0), count / 2, count - 1})
+        {
+            std::vector<int> y(x);
+            y[place] = INT_MAX;
+            y[count - 1 - place] = INT_MIN;
+
+            int64_t sum = 0;
+            double squares = 0;
+            int low = INT_MAX, high = INT_MIN;
+            for(int value : y)
+            {
+                sum += value;
+                squares += static_cast<double>(value) * value;
+                low = std::min(low, value);
+                high = std::max(high, value);
+            }
+            REQUIRE(ReductionKernel::sum(y.data(), count) == sum);
+            REQUIRE(std::fabs(ReductionKernel::sumOfSquares(y.data(), count) - squares) <= squares * 1e-15);
+            REQUIRE(ReductionKernel::min(y.data(), count) == low);
+            REQUIRE(ReductionKernel::max(y.data(), count) == high);
+            REQUIRE(ReductionKernel::maxAbs(y.data(), count) == (int64_t(1) << 31));
+
+            std::vector<int64_t> sums(count, 5);
+            ReductionKernel::addTo(sums.data(), y.data(), count);
+            REQUIRE(sums[place] == int64_t(5) + y[place]);
+            REQUIRE(sums[count - 1 - place] == int64_t(5) + y[count - 1 - place]);
+        }
+        int64_t largest = 0;
+        for(int value : x)
+        {
+            largest = std::max<int64_t>(largest, std::abs(value));
+        }
+        REQUIRE(ReductionKernel::maxAbs(x.data(), count) == largest);
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef SEMIRING_H
+#define SEMIRING_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @file semiring.h
+ * @version 1.0
+ * @brief Declaration of Semiring
+ * @author Niko Lehto
+ */
+
+/**
+ *  @class Semiring
+ *  @version 1.0
+ *  @brief Semirings for SquareMatrix::product. A semiring policy has zero(), the identity of add which also annihilates
+ *      in multiply, and exact add(a, b) and multiply(a, b). SquareMatrix::power also needs one(), the identity of
+ *      multiply. Policies that also have encode, decode, packable, packedAdd and packedMultiply run in the SIMD
+ *      kernel of SemiringKernel: operands are encoded while packed, the kernel
+ *      uses only packedAdd and packedMultiply, and sums are decoded before they are added to the result. This is
+ *      used when every element of both operands is packable, otherwise the kernel falls back to add and multiply
+ *  @author Niko Lehto
+ *  */
+class Semiring
+{
+public:
+    /**
+     *  \brief Ordinary sum of products, wraps modulo 2<SUP>32</SUP> like operator*
+     */
+    struct PlusTimes
+    {
+        static const char* name() { return "plus-times"; }
+        static int zero() { return 0; }
+        static int one() { return 1; }
+        static int add(int a, int b) { return static_cast<int>(static_cast<unsigned int>(a) + static_cast<unsigned int>(b)); }
+        static int multiply(int a, int b) { return static_cast<int>(static_cast<unsigned int>(a) * static_cast<unsigned int>(b)); }
+
+        static bool packable(int) { return true; }
+        static int encode(int x) { return x; }
+        static int decode(int x) { return x; }
+        static int packedAdd(int a, int b) { return add(a, b); }
+        static int packedMultiply(int a, int b) { return multiply(a, b); }
+#if defined(__AVX2__)
+        static __m256i packedAdd(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+        static __m256i packedMultiply(__m256i a, __m256i b) { return _mm256_mullo_epi32(a, b); }
+#endif
+    };
+
+    /**
+     *  \brief Tropical (min, +) for shortest paths. INT_MAX is infinity, no path. Sums saturate to INT_MIN and INT_MAX.
+     *      Packed kernel needs finite elements in (-2<SUP>28</SUP>, 2<SUP>28</SUP>): infinity is packed as
+     *      2<SUP>30</SUP>-1 so that no sum overflows, and sums from 2<SUP>29</SUP> up are infinite
+     */
+    struct MinPlus
+    {
+        static const int infinity = INT_MAX;
+        static const int packedInfinity = (1 << 30) - 1;
+        static const int packedLimit = 1 << 28;
+
+        static const char* name() { return "min-plus"; }
+        static int zero() { return infinity; }
+        static int one() { return 0; }
+        static int add(int a, int b) { return std::min(a, b); }
+        static int multiply(int a, int b)
+        {
+            if(a == infinity || b == infinity)
+            {
+                return infinity;
+            }
+            return static_cast<int>(std::min<int64_t>(INT_MAX, std::max<int64_t>(INT_MIN, static_cast<int64_t>(a) + b)));
+        }
+
+        static bool packable(int x) { return x == infinity || (x > -packedLimit && x < packedLimit); }
+        static int encode(int x) { return x == infinity ? packedInfinity : x; }
+        static int decode(int x) { return x >= 2 * packedLimit ? infinity : x; }
+        static int packedAdd(int a, int b) { return std::min(a, b); }
+        static int packedMultiply(int a, int b) { return a + b; }
+#if defined(__AVX2__)
+        static __m256i packedAdd(__m256i a, __m256i b) { return _mm256_min_epi32(a, b); }
+        static __m256i packedMultiply(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+#endif
+    };
+
+    /**
+     *  \brief Tropical (max, +) for longest paths in schedules. INT_MIN is minus infinity, no path.
+     *      Sums saturate to INT_MIN and INT_MAX. Packed kernel mirrors MinPlus
+     */
+    struct MaxPlus
+    {
+        static const int infinity = INT_MIN;
+        static const int packedInfinity = -((1 << 30) - 1);
+        static const int packedLimit = 1 << 28;
+
+        static const char* name() { return "max-plus"; }
+        static int zero() { return infinity; }
+        static int one() { return 0; }
+        static int add(int a, int b) { return std::max(a, b); }
+        static int multiply(int a, int b)
+        {
+            if(a == infinity || b == infinity)
+            {
+                return infinity;
+            }
+            return static_cast<int>(std::min<int64_t>(INT_MAX, std::max<int64_t>(INT_MIN, static_cast<int64_t>(a) + b)));
+        }
+
+        static bool packable(int x) { return x == infinity || (x > -packedLimit && x < packedLimit); }
+        static int encode(int x) { return x == infinity ? packedInfinity : x; }
+        static int decode(int x) { return x <= -2 * packedLimit ? infinity : x; }
+        static int packedAdd(int a, int b) { return std::max(a, b); }
+        static int packedMultiply(int a, int b) { return a + b; }
+#if defined(__AVX2__)
+        static __m256i packedAdd(__m256i a, __m256i b) { return _mm256_max_epi32(a, b); }
+        static __m256i packedMultiply(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+#endif
+    };
+
+    /**
+     *  \brief Boolean (or, and) for reachability. Nonzero elements are true, results are 0 or 1
+     */
+    struct OrAnd
+    {
+        static const char* name() { return "or-and"; }
+        static int zero() { return 0; }
+        static int one() { return 1; }
+        static int add(int a, int b) { return a != 0 || b != 0; }
+        static int multiply(int a, int b) { return a != 0 && b != 0; }
+
+        static bool packable(int) { return true; }
+        static int encode(int x) { return x != 0; }
+        static int decode(int x) { return x; }
+        static int packedAdd(int a, int b) { return a | b; }
+        static int packedMultiply(int a, int b) { return a & b; }
+#if defined(__AVX2__)
+        static __m256i packedAdd(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+        static __m256i packedMultiply(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+#endif
+    };
+};
+#endif
@@ -0,0 +1,326 @@
+#ifndef SEMIRINGKERNEL_H
+#define SEMIRINGKERNEL_H
+
+#include "gemmkernel.h"
+#include "semiring.h"
+#include "squarematrixview.h"
+#include "tuning.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @file semiringkernel.h
+ * @version 1.0
+ * @brief Declaration and implementation of SemiringKernel
+ * @author Niko Lehto
+ */
+
+/**
+ *  @class SemiringKernel
+ *  @version 1.0
+ *  @brief Packed multiplication over semiring S with the same loops, block sizes and MR x NR register tile as
+ *      GemmKernel. The micro-kernel keeps a 6x16 tile of sums in twelve ymm registers with AVX2, so min-plus
+ *      is one vpaddd and one vpminsd per eight elements. Semirings without packed operations, and operands
+ *      with elements the packed operations can not represent, use the exact add and multiply of S instead
+ *  @author Niko Lehto
+ *  */
+template<class S>
+class SemiringKernel
+{
+public:
+    static const size_t rowRegisters = GemmKernel::rowRegisters;
+    static const size_t columnRegisters = GemmKernel::columnRegisters;
+
+private:
+    template<class T, class = void>
+    struct HasPacked : std::false_type {};
+    template<class T>
+    struct HasPacked<T, decltype(static_cast<void>(T::packedAdd(0, T::packedMultiply(0, 0))))> : std::true_type {};
+
+    /**
+     *  \brief Element as stored in packed panels
+     *  \param [in] x int element
+     *  \param [in] packed bool panels are for the packed kernel
+     *  \return int encoded element if packed, x otherwise
+     */
+    static int encode(int x, bool packed)
+    {
+        if constexpr(HasPacked<S>::value)
+        {
+            if(packed)
+            {
+                return S::encode(x);
+            }
+        }
+        return x;
+    }
+
+    /**
+     *  \brief Packs rows [row, row+rows) x columns [depth, depth+depths) of lhs into micro-panels of MR rows stored
+     *      column by column. Missing rows of the last micro-panel are zero of S
+     *  \param [in] lhs const SquareMatrixView& left-hand side
+     *  \param [in] row size_t first row
+     *  \param [in] rows size_t number of rows
+     *  \param [in] depth size_t first column
+     *  \param [in] depths size_t number of columns
+     *  \param [in] packed bool encode for the packed kernel
+     *  \param [out] target int* ceil(rows/MR)*MR*depths elements
+     */
+    static void packLeft(const SquareMatrixView& lhs, size_t row, size_t rows, size_t depth, size_t depths, bool packed, int* target)
+    {
+        int zero = encode(S::zero(), packed);
+        for(size_t panel = 0; panel < rows; panel += rowRegisters)
+        {
+            size_t height = std::min(rowRegisters, rows - panel);
+            for(size_t i = 0; i < rowRegisters; i++)
+            {
+                const int* source = i < height ? lhs.row(row + panel + i) + depth : nullptr;
+                for(size_t p = 0; p < depths; p++)
+                {
+                    target[p * rowRegisters + i] = source != nullptr ? encode(source[p], packed) : zero;
+                }
+            }
+            target += rowRegisters * depths;
+        }
+    }
+
+    /**
+     *  \brief Packs rows [depth, depth+depths) x columns [column, column+columns) of m into micro-panels of NR columns
+     *      stored row by row. Missing columns of the last micro-panel are zero of S
+     *  \param [in] m const SquareMatrixView& right-hand side
+     *  \param [in] depth size_t first row
+     *  \param [in] depths size_t number of rows
+     *  \param [in] column size_t first column
+     *  \param [in] columns size_t number of columns
+     *  \param [in] packed bool encode for the packed kernel
+     *  \param [out] target int* ceil(columns/NR)*NR*depths elements
+     */
+    static void packRight(const SquareMatrixView& m, size_t depth, size_t depths, size_t column, size_t columns, bool packed, int* target)
+    {
+        int zero = encode(S::zero(), packed);
+        for(size_t panel = 0; panel < columns; panel += columnRegisters)
+        {
+            size_t width = std::min(columnRegisters, columns - panel);
+            for(size_t p = 0; p < depths; p++)
+            {
+                const int* source = m.row(depth + p) + column + panel;
+                int* row = target + p * columnRegisters;
+                for(size_t j = 0; j < columnRegisters; j++)
+                {
+                    row[j] = j < width ? encode(source[j], packed) : zero;
+                }
+            }
+            target += columnRegisters * depths;
+        }
+    }
+
+    /**
+     *  \brief Sums of products of a packed MR x depths micro-panel and a packed depths x NR micro-panel with the
+     *      packed operations of S, added into c after decoding
+     *  \param [in] depths size_t length of the sums
+     *  \param [in] a const int* packed left-hand side micro-panel
+     *  \param [in] b const int* packed right-hand side micro-panel
+     *  \param [in,out] c int* first element of result tile
+     *  \param [in] ldc size_t distance of result rows
+     *  \param [in] rows size_t rows of result tile to write, at most MR
+     *  \param [in] columns size_t columns of result tile to write, at most NR
+     */
+    static void microKernelPacked(size_t depths, const int* a, const int* b, int* c, size_t ldc, size_t rows, size_t columns)
+    {
+        alignas(64) int tile[rowRegisters][columnRegisters];
+        int zero = S::encode(S::zero());
+
+#if defined(__AVX2__)
+        __m256i acc[rowRegisters][2];
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            acc[i][0] = _mm256_set1_epi32(zero);
+            acc[i][1] = _mm256_set1_epi32(zero);
+        }
+        for(size_t p = 0; p < depths; p++)
+        {
+            __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + p * columnRegisters));
+            __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + p * columnRegisters + 8));
+            for(size_t i = 0; i < rowRegisters; i++)
+            {
+                __m256i value = _mm256_set1_epi32(a[p * rowRegisters + i]);
+                acc[i][0] = S::packedAdd(acc[i][0], S::packedMultiply(value, b0));
+                acc[i][1] = S::packedAdd(acc[i][1], S::packedMultiply(value, b1));
+            }
+        }
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i]), acc[i][0]);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i] + 8), acc[i][1]);
+        }
+#else
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            std::fill(tile[i], tile[i] + columnRegisters, zero);
+        }
+        for(size_t p = 0; p < depths; p++)
+        {
+            const int* row = b + p * columnRegisters;
+            for(size_t i = 0; i < rowRegisters; i++)
+            {
+                int value = a[p * rowRegisters + i];
+                for(size_t j = 0; j < columnRegisters; j++)
+                {
+                    tile[i][j] = S::packedAdd(tile[i][j], S::packedMultiply(value, row[j]));
+                }
+            }
+        }
+#endif
+
+        for(size_t i = 0; i < rows; i++)
+        {
+            int* target = c + i * ldc;
+            for(size_t j = 0; j < columns; j++)
+            {
+                target[j] = S::add(target[j], S::decode(tile[i][j]));
+            }
+        }
+    }
+
+    /**
+     *  \brief Sums of products of packed micro-panels with the exact operations of S, added into c
+     *  \param [in] depths size_t length of the sums
+     *  \param [in] a const int* packed left-hand side micro-panel
+     *  \param [in] b const int* packed right-hand side micro-panel
+     *  \param [in,out] c int* first element of result tile
+     *  \param [in] ldc size_t distance of result rows
+     *  \param [in] rows size_t rows of result tile to write, at most MR
+     *  \param [in] columns size_t columns of result tile to write, at most NR
+     */
+    static void microKernel(size_t depths, const int* a, const int* b, int* c, size_t ldc, size_t rows, size_t columns)
+    {
+        int tile[rowRegisters][columnRegisters];
+        for(size_t i = 0; i < rowRegisters; i++)
+        {
+            std::fill(tile[i], tile[i] + columnRegisters, S::zero());
+        }
+        for(size_t p = 0; p < depths; p++)
+        {
+            const int* row = b + p * columnRegisters;
+            for(size_t i = 0; i < rowRegisters; i++)
+            {
+                int value = a[p * rowRegisters + i];
+                for(size_t j = 0; j < columnRegisters; j++)
+                {
+                    tile[i][j] = S::add(tile[i][j], S::multiply(value, row[j]));
+                }
+            }
+        }
+
+        for(size_t i = 0; i < rows; i++)
+        {
+            int* target = c + i * ldc;
+            for(size_t j = 0; j < columns; j++)
+            {
+                target[j] = S::add(target[j], tile[i][j]);
+            }
+        }
+    }
+
+public:
+    /**
+     *  \brief Tells if the packed kernel can represent every element of m
+     *  \param [in] m const SquareMatrixView& operand
+     *  \return bool true if S has packed operations and all elements are packable
+     */
+    static bool packable(const SquareMatrixView& m)
+    {
+        if constexpr(HasPacked<S>::value)
+        {
+            size_t t_n = m.getDimension();
+            for(size_t i = 0; i < t_n; i++)
+            {
+                const int* row = m.row(i);
+                if(!std::all_of(row, row + t_n, [](int x) { return S::packable(x); }))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     *  \brief Adds, in S, the product of lhs and m into rows [start, stop) x columns [column_start, column_stop) of result
+     *  \param [in] start size_t first row
+     *  \param [in] stop size_t one past last row
+     *  \param [in] column_start size_t first column
+     *  \param [in] column_stop size_t one past last column
+     *  \param [in] lhs const SquareMatrixView& left-hand side
+     *  \param [in] m const SquareMatrixView& right-hand side
+     *  \param [in,out] result int* result elements
+     *  \param [in] ldc size_t distance of result rows
+     *  \param [in] tuning const Tuning::Profile& block sizes NC, KC and MC
+     *  \param [in] packed bool use packed operations, only if packable() is true for lhs and m
+     */
+    static void multiply(size_t start, size_t stop, size_t column_start, size_t column_stop,
+                         const SquareMatrixView& lhs, const SquareMatrixView& m, int* result, size_t ldc, const Tuning::Profile& tuning, bool packed)
+    {
+        size_t t_n = m.getDimension();
+        if(start >= stop || column_start >= column_stop || t_n == 0)
+        {
+            return;
+        }
+
+        size_t nc = std::max<size_t>(columnRegisters, tuning.columnBlock / columnRegisters * columnRegisters);
+        size_t kc = std::max<size_t>(1, tuning.depthBlock);
+        size_t mc = std::max<size_t>(rowRegisters, tuning.rowBlock / rowRegisters * rowRegisters);
+        nc = std::min(nc, (column_stop - column_start + columnRegisters - 1) / columnRegisters * columnRegisters);
+        kc = std::min(kc, t_n);
+        mc = std::min(mc, (stop - start + rowRegisters - 1) / rowRegisters * rowRegisters);
+
+        static thread_local std::vector<int> packedLeft, packedRight;
+        packedRight.resize(std::max(packedRight.size(), nc * kc));
+        packedLeft.resize(std::max(packedLeft.size(), mc * kc));
+
+        for(size_t jc = column_start; jc < column_stop; jc += nc)
+        {
+            size_t columns = std::min(nc, column_stop - jc);
+            for(size_t pc = 0; pc < t_n; pc += kc)
+            {
+                size_t depths = std::min(kc, t_n - pc);
+                packRight(m, pc, depths, jc, columns, packed, packedRight.data());
+
+                for(size_t ic = start; ic < stop; ic += mc)
+                {
+                    size_t rows = std::min(mc, stop - ic);
+                    packLeft(lhs, ic, rows, pc, depths, packed, packedLeft.data());
+
+                    for(size_t jr = 0; jr < columns; jr += columnRegisters)
+                    {
+                        for(size_t ir = 0; ir < rows; ir += rowRegisters)
+                        {
+                            int* c = result + (ic + ir) * ldc + jc + jr;
+                            const int* a = packedLeft.data() + ir * depths;
+                            const int* b = packedRight.data() + jr * depths;
+                            size_t height = std::min(rowRegisters, rows - ir);
+                            size_t width = std::min(columnRegisters, columns - jr);
+                            if constexpr(HasPacked<S>::value)
+                            {
+                                if(packed)
+                                {
+                                    microKernelPacked(depths, a, b, c, ldc, height, width);
+                                    continue;
+                                }
+                            }
+                            microKernel(depths, a, b, c, ldc, height, width);
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+template<class S> const size_t SemiringKernel<S>::rowRegisters;
+template<class S> const size_t SemiringKernel<S>::columnRegisters;
+#endif
@@ -0,0 +1,106 @@
+#include "catch.hpp"
+#include "squarematrix.h"
+
+#include <climits>
+
+/**
+ *  @file semiringkernel_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for SemiringKernel class
+ *  @author Niko Lehto
+ *  */
+
+/**
+ *  \brief Bottleneck (max, min) semiring without packed operations, runs in the exact kernel
+ */
+struct MaxMin
+{
+    static int zero() { return INT_MIN; }
+    static int add(int a, int b) { return std::max(a, b); }
+    static int multiply(int a, int b) { return std::min(a, b); }
+};
+
+/**
+ *  \brief Product over S by definition
+ *  \param [in] a const SquareMatrix& left-hand side
+ *  \param [in] b const SquareMatrix& right-hand side
+ *  \return SquareMatrix reference product
+ */
+template<class S>
+static SquareMatrix reference(const SquareMatrix& a, const SquareMatrix& b)
+{
+    int n = a.getDimension();
+    SquareMatrix result(n);
+    for(int i = 0; i < n; i++)
+    {
+        for(int j = 0; j < n; j++)
+        {
+            int sum = S::zero();
+            for(int k = 0; k < n; k++)
+            {
+                sum = S::add(sum, S::multiply(a.getElement(i, k).getVal(), b.getElement(k, j).getVal()));
+            }
+            result.setElement(i, j, IntElement(sum));
+        }
+    }
+    return result;
+}
+
+/**
+ *  \brief Unit tests for SemiringKernel, will run in main generated by catch.hpp
+ *  \return 0 if tests passes
+ */
+TEST_CASE("SemiringKernel", "[SemiringKernel]")
+{
+    const int inf = Semiring::MinPlus::infinity;
+    const int none = Semiring::MaxPlus::infinity;
+
+    // shortest paths of at most two steps, 0->1->2 is shorter than 0->2
+    SquareMatrix distances("[[0,1,5][" + std::to_string(inf) + ",0,2][" + std::to_string(inf) + "," + std::to_string(inf) + ",0]]");
+    SquareMatrix twoSteps = SquareMatrix::product<Semiring::MinPlus>(distances, distances);
+    REQUIRE(twoSteps.getElement(0, 2) == IntElement(3));
+    REQUIRE(twoSteps.getElement(2, 0) == IntElement(inf));
+    REQUIRE(twoSteps == reference<Semiring::MinPlus>(distances, distances));
+
+    SquareMatrix reach("[[0,1,0][0,0,7][0,0,0]]");
+    REQUIRE(SquareMatrix::product<Semiring::OrAnd>(reach, reach) == SquareMatrix("[[0,0,1][0,0,0][0,0,0]]"));
+    REQUIRE(SquareMatrix::product<Semiring::PlusTimes>(reach, reach) == reach * reach);
+    REQUIRE(Semiring::MinPlus::multiply(INT_MAX - 1, 5) == INT_MAX);
+    REQUIRE(Semiring::MaxPlus::multiply(INT_MIN + 1, -5) == INT_MIN);
+
+    // sizes around register tiles and blocks, with infinities, with and without the packed kernel
+    Tuning::Profile original = Tuning::getProfile();
+    Tuning::Profile small = original;
+    small.depthBlock = 9;
+    small.columnBlock = 20;
+    small.rowBlock = 7;
+    Tuning::setProfile(small);
+    for(int n : {1, 5, 17, 40})
+    {
+        for(int scale : {1000, 1 << 29})
+        {
+            SquareMatrix a(n), b(n), c(n), d(n);
+            for(int i = 0; i < n; i++)
+            {
+                for(int j = 0; j < n; j++)
+                {
+                    int x = ((i * 31 + j * 17) % 23 - 11) * (scale / 16);
+                    int y = ((i * 7 + j * 13) % 19 - 9) * (scale / 16);
+                    a.setElement(i, j, IntElement((i + j) % 5 == 0 ? inf : x));
+                    b.setElement(i, j, IntElement((i * j) % 7 == 3 ? inf : y));
+                    c.setElement(i, j, IntElement((i + j) % 5 == 0 ? none : x));
+                    d.setElement(i, j, IntElement((i * j) % 7 == 3 ? none : y));
+                }
+            }
+            REQUIRE(SemiringKernel<Semiring::MinPlus>::packable(a) == (scale == 1000 || n == 1));
+            REQUIRE(SquareMatrix::product<Semiring::MinPlus>(a, b) == reference<Semiring::MinPlus>(a, b));
+            REQUIRE(SquareMatrix::product<Semiring::MaxPlus>(c, d) == reference<Semiring::MaxPlus>(c, d));
+            REQUIRE(SquareMatrix::product<Semiring::OrAnd>(c, d) == reference<Semiring::OrAnd>(c, d));
+            REQUIRE(SquareMatrix::product<MaxMin>(a, b) == reference<MaxMin>(a, b));
+        }
+    }
+    Tuning::setProfile(original);
+
+    REQUIRE_FALSE(SemiringKernel<MaxMin>::packable(reach));
+    REQUIRE_THROWS_WITH(SquareMatrix::product<Semiring::MinPlus>(reach, SquareMatrix(2)), "operator requires same sized matrices");
+}
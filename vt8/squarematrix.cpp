@@ -1,4 +1,15 @@
 #include "squarematrix.h"
+#include "executionpolicy.h"
+#include "gemmkernel.h"
+#include "modularelimination.h"
+#include "numatopology.h"
+#include "reductionkernel.h"
+#include "tuning.h"
+
+#include <climits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
 
 /**
  *  @file squarematrix.cpp
@@ -12,6 +23,16 @@
  *  @author Niko Lehto
  *  */
 
+/**
+ *  \brief Copy-on-write mode for clone constructor and assignment, enabled by default
+ */
+std::atomic<bool> SquareMatrix::copyOnWrite(true);
+
+/**
+ *  \brief Freivalds rounds run after every operator*=, 0 by default to skip the check
+ */
+std::atomic<int> SquareMatrix::productCheck(0);
+
 /**
  *  \brief Empty constructor
  */
@@ -35,39 +56,177 @@ SquareMatrix::SquareMatrix(int n)
 {
     unsigned int seed = time(0);
 
+    allocate(n);
+
+    // each worker fills its own rows, so pages are first touched by the thread that generated them
+    runParallel(n, n, [&](size_t worker_start, size_t worker_stop)
+    {
+        std::srand(seed + worker_start);
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            int* row = this->elements.get() + i * n;
+            std::generate(row, row + n, std::rand);
+        }
+    });
+}
+
+/**
+ *  \brief Constructs a matrix by copying the elements of viewed block
+ *  \param [in] v const SquareMatrixView& block to copy
+ */
+SquareMatrix::SquareMatrix(const SquareMatrixView& v)
+{
+    allocate(v.getDimension());
+    for(int i = 0; i < n; i++)
+    {
+        std::copy(v.row(i), v.row(i) + n, this->elements.get() + static_cast<size_t>(i) * n);
+    }
+}
+
+/**
+ *  \brief Clone constructor. In copy-on-write mode the storage is shared until either matrix is modified
+ *  \param [in] i const SquareMatrix& object to clone
+ */
+SquareMatrix::SquareMatrix(const SquareMatrix& i)
+{
+    this->elements = i.elements;
+    this->n = i.n;
+    if(!copyOnWrite)
+    {
+        detach();
+    }
+}
+
+/**
+ *  \brief Destructor
+ */
+SquareMatrix::~SquareMatrix() = default;
+
+/**
+ *  \brief Replaces storage with uninitialized n*n buffer from MatrixPool
+ *  \param [in] n int dimension of square matrix
+ */
+void SquareMatrix::allocate(int n)
+{
+    if(n < 0)
+    {
+        throw std::invalid_argument("Matrix dimension can not be negative");
+    }
     this->n = n;
+    this->elements = MatrixPool::instance().allocate(static_cast<size_t>(n) * n);
+}
+
+/**
+ *  \brief Gives this matrix storage of its own by copying the elements if storage is shared with another matrix.
+ *      Must be called before any modification of elements
+ */
+void SquareMatrix::detach()
+{
+    if(this->elements.use_count() > 1)
+    {
+        std::shared_ptr<int> shared = this->elements;
+        allocate(this->n);
+        std::copy(shared.get(), shared.get() + static_cast<size_t>(n) * n, this->elements.get());
+    }
+}
+
+/**
+ *  \brief Smallest dimension for which multiplication copies right-hand side to every NUMA node
+ */
+static const int numaReplicaThreshold = 256;
 
-    this->elements.reserve(n);
+/**
+ *  \brief Counters of runParallel decisions
+ */
+static std::atomic<size_t> serialRuns(0), partialRuns(0), fullRuns(0), threadsStarted(0);
 
-    unsigned int threadsSupported = std::thread::hardware_concurrency();
-    if(threadsSupported == 0)
+/**
+ *  \brief Getter for number of workers an operation may use
+ *  \param [in] policy const ExecutionPolicy::Policy& policy of calling thread
+ *  \return unsigned int 1 for serial policy, thread count of policy, or tuning profile threads
+ *      limited to usable cpus, or usable cpus
+ */
+static unsigned int maxWorkers(const ExecutionPolicy::Policy& policy)
+{
+    if(policy.mode == ExecutionPolicy::Serial)
+    {
+        return 1;
+    }
+    if(policy.threads != 0)
     {
-        threadsSupported = 8; // anything should be fine
+        return policy.threads;
     }
 
-    std::vector<std::thread> workers;
-    std::mutex elementlock;
+    unsigned int usable = ExecutionPolicy::usableCpus(policy);
+    unsigned int tuned = Tuning::getProfile().threads;
+    return tuned != 0 ? std::min(tuned, usable) : usable;
+}
+
+/**
+ *  \brief Runs work in parallel by splitting rows into even strips. A worker is added only if each worker still gets
+ *      at least the parallel grain of the tuning profile, so small operations use fewer workers or run serially
+ *      on the calling thread without starting any. The execution policy of the calling thread limits the workers,
+ *      their cpus, and is inherited by them.
+ *      On NUMA machines consecutive strips go to the same node and workers are pinned to it. Rows a worker writes
+ *      into a new buffer are placed on its node by first touch; MatrixPool does not reuse large buffers there, as
+ *      reused pages would stay where an earlier owner touched them
+ *  \param [in] rows size_t number of rows to split
+ *  \param [in] rowCost size_t estimated element operations per row, e.g. n for addition and n*n for multiplication
+ *  \param [in] work const std::function<void(size_t, size_t)>& called with start and stop row of strip
+ */
+void SquareMatrix::runParallel(size_t rows, size_t rowCost, const std::function<void(size_t, size_t)>& work)
+{
+    size_t grain = std::max<size_t>(1, Tuning::getProfile().parallelGrain);
+    size_t totalCost = rows * std::max<size_t>(1, rowCost);
+    size_t threads = std::min(rows, totalCost / grain);
+
+    ExecutionPolicy::Policy policy;
+    unsigned int threadsSupported = 1;
+    if(threads > 1)
+    {
+        policy = ExecutionPolicy::current();
+        threadsSupported = maxWorkers(policy);
+        threads = std::min<size_t>(threads, threadsSupported);
+    }
+
+    if(threads <= 1)
+    {
+        serialRuns++;
+        work(0, rows);
+        return;
+    }
+    if(threads < threadsSupported)
+    {
+        partialRuns++;
+    }
+    else
+    {
+        fullRuns++;
+    }
+    threadsStarted += threads;
 
-	float step = n / (float) threadsSupported;
+    std::vector<std::thread> workers;
+    const NumaTopology& topology = NumaTopology::instance();
+    std::vector<int> cpus = ExecutionPolicy::workerCpus(policy);
 
-    for(size_t worker = 0; worker < threadsSupported; worker++)
+    for(size_t worker = 0; worker < threads; worker++)
     {
-		size_t worker_start = round(worker * step);
-		size_t worker_stop = round(((worker+1) * step));
+		size_t worker_start = rows * worker / threads;
+		size_t worker_stop = rows * (worker + 1) / threads;
 
-        workers.push_back(std::thread([&, worker_start, worker_stop]()
+        workers.push_back(std::thread([&work, &topology, &policy, &cpus, worker, threads, worker_start, worker_stop]()
         {
-            std::srand(seed + worker_start);
-            for(size_t i = worker_start; i < worker_stop; i++)
+            if(topology.getNodeCount() > 1)
+            {
+                topology.pinCurrentThread(topology.nodeOfWorker(worker, threads), cpus);
+            }
+            else if(!policy.cpus.empty())
             {
-                std::vector<IntElement> intEls(n);
-                std::generate(intEls.begin(), intEls.end(), std::rand);
-                elementlock.lock();
-                this->elements.push_back(intEls);
-                elementlock.unlock();
+                ExecutionPolicy::pinCurrentThread(cpus);
             }
+            ExecutionPolicy::Scope inherited(policy);
+            work(worker_start, worker_stop);
         }));
-
     }
 
     std::for_each(workers.begin(), workers.end(), [](std::thread &t)
@@ -77,19 +236,241 @@ SquareMatrix::SquareMatrix(int n)
 }
 
 /**
- *  \brief Clone constructor
- *  \param [in] i const SquareMatrix& object to clone
+ *  \brief Parses matrix on the shared task pool
+ *  \param [in] s const std::string& matrix in the form of [[1,2][3,4]]
+ *  \return MatrixTask task of parsed matrix, get() throws std::invalid_argument on bad input
  */
-SquareMatrix::SquareMatrix(const SquareMatrix& i)
+MatrixTask SquareMatrix::parseAsync(const std::string& s)
 {
-    this->elements = i.elements;
-    this->n = i.n;
+    return MatrixTask::run([s]()
+    {
+        return SquareMatrix(s);
+    });
 }
 
 /**
- *  \brief Destructor
+ *  \brief Adds results of two tasks when both are ready
+ *  \param [in] a const MatrixTask& left operand
+ *  \param [in] b const MatrixTask& right operand
+ *  \return MatrixTask task of a + b
  */
-SquareMatrix::~SquareMatrix() = default;
+MatrixTask SquareMatrix::addAsync(const MatrixTask& a, const MatrixTask& b)
+{
+    return MatrixTask::when({a, b}, [](const std::vector<const SquareMatrix*>& operands)
+    {
+        return *operands[0] + *operands[1];
+    });
+}
+
+/**
+ *  \brief Multiplies results of two tasks when both are ready
+ *  \param [in] a const MatrixTask& left operand
+ *  \param [in] b const MatrixTask& right operand
+ *  \return MatrixTask task of a * b
+ */
+MatrixTask SquareMatrix::multiplyAsync(const MatrixTask& a, const MatrixTask& b)
+{
+    return MatrixTask::when({a, b}, [](const std::vector<const SquareMatrix*>& operands)
+    {
+        return *operands[0] * *operands[1];
+    });
+}
+
+/**
+ *  \brief Transposes result of a task when it is ready
+ *  \param [in] m const MatrixTask& matrix to transpose
+ *  \return MatrixTask task of transpose
+ */
+MatrixTask SquareMatrix::transposeAsync(const MatrixTask& m)
+{
+    return m.then([](const SquareMatrix& ready)
+    {
+        return ready.transpose();
+    });
+}
+
+/**
+ *  \brief Formats result of a task on the shared task pool when it is ready
+ *  \param [in] m const MatrixTask& matrix to format
+ *  \return std::future<std::string> toString() of matrix, or the exception of the task
+ */
+std::future<std::string> SquareMatrix::toStringAsync(const MatrixTask& m)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> result = promise->get_future();
+
+    m.onReady([m, promise]()
+    {
+        MatrixTask::submit([m, promise]()
+        {
+            try
+            {
+                promise->set_value(m.get().toString());
+            }
+            catch(...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        });
+    });
+    return result;
+}
+
+/**
+ *  \brief Getter for parallel execution statistics and thresholds
+ *  \return ParallelStats how many operations ran serially, with some or with all workers
+ */
+SquareMatrix::ParallelStats SquareMatrix::getParallelStats()
+{
+    ParallelStats stats;
+    stats.serialRuns = serialRuns;
+    stats.partialRuns = partialRuns;
+    stats.fullRuns = fullRuns;
+    stats.threadsStarted = threadsStarted;
+    stats.grain = Tuning::getProfile().parallelGrain;
+    stats.maxThreads = maxWorkers(ExecutionPolicy::current());
+    return stats;
+}
+
+/**
+ *  \brief Zeroes parallel execution counters
+ */
+void SquareMatrix::resetParallelStats()
+{
+    serialRuns = 0;
+    partialRuns = 0;
+    fullRuns = 0;
+    threadsStarted = 0;
+}
+
+/**
+ *  \brief Enables or disables copy-on-write mode for subsequent copies
+ *  \param [in] enabled bool true to share storage between copies, false to copy elements immediately
+ */
+void SquareMatrix::setCopyOnWrite(bool enabled)
+{
+    copyOnWrite = enabled;
+}
+
+/**
+ *  \brief Getter for copy-on-write mode
+ *  \return bool true if copies share storage until modified
+ */
+bool SquareMatrix::isCopyOnWrite()
+{
+    return copyOnWrite;
+}
+
+/**
+ *  \brief Sets post-check of operator*=, each product is verified with verifyProduct before it is stored
+ *  \param [in] rounds int Freivalds rounds per product, 0 disables the check
+ */
+void SquareMatrix::setProductCheck(int rounds)
+{
+    productCheck = std::max(rounds, 0);
+}
+
+/**
+ *  \brief Getter for post-check of operator*=
+ *  \return int Freivalds rounds per product, 0 when disabled
+ */
+int SquareMatrix::getProductCheck()
+{
+    return productCheck;
+}
+
+/**
+ *  \brief Checks whether this and m currently share the same element storage
+ *  \param [in] m const SquareMatrix& matrix to compare with
+ *  \return bool true if storage is shared
+ */
+bool SquareMatrix::isSharedWith(const SquareMatrix& m) const
+{
+    return this->elements == m.elements;
+}
+
+/**
+ *  \brief Tells what kind of memory holds the elements
+ *  \return MatrixPool::Backing heap, normal pages or huge pages
+ */
+MatrixPool::Backing SquareMatrix::getBacking() const
+{
+    return MatrixPool::instance().getBacking(this->elements.get());
+}
+
+/**
+ *  \brief Getter for single element
+ *  \param [in] row size_t row index starting from 0
+ *  \param [in] col size_t column index starting from 0
+ *  \return IntElement element at row, col
+ */
+IntElement SquareMatrix::getElement(size_t row, size_t col) const
+{
+    if(row >= static_cast<size_t>(n) || col >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    return IntElement(this->elements.get()[row * n + col]);
+}
+
+/**
+ *  \brief Setter for single element
+ *  \param [in] row size_t row index starting from 0
+ *  \param [in] col size_t column index starting from 0
+ *  \param [in] value const IntElement& new value for element
+ */
+void SquareMatrix::setElement(size_t row, size_t col, const IntElement& value)
+{
+    if(row >= static_cast<size_t>(n) || col >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    detach();
+    this->elements.get()[row * n + col] = value.getVal();
+}
+
+/**
+ *  \brief Makes view of a block of this matrix without copying
+ *  \param [in] row size_t first row of block
+ *  \param [in] col size_t first column of block
+ *  \param [in] size size_t dimension of block
+ *  \return SquareMatrixView size x size view starting from row, col
+ */
+SquareMatrixView SquareMatrix::block(size_t row, size_t col, size_t size) const
+{
+    return SquareMatrixView(*this).block(row, col, size);
+}
+
+/**
+ *  \brief Assigns elements of block into this matrix starting from row, col
+ *  \param [in] row size_t first row to overwrite
+ *  \param [in] col size_t first column to overwrite
+ *  \param [in] block const SquareMatrixView& elements to assign, may be a view of this matrix
+ */
+void SquareMatrix::setBlock(size_t row, size_t col, const SquareMatrixView& block)
+{
+    size_t size = block.getDimension();
+    if(row + size > static_cast<size_t>(n) || col + size > static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Block does not fit into matrix");
+    }
+
+    detach(); // a view of this matrix shares storage, so it keeps the original elements
+
+    for(size_t i = 0; i < size; i++)
+    {
+        std::copy(block.row(i), block.row(i) + size, this->elements.get() + (row + i) * n + col);
+    }
+}
+
+/**
+ *  \brief Getter for dimension
+ *  \return int dimension n of nxn matrix
+ */
+int SquareMatrix::getDimension() const
+{
+    return this->n;
+}
 
 /**
  *  \brief Saves a matrix from string of the form [[a<SUB>11</SUB>,...,a<SUB>1n</SUB>]...[a<SUB>n1</SUB>,...,a<SUB>nn</SUB>]]
@@ -121,6 +502,7 @@ void SquareMatrix::fromString(const std::string& matrix)
         throw std::invalid_argument("Should end \"]]\", Ended \"" + matrix.substr(len - 2, 2) + "\" instead");
 	}
 
+	std::vector<int> values;
 	size_t row_start_idx, row_end_idx;
 	row_start_idx = 2;
 	bool matrix_ends = false;
@@ -129,7 +511,6 @@ void SquareMatrix::fromString(const std::string& matrix)
 	size_t column_dimension = 0;
 	while(!matrix_ends)
 	{
-        std::vector<IntElement> temp;
 		// find end of new row
 		row_end_idx = matrix.find("][", row_start_idx);
 
@@ -169,7 +550,7 @@ void SquareMatrix::fromString(const std::string& matrix)
 
             // Try to initialize as IntElement
             const std::string token(matrix.substr(elem_start_idx, elem_end_idx - elem_start_idx));
-			temp.push_back(IntElement(token));
+			values.push_back(IntElement(token).getVal());
 			current_column_dimension++;
 
 			elem_start_idx = elem_end_idx + 1;
@@ -185,7 +566,6 @@ void SquareMatrix::fromString(const std::string& matrix)
 		    throw std::invalid_argument("All columns did not have same dimension ");
 		}
 		row_start_idx = row_end_idx + 2;
-        this->elements.push_back(temp);
 	}
 
 	if (row_dimension != column_dimension)
@@ -193,7 +573,8 @@ void SquareMatrix::fromString(const std::string& matrix)
 		throw std::invalid_argument("Not a square matrix. Found: " + std::to_string(row_dimension) + " X " + std::to_string(column_dimension) + "matrix");
 	}
 
-	this->n = static_cast<int>(row_dimension);
+	allocate(static_cast<int>(row_dimension));
+	std::copy(values.begin(), values.end(), this->elements.get());
 }
 
 /**
@@ -203,18 +584,7 @@ void SquareMatrix::fromString(const std::string& matrix)
 
 SquareMatrix SquareMatrix::transpose() const
 {
-    size_t t_n = this->elements.size();
-    SquareMatrix transpose(*this); // probably the quickest way - only for n*n
-
-    for(size_t x = 0; x < t_n; x++)
-    {
-        for(size_t y = 0; y < t_n; y++)
-        {
-            transpose.elements.at(y).at(x) = this->elements.at(x).at(y);
-        }
-    }
-
-    return transpose;
+    return SquareMatrixView(*this).transpose();
 }
 
 /**
@@ -250,6 +620,10 @@ SquareMatrix& SquareMatrix::operator=(const SquareMatrix& i)
 {
     this->elements = i.elements;
     this->n = i.n;
+    if(!copyOnWrite)
+    {
+        detach();
+    }
 	return *this;
 }
 
@@ -260,153 +634,928 @@ SquareMatrix& SquareMatrix::operator=(const SquareMatrix& i)
  */
 SquareMatrix& SquareMatrix::operator+=(const SquareMatrix& m)
 {
-    if(this->n != m.n)
-    {
-        throw std::invalid_argument("operator requires same sized matrices");
-    }
-
-    unsigned int threadsSupported = std::thread::hardware_concurrency();
-    if(threadsSupported == 0)
-    {
-        threadsSupported = 8; // anything should be fine
-    }
-
-    std::vector<std::thread> workers;
+    return *this += SquareMatrixView(m);
+}
 
-	size_t t_n = this->elements.size();
+ /**
+ *  \brief Substraction assignment. Performs matrix substraction by substracting right-hand side from the left-hand side of equation
+ *  \param [in] m const SquareMatrix& m
+ *  \return Reference to left-hand side matrix substracted by m
+ */
+SquareMatrix& SquareMatrix::operator-=(const SquareMatrix& m)
+{
+    return *this -= SquareMatrixView(m);
+}
 
-	float step = t_n / (float) threadsSupported;
+/**
+ *  \brief Multiplication assignment. Performs matrix dot product by multiplying right-hand side into left-hand side of equation
+ *  \param [in] i const SquareMatrix& i
+ *  \return Reference to left-hand side matrix multiplied by i
+ */
+SquareMatrix& SquareMatrix::operator*=(const SquareMatrix& i)
+{
+    return *this *= SquareMatrixView(i);
+}
 
-    for(size_t worker = 0; worker < threadsSupported; worker++)
+/**
+ *  \brief Addition assignment of a block. Performs matrix addition by adding viewed block into this matrix
+ *  \param [in] v const SquareMatrixView& v
+ *  \return Reference to left-hand side matrix added by v
+ */
+SquareMatrix& SquareMatrix::operator+=(const SquareMatrixView& v)
+{
+    if(this->n != v.getDimension())
     {
-		size_t worker_start = round(worker * step);
-		size_t worker_stop = round(((worker+1) * step));
-
-        workers.push_back(std::thread([&, worker_start, worker_stop]()
-        {
-            for(size_t i = worker_start; i < worker_stop; i++)
-            {
-                for(size_t j = 0; j < t_n; j++)
-                {
-                    this->elements.at(i).at(j) += m.elements[i][j];
-                }
-            }
-        }));
-
+        throw std::invalid_argument("operator requires same sized matrices");
     }
 
-    std::for_each(workers.begin(), workers.end(), [](std::thread &t)
+    detach();
+
+    runParallel(this->n, this->n, [&](size_t worker_start, size_t worker_stop)
     {
-        t.join();
+        addition_loop(worker_start, worker_stop, v);
     });
 
 	return *this;
 }
 
  /**
- *  \brief Substraction assignment. Performs matrix substraction by substracting right-hand side from the left-hand side of equation
- *  \param [in] m const SquareMatrix& m
- *  \return Reference to left-hand side matrix substracted by m
+ *  \brief Substraction assignment of a block. Performs matrix substraction by substracting viewed block from this matrix
+ *  \param [in] v const SquareMatrixView& v
+ *  \return Reference to left-hand side matrix substracted by v
  */
-SquareMatrix& SquareMatrix::operator-=(const SquareMatrix& m)
+SquareMatrix& SquareMatrix::operator-=(const SquareMatrixView& v)
 {
-    if(this->n != m.n)
+    if(this->n != v.getDimension())
     {
         throw std::invalid_argument("operator requires same sized matrices");
     }
 
-    unsigned int threadsSupported = std::thread::hardware_concurrency();
-    if(threadsSupported == 0)
+    detach();
+
+    runParallel(this->n, this->n, [&](size_t worker_start, size_t worker_stop)
     {
-        threadsSupported = 8; // anything should be fine
-    }
+        substraction_loop(worker_start, worker_stop, v);
+    });
 
-    std::vector<std::thread> workers;
+	return *this;
+}
 
-	size_t t_n = this->elements.size();
+/**
+ *  \brief Multiplication assignment of a block. Performs matrix dot product by multiplying viewed block into this matrix
+ *  \param [in] v const SquareMatrixView& v
+ *  \return Reference to left-hand side matrix multiplied by v
+ */
+SquareMatrix& SquareMatrix::operator*=(const SquareMatrixView& v)
+{
+    if(this->n != v.getDimension())
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
 
-	float step = t_n / (float) threadsSupported;
+    // result goes to a new pooled buffer, operands stay untouched until it is complete
+    SquareMatrix product = multiply(SquareMatrixView(*this), v);
+    int rounds = productCheck;
+    if(rounds > 0 && !verifyProduct(SquareMatrixView(*this), v, product, rounds))
+    {
+        throw std::runtime_error("Product verification failed");
+    }
+    this->elements = product.elements;
+
+	return *this;
+}
 
-    for(size_t worker = 0; worker < threadsSupported; worker++)
+/**
+ *  \brief Dot-product of two blocks into a new pooled matrix
+ *  \param [in] a const SquareMatrixView& left-hand side
+ *  \param [in] b const SquareMatrixView& right-hand side
+ *  \return SquareMatrix dot-product of a and b
+ */
+SquareMatrix SquareMatrix::multiply(const SquareMatrixView& a, const SquareMatrixView& b)
+{
+    if(a.getDimension() != b.getDimension())
     {
-		size_t worker_start = round(worker * step);
-		size_t worker_stop = round(((worker+1) * step));
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    SquareMatrix result;
+    result.allocate(a.getDimension());
+    result.gemm_parallel(1, a, b, 0);
 
-        workers.push_back(std::thread([&, worker_start, worker_stop]()
+    return result;
+}
+
+/**
+ *  \brief Freivalds' check of c = a * b in O(rounds n<SUP>2</SUP>). Each round compares a (b r) with c r for a
+ *      random vector r, in the same arithmetic modulo 2<SUP>32</SUP> as operator*. A wrong c passes a round with
+ *      probability at most 1/2, and at most 2<SUP>-32</SUP> when some element is off by an odd amount. Rounds run
+ *      in batches of 8 vectors so that a, b and c are read once per batch
+ *  \param [in] a const SquareMatrixView& left-hand side
+ *  \param [in] b const SquareMatrixView& right-hand side
+ *  \param [in] c const SquareMatrixView& product to verify
+ *  \param [in] rounds int random vectors to try, rounded up to a multiple of 8
+ *  \return bool false if c is certainly not a * b, true if every round agreed
+ */
+bool SquareMatrix::verifyProduct(const SquareMatrixView& a, const SquareMatrixView& b, const SquareMatrixView& c, int rounds)
+{
+    if(a.getDimension() != b.getDimension() || a.getDimension() != c.getDimension())
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+    if(rounds < 1)
+    {
+        throw std::invalid_argument("verification requires at least one round");
+    }
+
+    const size_t batch = 8;
+    size_t t_n = a.getDimension();
+    std::random_device device;
+    std::mt19937 generator(device());
+    std::vector<uint32_t> r(t_n * batch), y(t_n * batch); // row j holds element j of each vector
+
+    for(int done = 0; done < rounds; done += batch)
+    {
+        std::generate(r.begin(), r.end(), std::ref(generator));
+
+        runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
         {
             for(size_t i = worker_start; i < worker_stop; i++)
             {
+                const int* row = b.row(i);
+                uint32_t sums[batch] = {};
                 for(size_t j = 0; j < t_n; j++)
                 {
-                    this->elements.at(i).at(j) -= m.elements[i][j];
+                    uint32_t value = static_cast<uint32_t>(row[j]);
+                    const uint32_t* vector = r.data() + j * batch;
+                    for(size_t t = 0; t < batch; t++)
+                    {
+                        sums[t] += value * vector[t];
+                    }
                 }
+                std::copy(sums, sums + batch, y.data() + i * batch);
             }
-        }));
+        });
 
+        std::atomic<bool> equal(true);
+        runParallel(t_n, 2 * t_n, [&](size_t worker_start, size_t worker_stop)
+        {
+            for(size_t i = worker_start; i < worker_stop && equal; i++)
+            {
+                const int* left = a.row(i);
+                const int* product = c.row(i);
+                uint32_t sums[batch] = {};
+                for(size_t j = 0; j < t_n; j++)
+                {
+                    uint32_t value = static_cast<uint32_t>(left[j]);
+                    uint32_t expected = static_cast<uint32_t>(product[j]);
+                    const uint32_t* by = y.data() + j * batch;
+                    const uint32_t* cr = r.data() + j * batch;
+                    for(size_t t = 0; t < batch; t++)
+                    {
+                        sums[t] += value * by[t] - expected * cr[t];
+                    }
+                }
+                if(std::any_of(sums, sums + batch, [](uint32_t sum) { return sum != 0; }))
+                {
+                    equal = false;
+                }
+            }
+        });
+        if(!equal)
+        {
+            return false;
+        }
     }
+    return true;
+}
 
-    std::for_each(workers.begin(), workers.end(), [](std::thread &t)
+/**
+ *  \brief General matrix multiplication c = alpha * a * b + beta * c into existing matrix.
+ *      Allocates nothing when c has storage of its own that is not shared with a or b
+ *  \param [in,out] c SquareMatrix& result, must have same dimension as a and b
+ *  \param [in] a const SquareMatrixView& left-hand side
+ *  \param [in] b const SquareMatrixView& right-hand side
+ *  \param [in] alpha int scale of product
+ *  \param [in] beta int scale of original c, with 0 original values are ignored
+ */
+void SquareMatrix::gemm(SquareMatrix& c, const SquareMatrixView& a, const SquareMatrixView& b, int alpha, int beta)
+{
+    if(c.n != a.getDimension() || c.n != b.getDimension())
     {
-        t.join();
-    });
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
 
-	return *this;
+    c.detach(); // views of c keep the original elements, so a or b may be views of c
+    c.gemm_parallel(alpha, a, b, beta);
 }
 
 /**
- *  \brief Multiplication assignment. Performs matrix dot product by multiplying right-hand side into left-hand side of equation
- *  \param [in] i const SquareMatrix& i
- *  \return Reference to left-hand side matrix multiplied by i
+ *  \brief Scaled addition y = alpha * x + y into existing matrix
+ *  \param [in,out] y SquareMatrix& matrix to add into
+ *  \param [in] alpha int scale of x
+ *  \param [in] x const SquareMatrixView& matrix to add, same dimension as y
  */
-SquareMatrix& SquareMatrix::operator*=(const SquareMatrix& i)
+void SquareMatrix::axpy(SquareMatrix& y, int alpha, const SquareMatrixView& x)
 {
-    if(this->n != i.n)
+    if(y.n != x.getDimension())
     {
         throw std::invalid_argument("operator requires same sized matrices");
     }
 
-	SquareMatrix temp = *this;
+    y.detach();
+    size_t t_n = y.n;
 
-    unsigned int threadsSupported = std::thread::hardware_concurrency();
-    if(threadsSupported == 0)
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
     {
-        threadsSupported = 8; // anything should be fine
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            int* target = y.elements.get() + i * t_n;
+            const int* source = x.row(i);
+            for(size_t j = 0; j < t_n; j++)
+            {
+                target[j] += alpha * source[j];
+            }
+        }
+    });
+}
+
+/**
+ *  \brief Multiplies every element of y by alpha in place
+ *  \param [in,out] y SquareMatrix& matrix to scale
+ *  \param [in] alpha int scale
+ */
+void SquareMatrix::scale(SquareMatrix& y, int alpha)
+{
+    y.detach();
+    size_t t_n = y.n;
+
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        int* target = y.elements.get();
+        for(size_t i = worker_start * t_n; i < worker_stop * t_n; i++)
+        {
+            target[i] *= alpha;
+        }
+    });
+}
+
+/**
+ *  \brief Identity matrix of a semiring
+ *  \param [in] n int dimension of matrix
+ *  \param [in] one int diagonal elements
+ *  \param [in] zero int other elements
+ *  \return SquareMatrix identity, 1 on the diagonal and 0 elsewhere by default
+ */
+SquareMatrix SquareMatrix::identity(int n, int one, int zero)
+{
+    SquareMatrix result;
+    result.allocate(n);
+    size_t t_n = n;
+    std::fill(result.elements.get(), result.elements.get() + t_n * t_n, zero);
+    for(size_t i = 0; i < t_n; i++)
+    {
+        result.elements.get()[i * t_n + i] = one;
     }
+    return result;
+}
 
-    std::vector<std::thread> workers;
+/**
+ *  \brief Power m<SUP>k</SUP> by repeated squaring. Products are exact modulo 2<SUP>32</SUP> like operator*
+ *  \param [in] m const SquareMatrixView& base
+ *  \param [in] k uint64_t exponent, 0 gives identity
+ *  \return SquareMatrix m<SUP>k</SUP> after at most 2 log<SUB>2</SUB> k multiplications
+ */
+SquareMatrix pow(const SquareMatrixView& m, uint64_t k)
+{
+    return SquareMatrix::power<Semiring::PlusTimes>(m, k);
+}
 
-	size_t t_n = this->elements.size();
+/**
+ *  \brief Power m<SUP>k</SUP> modulo p by repeated squaring, for linear recurrences and Markov chains
+ *  \param [in] m const SquareMatrixView& base, elements are reduced into [0, p) first
+ *  \param [in] k uint64_t exponent, 0 gives identity modulo p
+ *  \param [in] p int modulus, positive
+ *  \return SquareMatrix m<SUP>k</SUP> mod p with elements in [0, p)
+ */
+SquareMatrix SquareMatrix::powMod(const SquareMatrixView& m, uint64_t k, int p)
+{
+    if(p <= 0)
+    {
+        throw std::invalid_argument("modulus must be positive");
+    }
 
-	float step = t_n / (float) threadsSupported;
+    SquareMatrix reduced;
+    reduced.allocate(m.getDimension());
+    size_t t_n = reduced.n;
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const int* source = m.row(i);
+            int* target = reduced.elements.get() + i * t_n;
+            for(size_t j = 0; j < t_n; j++)
+            {
+                target[j] = source[j] % p < 0 ? source[j] % p + p : source[j] % p;
+            }
+        }
+    });
 
-    for(size_t worker = 0; worker < threadsSupported; worker++)
+    return powerBy(reduced, k, 1 % p, 0, [p](SquareMatrix& c, const SquareMatrix& a, const SquareMatrix& b)
     {
-		size_t worker_start = round(worker * step);
-		size_t worker_stop = round(((worker+1) * step));
+        gemmMod(c, a, b, p);
+    });
+}
 
-        workers.push_back(std::thread([&, worker_start, worker_stop]()
+/**
+ *  \brief Computes c = a * b mod p into existing storage of c. When no sum of products can exceed INT_MAX the
+ *      packed kernel of operator* is used and reduced afterwards. Otherwise products are summed in 64 bits and
+ *      reduced once per depth block, or more often when p is so large that a block of sums could overflow
+ *  \param [in,out] c SquareMatrix& result, same dimension as a and b
+ *  \param [in] a const SquareMatrixView& left-hand side, elements in [0, p)
+ *  \param [in] b const SquareMatrixView& right-hand side, elements in [0, p)
+ *  \param [in] p int modulus, positive
+ */
+void SquareMatrix::gemmMod(SquareMatrix& c, const SquareMatrixView& a, const SquareMatrixView& b, int p)
+{
+    size_t t_n = c.n;
+    uint64_t largest = static_cast<uint64_t>(p) - 1;
+    uint64_t square = largest * largest;
+
+    if(t_n == 0 || square <= static_cast<uint64_t>(INT_MAX) / t_n)
+    {
+        gemm(c, a, b);
+        runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
         {
-            for(size_t in = worker_start; in < worker_stop; in++)
+            int* target = c.elements.get();
+            for(size_t i = worker_start * t_n; i < worker_stop * t_n; i++)
             {
-                for(size_t j = 0; j < t_n; j++)
+                target[i] %= p;
+            }
+        });
+        return;
+    }
+
+    c.detach();
+    Tuning::Profile tuning = Tuning::getProfile();
+    size_t depthBlock = std::max<size_t>(1, tuning.depthBlock);
+    size_t flush = static_cast<size_t>(std::min<uint64_t>(depthBlock, (UINT64_MAX - largest) / square));
+    const size_t columnBlock = 256;
+
+    runTiles(t_n, [&](size_t row_start, size_t row_stop, size_t column_start, size_t column_stop)
+    {
+        uint64_t sums[columnBlock];
+        for(size_t i = row_start; i < row_stop; i++)
+        {
+            std::fill(c.elements.get() + i * t_n + column_start, c.elements.get() + i * t_n + column_stop, 0);
+        }
+
+        // depthBlock rows of b times columnBlock columns stay in cache while every row of the tile reads them
+        for(size_t jc = column_start; jc < column_stop; jc += columnBlock)
+        {
+            size_t width = std::min(columnBlock, column_stop - jc);
+            for(size_t kc = 0; kc < t_n; kc += depthBlock)
+            {
+                size_t depths = std::min(depthBlock, t_n - kc);
+                for(size_t i = row_start; i < row_stop; i++)
                 {
-                    IntElement sum;
-                    for(size_t x = 0; x < t_n; x++)
+                    int* target = c.elements.get() + i * t_n + jc;
+                    const int* row = a.row(i);
+                    std::copy(target, target + width, sums);
+                    for(size_t k = kc; k < kc + depths; k++)
+                    {
+                        if(k != kc && (k - kc) % flush == 0)
+                        {
+                            for(size_t j = 0; j < width; j++)
+                            {
+                                sums[j] %= p;
+                            }
+                        }
+                        uint64_t value = static_cast<uint32_t>(row[k]);
+                        const int* other = b.row(k) + jc;
+                        for(size_t j = 0; j < width; j++)
+                        {
+                            sums[j] += value * static_cast<uint32_t>(other[j]);
+                        }
+                    }
+                    for(size_t j = 0; j < width; j++)
                     {
-                        sum += temp.elements.at(in).at(x) * i.elements.at(x).at(j);
+                        target[j] = static_cast<int>(sums[j] % p);
                     }
-                    this->elements.at(in).at(j) = sum;
                 }
             }
+        }
+    });
+}
+
+/**
+ *  \brief Fraction-free Gaussian elimination of Bareiss. Every element after step k is a (k+1)x(k+1) minor of this
+ *      matrix, so divisions by the previous pivot are exact. Products of two minors are formed in 128 bits and the
+ *      new minor must fit into 64 bits. Rows below a pivot are split between workers
+ *  \param [out] determinant int64_t* exact determinant, may be nullptr
+ *  \return int rank
+ */
+int SquareMatrix::bareiss(int64_t* determinant) const
+{
+    size_t t_n = this->n;
+    std::vector<int64_t> a(this->elements.get(), this->elements.get() + t_n * t_n);
+    int64_t previous = 1;
+    bool negative = false;
+    size_t rank = 0;
+
+    for(size_t c = 0; c < t_n && rank < t_n; c++)
+    {
+        size_t r = rank;
+        while(r < t_n && a[r * t_n + c] == 0)
+        {
+            r++;
+        }
+        if(r == t_n)
+        {
+            continue; // no pivot, this column depends on earlier ones
+        }
+        if(r != rank)
+        {
+            std::swap_ranges(a.begin() + r * t_n, a.begin() + (r + 1) * t_n, a.begin() + rank * t_n);
+            negative = !negative;
+        }
+
+        const int64_t* pivotRow = a.data() + rank * t_n;
+        __int128 pivot = pivotRow[c];
+        std::atomic<bool> overflow(false);
+        runParallel(t_n - rank - 1, t_n - c, [&](size_t worker_start, size_t worker_stop)
+        {
+            for(size_t i = rank + 1 + worker_start; i < rank + 1 + worker_stop; i++)
+            {
+                int64_t* target = a.data() + i * t_n;
+                __int128 factor = target[c];
+                for(size_t j = c + 1; j < t_n; j++)
+                {
+                    __int128 minor = (pivot * target[j] - factor * pivotRow[j]) / previous;
+                    if(minor > INT64_MAX || minor < -INT64_MAX)
+                    {
+                        overflow = true;
+                        return;
+                    }
+                    target[j] = static_cast<int64_t>(minor);
+                }
+                target[c] = 0;
+            }
+        });
+        if(overflow)
+        {
+            throw std::overflow_error("Minor does not fit into 64 bits");
+        }
+
+        previous = pivotRow[c];
+        rank++;
+    }
+
+    if(determinant != nullptr)
+    {
+        *determinant = rank < t_n ? 0 : (negative ? -previous : previous);
+    }
+    return static_cast<int>(rank);
+}
+
+/**
+ *  \brief Exact determinant by fraction-free elimination
+ *  \return int64_t determinant, throws std::overflow_error if a minor met on the way does not fit into 64 bits
+ */
+int64_t SquareMatrix::determinant() const
+{
+    int64_t result;
+    bareiss(&result);
+    return result;
+}
+
+/**
+ *  \brief Rank over the rationals. Exact by fraction-free elimination while its minors fit into 64 bits,
+ *      otherwise the largest rank modulo three primes near 2<SUP>31</SUP>, which is wrong only if all of them
+ *      divide every nonzero minor of the largest size
+ *  \return int number of linearly independent rows
+ */
+int SquareMatrix::rank() const
+{
+    try
+    {
+        return bareiss(nullptr);
+    }
+    catch(const std::overflow_error&)
+    {
+        int result = 0;
+        for(int p : {2147483647, 2147483629, 2147483587})
+        {
+            result = std::max(result, rankMod(p));
+            if(result == getDimension())
+            {
+                break;
+            }
+        }
+        return result;
+    }
+}
+
+/**
+ *  \brief Determinant modulo a prime, any size in O(n<SUP>3</SUP>) without growth of elements
+ *  \param [in] p int prime modulus below 2<SUP>31</SUP>
+ *  \return int determinant in [0, p)
+ */
+int SquareMatrix::determinantMod(int p) const
+{
+    return ModularElimination::determinant(*this, p);
+}
+
+/**
+ *  \brief Rank modulo a prime
+ *  \param [in] p int prime modulus below 2<SUP>31</SUP>
+ *  \return int number of linearly independent rows modulo p
+ */
+int SquareMatrix::rankMod(int p) const
+{
+    return ModularElimination::rank(*this, p);
+}
+
+/**
+ *  \brief Inverse modulo a prime, throws std::invalid_argument if the matrix is singular modulo p
+ *  \param [in] p int prime modulus below 2<SUP>31</SUP>
+ *  \return SquareMatrix inverse with elements in [0, p)
+ */
+SquareMatrix SquareMatrix::inverseMod(int p) const
+{
+    return ModularElimination::inverse(*this, p);
+}
+
+/**
+ *  \brief Sum of the diagonal
+ *  \return int64_t exact trace, 0 for an empty matrix
+ */
+int64_t SquareMatrix::trace() const
+{
+    int64_t result = 0;
+    size_t t_n = this->n;
+    for(size_t i = 0; i < t_n; i++)
+    {
+        result += this->elements.get()[i * t_n + i];
+    }
+    return result;
+}
+
+/**
+ *  \brief Sum of all elements, rows split between workers
+ *  \return int64_t exact sum, fits for n up to 65536
+ */
+int64_t SquareMatrix::sum() const
+{
+    std::atomic<int64_t> result(0);
+    size_t t_n = this->n;
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        int64_t partial = 0;
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            partial += ReductionKernel::sum(this->elements.get() + i * t_n, t_n);
+        }
+        result += partial;
+    });
+    return result;
+}
+
+/**
+ *  \brief Frobenius norm, square root of the sum of squares of all elements, rows split between workers
+ *  \return double norm, squares are summed in double precision
+ */
+double SquareMatrix::frobeniusNorm() const
+{
+    std::vector<double> squares(this->n);
+    size_t t_n = this->n;
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            squares[i] = ReductionKernel::sumOfSquares(this->elements.get() + i * t_n, t_n);
+        }
+    });
+    return sqrt(std::accumulate(squares.begin(), squares.end(), 0.0));
+}
+
+/**
+ *  \brief Largest absolute value of elements, rows split between workers
+ *  \return int64_t max |a<SUB>ij</SUB>|, 2<SUP>31</SUP> when INT_MIN is present and 0 for an empty matrix
+ */
+int64_t SquareMatrix::maxAbs() const
+{
+    std::atomic<int64_t> result(0);
+    size_t t_n = this->n;
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        int64_t partial = 0;
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            partial = std::max(partial, ReductionKernel::maxAbs(this->elements.get() + i * t_n, t_n));
+        }
+        int64_t current = result;
+        while(partial > current && !result.compare_exchange_weak(current, partial))
+        {
+        }
+    });
+    return result;
+}
+
+/**
+ *  \brief Sum of each row, rows split between workers
+ *  \return std::vector<int64_t> n exact sums, element i for row i
+ */
+std::vector<int64_t> SquareMatrix::rowSums() const
+{
+    std::vector<int64_t> result(this->n);
+    size_t t_n = this->n;
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            result[i] = ReductionKernel::sum(this->elements.get() + i * t_n, t_n);
+        }
+    });
+    return result;
+}
+
+/**
+ *  \brief Sum of each column. Each worker adds its rows into sums of its own, which are then added together
+ *  \return std::vector<int64_t> n exact sums, element j for column j
+ */
+std::vector<int64_t> SquareMatrix::columnSums() const
+{
+    std::vector<int64_t> result(this->n);
+    std::mutex lock;
+    size_t t_n = this->n;
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        std::vector<int64_t> partial(t_n);
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            ReductionKernel::addTo(partial.data(), this->elements.get() + i * t_n, t_n);
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        for(size_t j = 0; j < t_n; j++)
+        {
+            result[j] += partial[j];
+        }
+    });
+    return result;
+}
+
+/**
+ *  \brief Smallest element and its first position in row-major order
+ *  \return ElementPosition value, row and column
+ */
+SquareMatrix::ElementPosition SquareMatrix::minElement() const
+{
+    return extreme(false);
+}
+
+/**
+ *  \brief Largest element and its first position in row-major order
+ *  \return ElementPosition value, row and column
+ */
+SquareMatrix::ElementPosition SquareMatrix::maxElement() const
+{
+    return extreme(true);
+}
+
+/**
+ *  \brief Smallest or largest element. Workers take the extreme of each row with SIMD and search a row for the
+ *      position only when its extreme beats the earlier rows of the worker, then the first best of workers is taken
+ *  \param [in] largest bool true for the largest element, false for the smallest
+ *  \return ElementPosition value, row and column of its first occurrence in row-major order
+ */
+SquareMatrix::ElementPosition SquareMatrix::extreme(bool largest) const
+{
+    if(this->n == 0)
+    {
+        throw std::invalid_argument("operator requires nonempty matrix");
+    }
+
+    ElementPosition result;
+    bool found = false;
+    std::mutex lock;
+    size_t t_n = this->n;
+    runParallel(t_n, t_n, [&](size_t worker_start, size_t worker_stop)
+    {
+        ElementPosition partial;
+        partial.value = largest ? INT_MIN : INT_MAX;
+        partial.row = t_n;
+        for(size_t i = worker_start; i < worker_stop; i++)
+        {
+            const int* row = this->elements.get() + i * t_n;
+            int value = largest ? ReductionKernel::max(row, t_n) : ReductionKernel::min(row, t_n);
+            if(partial.row == t_n || (largest ? value > partial.value : value < partial.value))
+            {
+                partial.value = value;
+                partial.row = i;
+                partial.column = std::find(row, row + t_n, value) - row;
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        bool better = largest ? partial.value > result.value : partial.value < result.value;
+        if(!found || better || (partial.value == result.value && partial.row < result.row))
+        {
+            result = partial;
+            found = true;
+        }
+    });
+    return result;
+}
+
+/**
+ *  \brief Exchanges storage with m without copying, also when copy-on-write is disabled
+ *  \param [in,out] m SquareMatrix& matrix of same dimension
+ */
+void SquareMatrix::swapElements(SquareMatrix& m)
+{
+    std::swap(this->n, m.n);
+    std::swap(this->elements, m.elements);
+}
+
+/**
+ *  \brief Computes this = alpha * a * b + beta * this with all workers. Storage of this must not be shared
+ *  \param [in] alpha int scale of product
+ *  \param [in] a const SquareMatrixView& left-hand side
+ *  \param [in] b const SquareMatrixView& right-hand side
+ *  \param [in] beta int scale of original elements
+ */
+void SquareMatrix::gemm_parallel(int alpha, const SquareMatrixView& a, const SquareMatrixView& b, int beta)
+{
+    // columns of b are split between workers, but on NUMA machines each node still reads its own copy
+    std::vector<SquareMatrix> replicas = replicatePerNode(b);
+    Tuning::Profile tuning = Tuning::getProfile();
+
+    // narrower kernels give the same result when values allow, finding out costs one pass over the operands
+    GemmKernel::Path path = GemmKernel::choosePath(a, b, tuning);
+
+    runTiles(this->n, [&](size_t row_start, size_t row_stop, size_t column_start, size_t column_stop)
+    {
+        const SquareMatrixView& m = replicas.empty() ? b : replicas.at(NumaTopology::getCurrentNode());
+        multi_loop(row_start, row_stop, column_start, column_stop, alpha, a, m, beta, this->elements.get(), tuning, path);
+    });
+}
+
+/**
+ *  \brief Runs work in parallel over 2D tiles of an n x n result. There are about two tiles per worker so that
+ *      each worker reads a bounded part of both operands of a multiplication: the rows of the left-hand side and
+ *      the columns of the right-hand side of its tiles. Tiles are at most tuning columnBlock wide and start at
+ *      cache line boundaries. Workers get consecutive tiles in row-major order, so on NUMA machines the rows
+ *      of a node stay together
+ *  \param [in] n size_t dimension of result
+ *  \param [in] work const std::function<void(size_t, size_t, size_t, size_t)>& called with start and stop row
+ *      and start and stop column of a tile
+ */
+void SquareMatrix::runTiles(size_t n, const std::function<void(size_t, size_t, size_t, size_t)>& work)
+{
+    if(n == 0)
+    {
+        return;
+    }
+
+    const size_t lineElements = 64 / sizeof(int);
+    Tuning::Profile tuning = Tuning::getProfile();
+    size_t target = 2 * static_cast<size_t>(maxWorkers(ExecutionPolicy::current()));
+
+    size_t columnTiles = std::max<size_t>((n + tuning.columnBlock - 1) / tuning.columnBlock, std::lround(std::sqrt(target)));
+    size_t tileColumns = (n + columnTiles - 1) / columnTiles;
+    tileColumns = std::min(n, (tileColumns + lineElements - 1) / lineElements * lineElements);
+    columnTiles = (n + tileColumns - 1) / tileColumns;
+
+    size_t rowTiles = std::min(n, (target + columnTiles - 1) / columnTiles);
+    size_t tileRows = (n + rowTiles - 1) / rowTiles;
+    rowTiles = (n + tileRows - 1) / tileRows;
+
+    runParallel(rowTiles * columnTiles, tileRows * tileColumns * n, [&](size_t tile_start, size_t tile_stop)
+    {
+        for(size_t tile = tile_start; tile < tile_stop; tile++)
+        {
+            size_t row = tile / columnTiles * tileRows;
+            size_t column = tile % columnTiles * tileColumns;
+            work(row, std::min(row + tileRows, n), column, std::min(column + tileColumns, n));
+        }
+    });
+}
+
+/**
+ *  \brief Copies m to memory of every NUMA node. Each copy gets a buffer bound to its node by MatrixPool, which
+ *      reuses only buffers of the same node, and is written by a thread pinned to the node
+ *  \param [in] m const SquareMatrixView& matrix to replicate
+ *  \return std::vector<SquareMatrix> copy of node i at index i, empty on single node machines or for small matrices
+ */
+std::vector<SquareMatrix> SquareMatrix::replicatePerNode(const SquareMatrixView& m)
+{
+    const NumaTopology& topology = NumaTopology::instance();
+    std::vector<SquareMatrix> replicas;
+
+    if(topology.getNodeCount() < 2 || m.getDimension() < numaReplicaThreshold)
+    {
+        return replicas;
+    }
+
+    replicas.resize(topology.getNodeCount());
+    std::vector<int> cpus = ExecutionPolicy::workerCpus(ExecutionPolicy::current());
+    std::vector<std::thread> copiers;
+    for(size_t node = 0; node < topology.getNodeCount(); node++)
+    {
+        copiers.push_back(std::thread([&, node]()
+        {
+            topology.pinCurrentThread(node, cpus);
+            SquareMatrix& replica = replicas[node];
+            replica.n = m.getDimension();
+            replica.elements = MatrixPool::instance().allocate(static_cast<size_t>(replica.n) * replica.n, static_cast<int>(node));
+            for(int i = 0; i < replica.n; i++)
+            {
+                std::copy(m.row(i), m.row(i) + replica.n, replica.elements.get() + static_cast<size_t>(i) * replica.n);
+            }
         }));
     }
 
-    std::for_each(workers.begin(), workers.end(), [](std::thread &t)
+    std::for_each(copiers.begin(), copiers.end(), [](std::thread &t)
     {
         t.join();
     });
 
-	return *this;
+    return replicas;
+}
+
+/**
+ *  \brief Adds rows [start, stop) of m into this
+ *  \param [in] start size_t first row
+ *  \param [in] stop size_t one past last row
+ *  \param [in] m const SquareMatrixView& right-hand side
+ */
+void SquareMatrix::addition_loop(size_t start, size_t stop, const SquareMatrixView& m)
+{
+    for(size_t i = start; i < stop; i++)
+    {
+        int* target = this->elements.get() + i * n;
+        const int* source = m.row(i);
+        for(int j = 0; j < n; j++)
+        {
+            target[j] += source[j];
+        }
+    }
+}
+
+/**
+ *  \brief Substracts rows [start, stop) of m from this
+ *  \param [in] start size_t first row
+ *  \param [in] stop size_t one past last row
+ *  \param [in] m const SquareMatrixView& right-hand side
+ */
+void SquareMatrix::substraction_loop(size_t start, size_t stop, const SquareMatrixView& m)
+{
+    for(size_t i = start; i < stop; i++)
+    {
+        int* target = this->elements.get() + i * n;
+        const int* source = m.row(i);
+        for(int j = 0; j < n; j++)
+        {
+            target[j] -= source[j];
+        }
+    }
+}
+
+/**
+ *  \brief Computes tile rows [start, stop) x columns [column_start, column_stop) of alpha * lhs * m + beta * result
+ *      into result. The product is added by the packed GemmKernel after the tile is scaled by beta
+ *  \param [in] start size_t first row
+ *  \param [in] stop size_t one past last row
+ *  \param [in] column_start size_t first column
+ *  \param [in] column_stop size_t one past last column
+ *  \param [in] alpha int scale of product
+ *  \param [in] lhs const SquareMatrixView& left-hand side
+ *  \param [in] m const SquareMatrixView& right-hand side
+ *  \param [in] beta int scale of original result, with 0 original values are ignored
+ *  \param [in,out] result int* result elements, n*n in row-major order
+ *  \param [in] tuning const Tuning::Profile& block sizes
+ *  \param [in] path GemmKernel::Path kernel chosen by GemmKernel::choosePath for lhs and m
+ */
+void SquareMatrix::multi_loop(size_t start, size_t stop, size_t column_start, size_t column_stop, int alpha, const SquareMatrixView& lhs, const SquareMatrixView& m, int beta, int* result, const Tuning::Profile& tuning, GemmKernel::Path path)
+{
+    size_t t_n = m.getDimension();
+    for(size_t in = start; in < stop; in++)
+    {
+        int* target = result + in * t_n;
+        if(beta == 0)
+        {
+            std::fill(target + column_start, target + column_stop, 0);
+        }
+        else if(beta != 1)
+        {
+            for(size_t j = column_start; j < column_stop; j++)
+            {
+                target[j] *= beta;
+            }
+        }
+    }
+
+    GemmKernel::multiply(start, stop, column_start, column_stop, alpha, lhs, m, result, t_n, tuning, path);
 }
 
 /**
@@ -456,26 +1605,7 @@ SquareMatrix operator*(const SquareMatrix& a, const SquareMatrix& b)
  */
 std::ostream& operator<<(std::ostream& stream, const SquareMatrix& m)
 {
-	stream << "[";
-    for(auto element : m.elements)
-    {
-        stream << "[";
-        for(size_t ind = 0; ind < element.size(); ind++)
-        {
-            if(ind != element.size() - 1)
-            {
-                stream << element.at(ind) << ",";
-            }
-            else
-            {
-                stream << element.at(ind);
-            }
-        }
-        stream << "]";
-    }
-    stream << "]";
-
-    return stream;
+    return stream << SquareMatrixView(m);
 }
 
 /**
@@ -490,22 +1620,10 @@ bool SquareMatrix::operator==(const SquareMatrix& m) const
         return false;
     }
 
-    auto row_m = m.elements.begin();
-    for(auto row_this : this->elements)
+    if(this->elements == m.elements)
     {
-        auto elem_m = row_m->begin();
-        for(auto elem_this : row_this)
-        {
-            if(elem_this == *elem_m)
-            {
-            }
-            else
-            {
-                return false;
-            }
-            elem_m++;
-        }
-        row_m++;
+        return true;
     }
-    return true;
+
+    return std::equal(this->elements.get(), this->elements.get() + static_cast<size_t>(n) * n, m.elements.get());
 }
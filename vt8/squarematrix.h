@@ -1,8 +1,15 @@
 #ifndef SQUAREMATRIX_H
 #define SQUAREMATRIX_H
 
+#include "gemmkernel.h"
 #include "intelement.h"
+#include "matrixpool.h"
+#include "matrixtask.h"
+#include "semiringkernel.h"
+#include "squarematrixview.h"
+#include "tuning.h"
 
+#include <cstdint>
 #include <ctime>
 #include <sstream>
 #include <vector>
@@ -10,6 +17,12 @@
 #include <thread>
 #include <mutex>
 #include <math.h>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <type_traits>
 
 /**
  * @file squarematrix.h
@@ -19,33 +32,244 @@
  */
 class SquareMatrix
 {
+public:
+    struct ElementPosition
+    {
+        int value = 0;     ///< element
+        size_t row = 0;    ///< row of its first occurrence in row-major order
+        size_t column = 0; ///< column of its first occurrence in row-major order
+    };
+
 private:
-	int n;
-	std::vector<std::vector<IntElement>> elements;
+	int n = 0;
+	std::shared_ptr<int> elements; // n*n elements in row-major order, allocated from MatrixPool
+	static std::atomic<bool> copyOnWrite;
+	static std::atomic<int> productCheck;
+	void allocate(int n);
+	void detach();
 	void fromString(const std::string& s);
-    void multi_loop(int start, int stop, const SquareMatrix& m);
-    void addition_loop(int start, int stop, const SquareMatrix& m);
-    void substraction_loop(int start, int stop, const SquareMatrix& m);
+	static void runParallel(size_t rows, size_t rowCost, const std::function<void(size_t, size_t)>& work);
+	static SquareMatrix multiply(const SquareMatrixView& a, const SquareMatrixView& b);
+	void gemm_parallel(int alpha, const SquareMatrixView& a, const SquareMatrixView& b, int beta);
+	static void runTiles(size_t n, const std::function<void(size_t, size_t, size_t, size_t)>& work);
+    static void multi_loop(size_t start, size_t stop, size_t column_start, size_t column_stop, int alpha, const SquareMatrixView& lhs, const SquareMatrixView& m, int beta, int* result, const Tuning::Profile& tuning, GemmKernel::Path path);
+    static void gemmMod(SquareMatrix& c, const SquareMatrixView& a, const SquareMatrixView& b, int p);
+	template<class S>
+	static void semiringGemm(SquareMatrix& c, const SquareMatrixView& a, const SquareMatrixView& b);
+	template<class Multiply>
+	static SquareMatrix powerBy(const SquareMatrixView& m, uint64_t k, int one, int zero, const Multiply& multiply);
+	void swapElements(SquareMatrix& m);
+	int bareiss(int64_t* determinant) const;
+	ElementPosition extreme(bool largest) const;
+    void addition_loop(size_t start, size_t stop, const SquareMatrixView& m);
+    void substraction_loop(size_t start, size_t stop, const SquareMatrixView& m);
+
+	friend class SquareMatrixView;
+	friend class PackedMatrix;
+	friend class CompressedMatrix;
+	friend class DiskMatrix;
+	friend class MatrixExpression;
+	friend class BitMatrix;
+	friend class ModularElimination;
+	friend class IntVector;
 
 public:
+    struct ParallelStats
+    {
+        size_t serialRuns = 0;       ///< operations run on calling thread
+        size_t partialRuns = 0;      ///< operations run with fewer than maxThreads workers
+        size_t fullRuns = 0;         ///< operations run with maxThreads workers
+        size_t threadsStarted = 0;   ///< worker threads started
+        size_t grain = 0;            ///< element operations a worker must get before another worker is added
+        unsigned int maxThreads = 0; ///< workers an operation may use
+    };
+
 	SquareMatrix();
 	SquareMatrix(const std::string& s);
 	SquareMatrix(const SquareMatrix& m);
 	SquareMatrix(int n);
+	explicit SquareMatrix(const SquareMatrixView& v);
 	~SquareMatrix();
 
 	void print(std::ostream& os) const;
 	std::string toString() const;
 	SquareMatrix transpose() const;
+	int getDimension() const;
+	IntElement getElement(size_t row, size_t col) const;
+	void setElement(size_t row, size_t col, const IntElement& value);
+	SquareMatrixView block(size_t row, size_t col, size_t size) const;
+	void setBlock(size_t row, size_t col, const SquareMatrixView& block);
+	bool isSharedWith(const SquareMatrix& m) const;
+	MatrixPool::Backing getBacking() const;
+	static std::vector<SquareMatrix> replicatePerNode(const SquareMatrixView& m);
+	static void gemm(SquareMatrix& c, const SquareMatrixView& a, const SquareMatrixView& b, int alpha = 1, int beta = 0);
+	static void axpy(SquareMatrix& y, int alpha, const SquareMatrixView& x);
+	static bool verifyProduct(const SquareMatrixView& a, const SquareMatrixView& b, const SquareMatrixView& c, int rounds = 8);
+	template<class S>
+	static SquareMatrix product(const SquareMatrixView& a, const SquareMatrixView& b);
+	static SquareMatrix identity(int n, int one = 1, int zero = 0);
+	static SquareMatrix powMod(const SquareMatrixView& m, uint64_t k, int p);
+	int64_t determinant() const;
+	int rank() const;
+	int determinantMod(int p) const;
+	int rankMod(int p) const;
+	SquareMatrix inverseMod(int p) const;
+	int64_t trace() const;
+	int64_t sum() const;
+	double frobeniusNorm() const;
+	int64_t maxAbs() const;
+	std::vector<int64_t> rowSums() const;
+	std::vector<int64_t> columnSums() const;
+	ElementPosition minElement() const;
+	ElementPosition maxElement() const;
+	template<class S>
+	static SquareMatrix power(const SquareMatrixView& m, uint64_t k);
+	static void scale(SquareMatrix& y, int alpha);
+	static MatrixTask parseAsync(const std::string& s);
+	static MatrixTask addAsync(const MatrixTask& a, const MatrixTask& b);
+	static MatrixTask multiplyAsync(const MatrixTask& a, const MatrixTask& b);
+	static MatrixTask transposeAsync(const MatrixTask& m);
+	static std::future<std::string> toStringAsync(const MatrixTask& m);
+	static ParallelStats getParallelStats();
+	static void resetParallelStats();
+	static void setCopyOnWrite(bool enabled);
+	static bool isCopyOnWrite();
+	static void setProductCheck(int rounds);
+	static int getProductCheck();
 
 	bool operator==(const SquareMatrix& m) const;
 	SquareMatrix& operator=(const SquareMatrix& m);
 	SquareMatrix& operator+=(const SquareMatrix& m);
 	SquareMatrix& operator-=(const SquareMatrix& m);
 	SquareMatrix& operator*=(const SquareMatrix& m);
+	SquareMatrix& operator+=(const SquareMatrixView& v);
+	SquareMatrix& operator-=(const SquareMatrixView& v);
+	SquareMatrix& operator*=(const SquareMatrixView& v);
 	friend SquareMatrix operator+(const SquareMatrix& a, const SquareMatrix& b);
 	friend SquareMatrix operator-(const SquareMatrix& a, const SquareMatrix& b);
 	friend SquareMatrix operator*(const SquareMatrix& a, const SquareMatrix& b);
+	friend SquareMatrix operator*(const SquareMatrixView& a, const SquareMatrixView& b);
+	friend SquareMatrix pow(const SquareMatrixView& m, uint64_t k);
 	friend std::ostream& operator<<(std::ostream& stream, const SquareMatrix& m);
 };
+
+SquareMatrix pow(const SquareMatrixView& m, uint64_t k);
+
+/**
+ *  \brief Multiplication over semiring S, element ij is the S-sum over k of S-products a<SUB>ik</SUB> b<SUB>kj</SUB>.
+ *      Uses the same output tiles and worker threads as operator*, plain sums of products are operator* itself
+ *  \param [in] a const SquareMatrixView& left-hand side
+ *  \param [in] b const SquareMatrixView& right-hand side
+ *  \return SquareMatrix product of a and b over S, e.g. Semiring::MinPlus for shortest paths of two steps
+ */
+template<class S>
+SquareMatrix SquareMatrix::product(const SquareMatrixView& a, const SquareMatrixView& b)
+{
+    if(a.getDimension() != b.getDimension())
+    {
+        throw std::invalid_argument("operator requires same sized matrices");
+    }
+
+    SquareMatrix result;
+    result.allocate(a.getDimension());
+    semiringGemm<S>(result, a, b);
+    return result;
+}
+
+/**
+ *  \brief Computes c = a * b over semiring S into existing storage of c
+ *  \param [in,out] c SquareMatrix& result, same dimension as a and b
+ *  \param [in] a const SquareMatrixView& left-hand side
+ *  \param [in] b const SquareMatrixView& right-hand side
+ */
+template<class S>
+void SquareMatrix::semiringGemm(SquareMatrix& c, const SquareMatrixView& a, const SquareMatrixView& b)
+{
+    if constexpr(std::is_same<S, Semiring::PlusTimes>::value)
+    {
+        gemm(c, a, b);
+        return;
+    }
+
+    c.detach();
+    size_t t_n = c.n;
+    int* elements = c.elements.get();
+    bool packed = SemiringKernel<S>::packable(a) && SemiringKernel<S>::packable(b);
+    Tuning::Profile tuning = Tuning::getProfile();
+
+    runTiles(t_n, [&](size_t row_start, size_t row_stop, size_t column_start, size_t column_stop)
+    {
+        for(size_t i = row_start; i < row_stop; i++)
+        {
+            std::fill(elements + i * t_n + column_start, elements + i * t_n + column_stop, S::zero());
+        }
+        SemiringKernel<S>::multiply(row_start, row_stop, column_start, column_stop, a, b, elements, t_n, tuning, packed);
+    });
+}
+
+/**
+ *  \brief Power m<SUP>k</SUP> over semiring S by repeated squaring, at most 2 log<SUB>2</SUB> k products
+ *  \param [in] m const SquareMatrixView& base
+ *  \param [in] k uint64_t exponent, 0 gives identity with S::one() on the diagonal and S::zero() elsewhere
+ *  \return SquareMatrix m<SUP>k</SUP> over S, e.g. Semiring::MinPlus gives shortest paths of at most k steps
+ *      when m has zeros on its diagonal
+ */
+template<class S>
+SquareMatrix SquareMatrix::power(const SquareMatrixView& m, uint64_t k)
+{
+    return powerBy(m, k, S::one(), S::zero(), [](SquareMatrix& c, const SquareMatrix& a, const SquareMatrix& b)
+    {
+        semiringGemm<S>(c, a, b);
+    });
+}
+
+/**
+ *  \brief Exponentiation by squaring. Squares of m and the running product live in three buffers allocated once,
+ *      every product is written into the spare buffer which then trades places with its target
+ *  \param [in] m const SquareMatrixView& base
+ *  \param [in] k uint64_t exponent
+ *  \param [in] one int diagonal of identity returned for k = 0
+ *  \param [in] zero int other elements of identity
+ *  \param [in] multiply const Multiply& called as multiply(c, a, b) to store a * b into c, c is never a or b
+ *  \return SquareMatrix m<SUP>k</SUP>
+ */
+template<class Multiply>
+SquareMatrix SquareMatrix::powerBy(const SquareMatrixView& m, uint64_t k, int one, int zero, const Multiply& multiply)
+{
+    if(k == 0)
+    {
+        return identity(m.getDimension(), one, zero);
+    }
+
+    // base runs through m, m^2, m^4... and result collects the squares of the set bits of k
+    SquareMatrix base(m), result, spare;
+    result.allocate(base.n);
+    spare.allocate(base.n);
+    bool started = false;
+    while(true)
+    {
+        if(k & 1)
+        {
+            if(started)
+            {
+                multiply(spare, result, base);
+                result.swapElements(spare);
+            }
+            else
+            {
+                std::copy(base.elements.get(), base.elements.get() + static_cast<size_t>(base.n) * base.n, result.elements.get());
+                started = true;
+            }
+        }
+        k >>= 1;
+        if(k == 0)
+        {
+            break;
+        }
+        multiply(spare, base, base);
+        base.swapElements(spare);
+    }
+
+    return result;
+}
 #endif
@@ -2,6 +2,10 @@
 #include "catch.hpp"
 #include "squarematrix.h"
 #include "intelement.h"
+#include "tuning.h"
+#include "executionpolicy.h"
+#include "numatopology.h"
+#include <climits>
 #include <iostream>
 
 /**
@@ -212,3 +216,468 @@ TEST_CASE("SquareMatrix N constructor", "[SquareMatrixNcon]")
 
     REQUIRE(conPow2 == result);
 }
+
+ /**
+ *  \brief Matrix unit tests for SquareMatrix, focuses into copy-on-write storage - will run in main generated by catch.hpp
+ *  \return 0 if tests passes
+ */
+TEST_CASE("SquareMatrix copy-on-write", "[SquareMatrixCow]")
+{
+    SquareMatrix a("[[1,2][3,4]]"), original("[[1,2][3,4]]");
+    SquareMatrix b(a), c, d;
+    c = a;
+
+    REQUIRE(SquareMatrix::isCopyOnWrite());
+    REQUIRE(b.isSharedWith(a));
+    REQUIRE(c.isSharedWith(a));
+
+    b += a;
+    REQUIRE_FALSE(b.isSharedWith(a));
+    REQUIRE(c.isSharedWith(a));
+    REQUIRE(a == original);
+    REQUIRE(b == SquareMatrix("[[2,4][6,8]]"));
+
+    c.setElement(1, 0, IntElement(7));
+    REQUIRE_FALSE(c.isSharedWith(a));
+    REQUIRE(c.getElement(1, 0) == IntElement(7));
+    REQUIRE(a.getElement(1, 0) == IntElement(3));
+    REQUIRE_THROWS_AS(c.setElement(2, 0, IntElement(1)), std::out_of_range);
+
+    d = a;
+    d *= d;
+    REQUIRE(d == SquareMatrix("[[7,10][15,22]]"));
+    REQUIRE(a == original);
+
+    SquareMatrix::setCopyOnWrite(false);
+    SquareMatrix e(a);
+    SquareMatrix::setCopyOnWrite(true);
+    REQUIRE_FALSE(e.isSharedWith(a));
+    REQUIRE(e == a);
+}
+
+ /**
+ *  \brief Matrix unit tests for SquareMatrix, focuses into in-place gemm, axpy and scale - will run in main generated by catch.hpp
+ *  \return 0 if tests passes
+ */
+TEST_CASE("SquareMatrix gemm", "[SquareMatrixGemm]")
+{
+    SquareMatrix a("[[1,2][3,4]]"), b("[[2,3][4,5]]");
+    SquareMatrix c("[[1,1][1,1]]");
+    SquareMatrix expected_gemm("[[23,29][47,61]]"), expected_product(a * b);
+    SquareMatrix expected_axpy("[[8,9][16,21]]"), expected_scale("[[24,27][48,63]]");
+
+    MatrixPool::instance().resetStats();
+    SquareMatrix::gemm(c, a, b, 2, 3);
+    bool gemm_ok = c == expected_gemm;
+    SquareMatrix::gemm(c, a, b);
+    bool product_ok = c == expected_product;
+    SquareMatrix::axpy(c, -2, a);
+    bool axpy_ok = c == expected_axpy;
+    SquareMatrix::scale(c, 3);
+    bool scale_ok = c == expected_scale;
+    MatrixPool::Stats stats = MatrixPool::instance().getStats();
+
+    REQUIRE(gemm_ok);
+    REQUIRE(product_ok);
+    REQUIRE(axpy_ok);
+    REQUIRE(scale_ok);
+    REQUIRE(stats.hits + stats.misses == 0);
+
+    // operands may share storage with result
+    SquareMatrix d(a);
+    SquareMatrix::gemm(d, d, d.block(0, 0, 2), 1, 1);
+    REQUIRE(d == a * a + a);
+    REQUIRE(a == SquareMatrix("[[1,2][3,4]]"));
+
+    REQUIRE_THROWS_WITH(SquareMatrix::gemm(c, a, SquareMatrix("[[1]]")), "operator requires same sized matrices");
+    REQUIRE_THROWS_WITH(SquareMatrix::axpy(c, 1, SquareMatrix("[[1]]")), "operator requires same sized matrices");
+}
+
+ /**
+ *  \brief Matrix unit tests for SquareMatrix, focuses into parallel cutoff of small operations - will run in main generated by catch.hpp
+ *  \return 0 if tests passes
+ */
+TEST_CASE("SquareMatrix parallel cutoff", "[SquareMatrixParallel]")
+{
+    Tuning::Profile original = Tuning::getProfile();
+    Tuning::Profile profile = original;
+    profile.parallelGrain = 4096;
+    Tuning::setProfile(profile);
+    ExecutionPolicy::Policy policy;
+    policy.threads = 4;
+    ExecutionPolicy::Scope scope(policy);
+
+    SquareMatrix a(8), b(8), c(96);
+    SquareMatrix::resetParallelStats();
+    SquareMatrix sum = a + b;
+    SquareMatrix product = a * b;
+    SquareMatrix::ParallelStats small = SquareMatrix::getParallelStats();
+
+    SquareMatrix expected_sum(a), expected_product(a);
+    for(int i = 0; i < 8; i++)
+    {
+        for(int j = 0; j < 8; j++)
+        {
+            expected_sum.setElement(i, j, a.getElement(i, j) + b.getElement(i, j));
+            IntElement value(0);
+            for(int k = 0; k < 8; k++)
+            {
+                value += a.getElement(i, k) * b.getElement(k, j);
+            }
+            expected_product.setElement(i, j, value);
+        }
+    }
+
+    SquareMatrix::resetParallelStats();
+    c += c;                                 // 9216 operations, two workers
+    SquareMatrix large = c * c;             // one worker per allowed thread
+    SquareMatrix::ParallelStats big = SquareMatrix::getParallelStats();
+    Tuning::setProfile(original);
+
+    REQUIRE(sum == expected_sum);
+    REQUIRE(product == expected_product);
+    REQUIRE(small.serialRuns == 2);
+    REQUIRE(small.threadsStarted == 0);
+    REQUIRE(big.partialRuns == 1);
+    REQUIRE(big.fullRuns == 1);
+    REQUIRE(big.threadsStarted == 6);
+    REQUIRE(big.grain == 4096);
+    REQUIRE(big.maxThreads == 4);
+}
+
+/**
+*  \brief Unit tests for NUMA replicas of SquareMatrix, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("SquareMatrix NUMA replicas", "[SquareMatrixNuma]")
+{
+    const NumaTopology& topology = NumaTopology::instance();
+    SquareMatrix m(300);
+    for(int round = 0; round < 2; round++) // second round gets buffers cached by the first
+    {
+        std::vector<SquareMatrix> replicas = SquareMatrix::replicatePerNode(m);
+        if(topology.getNodeCount() < 2)
+        {
+            REQUIRE(replicas.empty());
+            continue;
+        }
+        REQUIRE(replicas.size() == topology.getNodeCount());
+        for(size_t node = 0; node < replicas.size(); node++)
+        {
+            REQUIRE(replicas[node] == m);
+            const int* elements = SquareMatrixView(replicas[node]).row(0);
+            for(size_t offset = 0; offset < 300 * 300; offset += 1024)
+            {
+                int placed = topology.nodeOfAddress(elements + offset);
+                REQUIRE((placed == -1 || placed == static_cast<int>(node)));
+            }
+        }
+    }
+}
+
+ /**
+ *  \brief Matrix unit tests for SquareMatrix, focuses into multiplication split into 2D tiles - will run in main generated by catch.hpp
+ *  \return 0 if tests passes
+ */
+TEST_CASE("SquareMatrix tiled multiplication", "[SquareMatrixTiles]")
+{
+    Tuning::Profile original = Tuning::getProfile();
+    Tuning::Profile profile = original;
+    profile.parallelGrain = 1;
+    profile.columnBlock = 24;
+    profile.depthBlock = 7;
+    Tuning::setProfile(profile);
+    ExecutionPolicy::Policy policy;
+    policy.threads = 5;
+    ExecutionPolicy::Scope scope(policy);
+
+    for(int n : {1, 3, 37, 100})
+    {
+        SquareMatrix a(n), b(n), c(n);
+        SquareMatrix expected(c);
+        for(int i = 0; i < n; i++)
+        {
+            for(int j = 0; j < n; j++)
+            {
+                IntElement value(0);
+                for(int k = 0; k < n; k++)
+                {
+                    value += a.getElement(i, k) * b.getElement(k, j);
+                }
+                expected.setElement(i, j, value * IntElement(2) + c.getElement(i, j) * IntElement(3));
+            }
+        }
+
+        SquareMatrix::resetParallelStats();
+        SquareMatrix::gemm(c, a, b, 2, 3);
+        REQUIRE(c == expected);
+        REQUIRE(SquareMatrix::getParallelStats().threadsStarted == (n == 1 ? 0u : static_cast<size_t>(std::min(n, 5))));
+    }
+    Tuning::setProfile(original);
+}
+
+/**
+*  \brief Unit tests for SquareMatrix powers, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("SquareMatrix power", "[SquareMatrixPower]")
+{
+    SquareMatrix fibonacci("[[1,1][1,0]]");
+    REQUIRE(pow(fibonacci, 10) == SquareMatrix("[[89,55][55,34]]"));
+    REQUIRE(pow(fibonacci, 1) == fibonacci);
+    REQUIRE(pow(fibonacci, 0) == SquareMatrix::identity(2));
+
+    SquareMatrix a(37);
+    SquareMatrix expected(a);
+    for(int i = 1; i < 13; i++)
+    {
+        expected *= a;
+    }
+    REQUIRE(pow(a, 13) == expected);
+    REQUIRE(pow(a.block(1, 1, 20), 4) == SquareMatrix(a.block(1, 1, 20)) * a.block(1, 1, 20) * a.block(1, 1, 20) * a.block(1, 1, 20));
+
+    // buffers are allocated once, not per squaring
+    MatrixPool::Stats before = MatrixPool::instance().getStats();
+    pow(a, 3);
+    MatrixPool::Stats middle = MatrixPool::instance().getStats();
+    pow(a, 1000000);
+    MatrixPool::Stats after = MatrixPool::instance().getStats();
+    REQUIRE(after.hits + after.misses - middle.hits - middle.misses == middle.hits + middle.misses - before.hits - before.misses);
+
+    // linear recurrence against stepping it, with the packed kernel and with 64-bit sums
+    for(int p : {1000, 1000000007})
+    {
+        int64_t previous = 0, current = 1;
+        for(int i = 0; i < 100000; i++)
+        {
+            int64_t next = (previous + current) % p;
+            previous = current;
+            current = next;
+        }
+        SquareMatrix result = SquareMatrix::powMod(fibonacci, 100000, p);
+        REQUIRE(result.getElement(0, 1).getVal() == previous);
+        REQUIRE(result.getElement(0, 0).getVal() == current);
+    }
+    REQUIRE(SquareMatrix::powMod(SquareMatrix("[[-1,0][0,3]]"), 3, 5) == SquareMatrix("[[4,0][0,2]]"));
+    REQUIRE(SquareMatrix::powMod(fibonacci, 0, 1) == SquareMatrix("[[0,0][0,0]]"));
+    REQUIRE_THROWS_WITH(SquareMatrix::powMod(fibonacci, 2, 0), "modulus must be positive");
+
+    Tuning::Profile original = Tuning::getProfile();
+    Tuning::Profile small = original;
+    small.depthBlock = 7;
+    Tuning::setProfile(small);
+    for(int p : {97, 65521, 2147483647})
+    {
+        SquareMatrix b(40);
+        SquareMatrix cube = SquareMatrix::powMod(b, 3, p);
+        std::vector<int64_t> reduced(40 * 40), square(40 * 40, 0);
+        for(int i = 0; i < 40 * 40; i++)
+        {
+            reduced[i] = (b.getElement(i / 40, i % 40).getVal() % static_cast<int64_t>(p) + p) % p;
+        }
+        for(int i = 0; i < 40; i++)
+        {
+            for(int j = 0; j < 40; j++)
+            {
+                for(int k = 0; k < 40; k++)
+                {
+                    square[i * 40 + j] = (square[i * 40 + j] + reduced[i * 40 + k] * reduced[k * 40 + j]) % p;
+                }
+            }
+        }
+        for(int i = 0; i < 40; i++)
+        {
+            for(int j = 0; j < 40; j++)
+            {
+                int64_t sum = 0;
+                for(int k = 0; k < 40; k++)
+                {
+                    sum = (sum + square[i * 40 + k] * reduced[k * 40 + j]) % p;
+                }
+                REQUIRE(cube.getElement(i, j).getVal() == sum);
+            }
+        }
+    }
+    Tuning::setProfile(original);
+
+    // shortest paths of a chain 0->1->...->4 need four steps
+    const int inf = Semiring::MinPlus::infinity;
+    SquareMatrix chain = SquareMatrix::identity(5, 0, inf);
+    for(size_t i = 0; i + 1 < 5; i++)
+    {
+        chain.setElement(i, i + 1, IntElement(static_cast<int>(i) + 1));
+    }
+    SquareMatrix distances = SquareMatrix::power<Semiring::MinPlus>(chain, 4);
+    REQUIRE(distances.getElement(0, 4) == IntElement(10));
+    REQUIRE(distances.getElement(4, 0) == IntElement(inf));
+    REQUIRE(SquareMatrix::power<Semiring::MinPlus>(chain, 3).getElement(0, 4) == IntElement(inf));
+    REQUIRE(SquareMatrix::power<Semiring::MinPlus>(chain, 1000) == distances);
+    REQUIRE(SquareMatrix::power<Semiring::OrAnd>(chain, 0) == SquareMatrix::identity(5));
+}
+
+/**
+*  \brief Unit tests for SquareMatrix determinant and rank, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("SquareMatrix determinant", "[SquareMatrixDeterminant]")
+{
+    REQUIRE(SquareMatrix("[[1,2,3][4,5,6][7,8,10]]").determinant() == -3);
+    REQUIRE(SquareMatrix("[[0,1][1,0]]").determinant() == -1);
+    REQUIRE(SquareMatrix("[[1,2,3][4,5,6][7,8,9]]").determinant() == 0);
+    REQUIRE(SquareMatrix("[[1,2,3][4,5,6][7,8,9]]").rank() == 2);
+    REQUIRE(SquareMatrix("[[0,0,1][0,0,2][0,0,3]]").rank() == 1);
+    REQUIRE(SquareMatrix("[[0,0][0,0]]").rank() == 0);
+    REQUIRE(SquareMatrix().determinant() == 1);
+    REQUIRE(SquareMatrix::identity(50, 2).determinant() == int64_t(1) << 50);
+
+    // Hilbert-like integer matrix with a known determinant: Vandermonde of 1..8
+    SquareMatrix vandermonde(8);
+    int64_t expected = 1;
+    for(int i = 0; i < 8; i++)
+    {
+        int power = 1;
+        for(int j = 0; j < 8; j++)
+        {
+            vandermonde.setElement(i, j, IntElement(power));
+            power *= i + 1;
+        }
+        for(int k = 0; k < i; k++)
+        {
+            expected *= i - k;
+        }
+    }
+    REQUIRE(vandermonde.determinant() == expected);
+    REQUIRE(vandermonde.determinantMod(1000003) == expected % 1000003);
+
+    // random matrices grow past 64 bits, rank falls back to primes
+    SquareMatrix big(60);
+    for(size_t i = 0; i < 60; i++)
+    {
+        for(size_t j = 0; j < 60; j++)
+        {
+            big.setElement(i, j, IntElement(big.getElement(i, j).getVal() % 1000));
+        }
+    }
+    REQUIRE_THROWS_AS(big.determinant(), std::overflow_error);
+    REQUIRE(big.rank() == 60);
+    SquareMatrix dependent(big);
+    for(size_t j = 0; j < 60; j++)
+    {
+        dependent.setElement(59, j, big.getElement(0, j) + big.getElement(1, j));
+    }
+    REQUIRE(dependent.rank() == 59);
+}
+
+/**
+*  \brief Unit tests for SquareMatrix product verification, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("SquareMatrix verifyProduct", "[SquareMatrixVerify]")
+{
+    for(int n : {1, 7, 100, 301})
+    {
+        SquareMatrix a(n), b(n);
+        SquareMatrix c = a * b;
+        REQUIRE(SquareMatrix::verifyProduct(a, b, c));
+        REQUIRE(SquareMatrix::verifyProduct(a, b, c, 1));
+
+        // one element off by one, and one off by 2^31 which survives half of the rounds
+        SquareMatrix wrong(c);
+        wrong.setElement(n / 2, n - 1, IntElement(c.getElement(n / 2, n - 1).getVal() ^ 1));
+        REQUIRE_FALSE(SquareMatrix::verifyProduct(a, b, wrong));
+        wrong = c;
+        wrong.setElement(0, 0, IntElement(c.getElement(0, 0).getVal() ^ INT_MIN));
+        REQUIRE_FALSE(SquareMatrix::verifyProduct(a, b, wrong, 64));
+        REQUIRE(SquareMatrix::verifyProduct(b, a, c, 64) == (b * a == c));
+    }
+    REQUIRE(SquareMatrix::verifyProduct(SquareMatrix(), SquareMatrix(), SquareMatrix()));
+    REQUIRE_THROWS_WITH(SquareMatrix::verifyProduct(SquareMatrix(2), SquareMatrix(2), SquareMatrix(3)), "operator requires same sized matrices");
+    REQUIRE_THROWS_AS(SquareMatrix::verifyProduct(SquareMatrix(2), SquareMatrix(2), SquareMatrix(2), 0), std::invalid_argument);
+
+    // post-check of operator*= keeps the product when it is verified
+    REQUIRE(SquareMatrix::getProductCheck() == 0);
+    SquareMatrix::setProductCheck(16);
+    SquareMatrix m(200), n(200);
+    SquareMatrix expected = m * n;
+    m *= n;
+    SquareMatrix::setProductCheck(0);
+    REQUIRE(m == expected);
+    REQUIRE(SquareMatrix::getProductCheck() == 0);
+}
+
+/**
+*  \brief Unit tests for SquareMatrix reductions, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("SquareMatrix reductions", "[SquareMatrixReductions]")
+{
+    SquareMatrix a("[[1,-2,3][4,5,-6][7,8,-9]]");
+    REQUIRE(a.trace() == -3);
+    REQUIRE(a.sum() == 11);
+    REQUIRE(a.frobeniusNorm() == Approx(std::sqrt(285.0)));
+    REQUIRE(a.maxAbs() == 9);
+    REQUIRE(a.rowSums() == std::vector<int64_t>({2, 3, 6}));
+    REQUIRE(a.columnSums() == std::vector<int64_t>({12, 11, -12}));
+    REQUIRE(a.minElement().value == -9);
+    REQUIRE(a.minElement().row == 2);
+    REQUIRE(a.minElement().column == 2);
+    REQUIRE(a.maxElement().value == 8);
+    REQUIRE(a.maxElement().row == 2);
+    REQUIRE(a.maxElement().column == 1);
+
+    // ties go to the first position in row-major order, sums do not wrap
+    SquareMatrix b("[[2147483647,0][-2147483648,2147483647]]");
+    REQUIRE(b.sum() == 2147483646);
+    REQUIRE(b.trace() == 4294967294);
+    REQUIRE(b.maxAbs() == 2147483648);
+    REQUIRE(b.maxElement().row == 0);
+    REQUIRE(b.maxElement().column == 0);
+    REQUIRE(b.minElement().row == 1);
+
+    SquareMatrix empty;
+    REQUIRE(empty.sum() == 0);
+    REQUIRE(empty.trace() == 0);
+    REQUIRE(empty.frobeniusNorm() == 0);
+    REQUIRE(empty.rowSums().empty());
+    REQUIRE_THROWS_AS(empty.maxElement(), std::invalid_argument);
+
+    // large random matrix against element by element reference
+    SquareMatrix m(777);
+    m.setElement(500, 3, IntElement(INT_MIN));
+    m.setElement(700, 776, IntElement(INT_MIN));
+    int64_t sum = 0, trace = 0;
+    double squares = 0;
+    std::vector<int64_t> rows(777), columns(777);
+    SquareMatrix::ElementPosition high;
+    high.value = INT_MIN;
+    for(size_t i = 0; i < 777; i++)
+    {
+        for(size_t j = 0; j < 777; j++)
+        {
+            int value = m.getElement(i, j).getVal();
+            sum += value;
+            trace += i == j ? value : 0;
+            squares += static_cast<double>(value) * value;
+            rows[i] += value;
+            columns[j] += value;
+            if(value > high.value)
+            {
+                high.value = value;
+                high.row = i;
+                high.column = j;
+            }
+        }
+    }
+    REQUIRE(m.sum() == sum);
+    REQUIRE(m.trace() == trace);
+    REQUIRE(m.frobeniusNorm() == Approx(std::sqrt(squares)));
+    REQUIRE(m.rowSums() == rows);
+    REQUIRE(m.columnSums() == columns);
+    REQUIRE(m.maxAbs() == 2147483648);
+    REQUIRE(m.minElement().value == INT_MIN);
+    REQUIRE(m.minElement().row == 500);
+    REQUIRE(m.minElement().column == 3);
+    REQUIRE(m.maxElement().value == high.value);
+    REQUIRE(m.maxElement().row == high.row);
+    REQUIRE(m.maxElement().column == high.column);
+}
@@ -0,0 +1,259 @@
+#include "squarematrixview.h"
+#include "squarematrix.h"
+
+/**
+ *  @file squarematrixview.cpp
+ *  @brief Implementation of SquareMatrixView
+ *  */
+
+ /**
+ *  @class SquareMatrixView
+ *  @version 1.0
+ *  @brief Read-only nxn block of a SquareMatrix, addressed by first element, size and row stride.
+ *      The view shares the storage of the matrix, so a matrix modified after taking the view gets its own
+ *      copy of the elements by copy-on-write and the view keeps showing the elements it was taken from
+ *  @author Niko Lehto
+ *  */
+
+/**
+ *  \brief Empty constructor, view of 0x0 matrix
+ */
+SquareMatrixView::SquareMatrixView() = default;
+
+/**
+ *  \brief Constructs a view of the whole matrix
+ *  \param [in] m const SquareMatrix& viewed matrix
+ */
+SquareMatrixView::SquareMatrixView(const SquareMatrix& m)
+{
+    this->elements = m.elements;
+    this->first = m.elements.get();
+    this->n = m.n;
+    this->stride = m.n;
+}
+
+/**
+ *  \brief Constructs a view of given block
+ *  \param [in] elements const std::shared_ptr<int>& storage that contains the block
+ *  \param [in] first const int* first element of block
+ *  \param [in] n int dimension of block
+ *  \param [in] stride size_t distance between rows in elements
+ */
+SquareMatrixView::SquareMatrixView(const std::shared_ptr<int>& elements, const int* first, int n, size_t stride)
+{
+    this->elements = elements;
+    this->first = first;
+    this->n = n;
+    this->stride = stride;
+}
+
+/**
+ *  \brief Clone constructor, shares the block of v
+ *  \param [in] v const SquareMatrixView& view to clone
+ */
+SquareMatrixView::SquareMatrixView(const SquareMatrixView& v) = default;
+
+/**
+ *  \brief Destructor
+ */
+SquareMatrixView::~SquareMatrixView() = default;
+
+/**
+ *  \brief Assignment, shares the block of v
+ *  \param [in] v const SquareMatrixView& view to assign
+ *  \return Reference to this view
+ */
+SquareMatrixView& SquareMatrixView::operator=(const SquareMatrixView& v) = default;
+
+/**
+ *  \brief Getter for dimension
+ *  \return int dimension n of viewed nxn block
+ */
+int SquareMatrixView::getDimension() const
+{
+    return this->n;
+}
+
+/**
+ *  \brief Getter for row stride
+ *  \return size_t distance between consecutive rows in elements
+ */
+size_t SquareMatrixView::getStride() const
+{
+    return this->stride;
+}
+
+/**
+ *  \brief Getter for row of the block
+ *  \param [in] r size_t row index starting from 0, not checked
+ *  \return const int* first element of row r
+ */
+const int* SquareMatrixView::row(size_t r) const
+{
+    return this->first + r * this->stride;
+}
+
+/**
+ *  \brief Getter for single element
+ *  \param [in] row size_t row index starting from 0
+ *  \param [in] col size_t column index starting from 0
+ *  \return IntElement element at row, col of the block
+ */
+IntElement SquareMatrixView::getElement(size_t row, size_t col) const
+{
+    if(row >= static_cast<size_t>(n) || col >= static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Element index out of matrix");
+    }
+    return IntElement(this->row(row)[col]);
+}
+
+/**
+ *  \brief Makes view of a sub-block without copying
+ *  \param [in] row size_t first row of sub-block
+ *  \param [in] col size_t first column of sub-block
+ *  \param [in] size size_t dimension of sub-block
+ *  \return SquareMatrixView size x size view starting from row, col
+ */
+SquareMatrixView SquareMatrixView::block(size_t row, size_t col, size_t size) const
+{
+    if(row + size > static_cast<size_t>(n) || col + size > static_cast<size_t>(n))
+    {
+        throw std::out_of_range("Block does not fit into matrix");
+    }
+    return SquareMatrixView(this->elements, this->row(row) + col, static_cast<int>(size), this->stride);
+}
+
+/**
+ *  \brief Make transpose of the viewed block
+ *  \return new matrix transposed
+ */
+SquareMatrix SquareMatrixView::transpose() const
+{
+    size_t t_n = this->n;
+    SquareMatrix transpose;
+    transpose.allocate(this->n);
+
+    int* target = transpose.elements.get();
+    for(size_t x = 0; x < t_n; x++)
+    {
+        const int* source = this->row(x);
+        for(size_t y = 0; y < t_n; y++)
+        {
+            target[y * t_n + x] = source[y];
+        }
+    }
+
+    return transpose;
+}
+
+/**
+ *  \brief Write viewed block to stream in form of [[<a<SUB>11</SUB>>,...,<a<SUB>1n</SUB>>]...[<a<SUB>n1</SUB>>,...,<a<SUB>nn</SUB>>]]
+ *  \param [out] stream std::ostream& output stream
+ */
+void SquareMatrixView::print(std::ostream& stream) const
+{
+	stream << *this;
+}
+
+/**
+ *  \brief Write viewed block to string in form of [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \return std::string block as a string
+ */
+std::string SquareMatrixView::toString() const
+{
+	std::stringstream result;
+	result << *this;
+	return result.str();
+}
+
+/**
+ *  \brief Addition of two blocks
+ *  \param [in] a const SquareMatrixView&
+ *  \param [in] b const SquareMatrixView&
+ *  \return Addition of a and b as a new matrix
+ */
+SquareMatrix operator+(const SquareMatrixView& a, const SquareMatrixView& b)
+{
+    SquareMatrix t_a(a);
+    t_a += b;
+    return t_a;
+}
+
+/**
+ *  \brief Substraction of two blocks
+ *  \param [in] a const SquareMatrixView&
+ *  \param [in] b const SquareMatrixView&
+ *  \return Substraction of a and b as a new matrix
+ */
+SquareMatrix operator-(const SquareMatrixView& a, const SquareMatrixView& b)
+{
+    SquareMatrix t_a(a);
+    t_a -= b;
+    return t_a;
+}
+
+/**
+ *  \brief Dot-product of two blocks. Reads both blocks in place, only the result is allocated
+ *  \param [in] a const SquareMatrixView&
+ *  \param [in] b const SquareMatrixView&
+ *  \return Dot-product of a and b as a new matrix
+ */
+SquareMatrix operator*(const SquareMatrixView& a, const SquareMatrixView& b)
+{
+    return SquareMatrix::multiply(a, b);
+}
+
+/**
+ *  \brief Write viewed block to stream in form of [[<i<SUB>11</SUB>>,<i<SUB>12</SUB>>][<i<SUB>21</SUB>>,<i<SUB>22</SUB>>]]
+ *  \param [in,out] stream std::ostream&
+ *  \param [in] v const SquareMatrixView& v
+ *  \return stream appended by block
+ */
+std::ostream& operator<<(std::ostream& stream, const SquareMatrixView& v)
+{
+	stream << "[";
+    for(int i = 0; i < v.n; i++)
+    {
+        const int* row = v.row(i);
+        stream << "[";
+        for(int ind = 0; ind < v.n; ind++)
+        {
+            if(ind != v.n - 1)
+            {
+                stream << row[ind] << ",";
+            }
+            else
+            {
+                stream << row[ind];
+            }
+        }
+        stream << "]";
+    }
+    stream << "]";
+
+    return stream;
+}
+
+/**
+ *  \brief Overload of equal comparison
+ *  \param [in] a const SquareMatrixView& first block
+ *  \param [in] b const SquareMatrixView& second block
+ *  \return bool true if blocks have identical elements
+ */
+bool operator==(const SquareMatrixView& a, const SquareMatrixView& b)
+{
+    if(a.n != b.n)
+    {
+        return false;
+    }
+
+    for(int i = 0; i < a.n; i++)
+    {
+        if(!std::equal(a.row(i), a.row(i) + a.n, b.row(i)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
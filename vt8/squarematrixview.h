@@ -0,0 +1,49 @@
+#ifndef SQUAREMATRIXVIEW_H
+#define SQUAREMATRIXVIEW_H
+
+#include "intelement.h"
+
+#include <memory>
+#include <sstream>
+
+class SquareMatrix;
+
+/**
+ * @file squarematrixview.h
+ * @version 1.0
+ * @brief Declaration of SquareMatrixView
+ * @author Niko Lehto
+ */
+class SquareMatrixView
+{
+private:
+	std::shared_ptr<int> elements; // keeps viewed storage alive
+	const int* first = nullptr;
+	int n = 0;
+	size_t stride = 0;
+
+	SquareMatrixView(const std::shared_ptr<int>& elements, const int* first, int n, size_t stride);
+
+public:
+	SquareMatrixView();
+	SquareMatrixView(const SquareMatrix& m);
+	SquareMatrixView(const SquareMatrixView& v);
+	~SquareMatrixView();
+
+	int getDimension() const;
+	size_t getStride() const;
+	const int* row(size_t r) const;
+	IntElement getElement(size_t row, size_t col) const;
+	SquareMatrixView block(size_t row, size_t col, size_t size) const;
+	SquareMatrix transpose() const;
+	void print(std::ostream& os) const;
+	std::string toString() const;
+
+	friend bool operator==(const SquareMatrixView& a, const SquareMatrixView& b);
+	SquareMatrixView& operator=(const SquareMatrixView& v);
+	friend SquareMatrix operator+(const SquareMatrixView& a, const SquareMatrixView& b);
+	friend SquareMatrix operator-(const SquareMatrixView& a, const SquareMatrixView& b);
+	friend SquareMatrix operator*(const SquareMatrixView& a, const SquareMatrixView& b);
+	friend std::ostream& operator<<(std::ostream& stream, const SquareMatrixView& v);
+};
+#endif
@@ -0,0 +1,50 @@
+#include "catch.hpp"
+#include "squarematrix.h"
+#include "squarematrixview.h"
+
+/**
+ *  @file squarematrixview_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for SquareMatrixView class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for SquareMatrixView, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("SquareMatrixView", "[SquareMatrixView]")
+{
+    SquareMatrix a("[[1,2,3,4][5,6,7,8][9,10,11,12][13,14,15,16]]");
+    SquareMatrixView whole(a);
+    SquareMatrixView topLeft = a.block(0, 0, 2);
+    SquareMatrixView bottomRight = a.block(2, 2, 2);
+
+    REQUIRE(whole == SquareMatrixView(a));
+    REQUIRE(whole.getStride() == 4);
+    REQUIRE(topLeft.toString() == "[[1,2][5,6]]");
+    REQUIRE(bottomRight.toString() == "[[11,12][15,16]]");
+    REQUIRE(bottomRight.block(1, 0, 1).toString() == "[[15]]");
+    REQUIRE(bottomRight.getElement(0, 1) == IntElement(12));
+    REQUIRE(a.block(1, 1, 2).transpose() == SquareMatrix("[[6,10][7,11]]"));
+    REQUIRE_THROWS_AS(a.block(3, 0, 2), std::out_of_range);
+    REQUIRE_THROWS_AS(topLeft.getElement(2, 0), std::out_of_range);
+
+    REQUIRE(topLeft + bottomRight == SquareMatrix("[[12,14][20,22]]"));
+    REQUIRE(bottomRight - topLeft == SquareMatrix("[[10,10][10,10]]"));
+    REQUIRE(topLeft * bottomRight == SquareMatrix("[[41,44][145,156]]"));
+    REQUIRE(SquareMatrix("[[1,1][1,1]]") + topLeft == SquareMatrix("[[2,3][6,7]]"));
+    REQUIRE_THROWS_WITH(whole + topLeft, "operator requires same sized matrices");
+
+    SquareMatrix b("[[1,0][0,1]]");
+    b *= bottomRight;
+    REQUIRE(b == SquareMatrix(bottomRight));
+
+    // view keeps showing the original elements after the matrix is modified
+    SquareMatrix c(a);
+    c.setBlock(0, 0, c.block(2, 2, 2));
+    REQUIRE(c.toString() == "[[11,12,3,4][15,16,7,8][9,10,11,12][13,14,15,16]]");
+    REQUIRE(a.toString() == "[[1,2,3,4][5,6,7,8][9,10,11,12][13,14,15,16]]");
+    REQUIRE(topLeft.toString() == "[[1,2][5,6]]");
+    REQUIRE_THROWS_AS(c.setBlock(3, 3, topLeft), std::out_of_range);
+}
@@ -0,0 +1,366 @@
+#include "tuning.h"
+#include "squarematrix.h"
+#include "gemmkernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ *  @file tuning.cpp
+ *  @brief Implementation of Tuning
+ *  */
+
+ /**
+ *  @class Tuning
+ *  @version 1.0
+ *  @brief Machine specific parameters of matrix operations. The profile is read on first use from the file named by
+ *      SQUAREMATRIX_TUNING, or ~/.squarematrix_tuning, and falls back to values derived from cache sizes.
+ *      autotune() measures candidate parameters on this machine and the best one can be saved as the profile.
+ *      A profile written on a machine with different caches or cpu count is ignored
+ *  @author Niko Lehto
+ *  */
+
+std::mutex Tuning::lock;
+Tuning::Profile Tuning::profile;
+bool Tuning::loaded = false;
+
+/**
+ *  \brief Reads size of a cache level from /sys, used when sysconf does not know it
+ *  \param [in] level int cache level
+ *  \return size_t bytes, 0 if not found
+ */
+static size_t sysCacheSize(int level)
+{
+    for(int index = 0; index < 8; index++)
+    {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream levelFile(dir + "level"), typeFile(dir + "type"), sizeFile(dir + "size");
+        int t_level = 0;
+        std::string type, size;
+        if(!(levelFile >> t_level) || !(typeFile >> type) || !(sizeFile >> size))
+        {
+            continue;
+        }
+        if(t_level != level || type == "Instruction")
+        {
+            continue;
+        }
+        size_t value = std::stoul(size);
+        char unit = size.back();
+        return unit == 'K' ? value * 1024 : unit == 'M' ? value * 1024 * 1024 : value;
+    }
+    return 0;
+}
+
+/**
+ *  \brief Finds cache sizes with sysconf, or from /sys where sysconf does not tell
+ *  \return CacheInfo caches of this machine, unknown sizes are 0
+ */
+Tuning::CacheInfo Tuning::detectCaches()
+{
+    CacheInfo caches;
+    long value;
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    value = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    caches.l1 = value > 0 ? value : 0;
+    value = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    caches.l2 = value > 0 ? value : 0;
+    value = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    caches.l3 = value > 0 ? value : 0;
+    value = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    caches.lineSize = value > 0 ? value : 0;
+#endif
+
+    if(caches.l1 == 0)
+    {
+        caches.l1 = sysCacheSize(1);
+    }
+    if(caches.l2 == 0)
+    {
+        caches.l2 = sysCacheSize(2);
+    }
+    if(caches.l3 == 0)
+    {
+        caches.l3 = sysCacheSize(3);
+    }
+    if(caches.lineSize == 0)
+    {
+        caches.lineSize = 64;
+    }
+    caches.cpus = std::thread::hardware_concurrency();
+
+    return caches;
+}
+
+/**
+ *  \brief Derives parameters from cache sizes: packed left-hand side block filling half of level 2 cache and
+ *      packed right-hand side panel filling half of level 3 cache
+ *  \param [in] caches const CacheInfo& caches of the machine
+ *  \return Profile parameters
+ */
+Tuning::Profile Tuning::defaultProfile(const CacheInfo& caches)
+{
+    Profile p;
+    size_t l2 = caches.l2 != 0 ? caches.l2 : 256 * 1024;
+    size_t l3 = caches.l3 != 0 ? caches.l3 : 4 * l2;
+
+    p.depthBlock = 256;
+    p.rowBlock = std::max<size_t>(GemmKernel::rowRegisters, l2 / 2 / (p.depthBlock * sizeof(int)) / GemmKernel::rowRegisters * GemmKernel::rowRegisters);
+    p.columnBlock = std::min<size_t>(4096, std::max<size_t>(256, l3 / 2 / (p.depthBlock * sizeof(int)) / GemmKernel::columnRegisters * GemmKernel::columnRegisters));
+    return p;
+}
+
+/**
+ *  \brief Measures multiplication of two nxn matrices with candidate parameters and returns the fastest.
+ *      Active profile is restored afterwards
+ *  \param [in] n int dimension of test matrices, should be in the range of real workloads
+ *  \param [out] log std::ostream* progress output, may be nullptr
+ *  \return Profile fastest parameters
+ */
+Tuning::Profile Tuning::autotune(int n, std::ostream* log)
+{
+    CacheInfo caches = detectCaches();
+    Profile original = getProfile();
+
+    std::vector<unsigned int> threadCounts = {caches.cpus};
+    if(caches.cpus > 2)
+    {
+        threadCounts.push_back(caches.cpus / 2);
+    }
+    std::vector<size_t> depths = {32, 64, 128, 256, 512};
+    std::vector<size_t> columns = {256, 512, 1024, 2048, 4096};
+
+    SquareMatrix a(n), b(n), c(n);
+    Profile best = defaultProfile(caches);
+    double bestSeconds = -1;
+
+    for(unsigned int threads : threadCounts)
+    {
+        for(size_t depth : depths)
+        {
+            for(size_t column : columns)
+            {
+                // packed panel of right-hand side must fit into level 3 cache to be reused
+                if(caches.l3 != 0 && depth * column * sizeof(int) > caches.l3)
+                {
+                    continue;
+                }
+
+                Profile candidate = original;
+                candidate.threads = threads;
+                candidate.depthBlock = depth;
+                candidate.columnBlock = column;
+                candidate.rowBlock = std::max<size_t>(GemmKernel::rowRegisters, (caches.l2 != 0 ? caches.l2 : 256 * 1024) / 2 / (depth * sizeof(int)) / GemmKernel::rowRegisters * GemmKernel::rowRegisters);
+                setProfile(candidate);
+
+                double seconds = -1;
+                for(int run = 0; run < 2; run++)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    SquareMatrix::gemm(c, a, b);
+                    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                    if(seconds < 0 || elapsed.count() < seconds)
+                    {
+                        seconds = elapsed.count();
+                    }
+                }
+
+                if(log != nullptr)
+                {
+                    *log << "threads " << threads << ", depth " << depth << ", columns " << column << ": " << seconds << " s" << std::endl;
+                }
+                if(bestSeconds < 0 || seconds < bestSeconds)
+                {
+                    bestSeconds = seconds;
+                    best = candidate;
+                }
+            }
+        }
+    }
+
+    // double precision kernel is exact for values of this size, it is used if it beats the 32-bit kernel
+    SquareMatrix left(n), right(n);
+    for(int i = 0; i < n; i++)
+    {
+        for(int j = 0; j < n; j++)
+        {
+            left.setElement(i, j, IntElement((i * 40503 + j * 9973) % 200000 - 100000));
+            right.setElement(i, j, IntElement((i * 7919 + j * 104729) % 200000 - 100000));
+        }
+    }
+    std::vector<int> product(static_cast<size_t>(n) * n);
+    double kernelSeconds[2] = {-1, -1};
+    for(int run = 0; run < 4; run++)
+    {
+        GemmKernel::Path path = run % 2 == 0 ? GemmKernel::Wide : GemmKernel::Double;
+        auto start = std::chrono::steady_clock::now();
+        GemmKernel::multiply(0, n, 0, n, 1, left, right, product.data(), n, best, path);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double& seconds = kernelSeconds[run % 2];
+        if(seconds < 0 || elapsed.count() < seconds)
+        {
+            seconds = elapsed.count();
+        }
+    }
+    best.doubleKernel = kernelSeconds[1] < kernelSeconds[0];
+    if(log != nullptr)
+    {
+        *log << "kernel " << GemmKernel::getName() << ": " << kernelSeconds[0] << " s, double: " << kernelSeconds[1] << " s" << std::endl;
+    }
+
+    if(best.threads == caches.cpus)
+    {
+        best.threads = 0; // follow hardware if it changes
+    }
+    setProfile(original);
+    return best;
+}
+
+/**
+ *  \brief Getter for active profile. First call loads startup profile
+ *  \return Profile active parameters
+ */
+Tuning::Profile Tuning::getProfile()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(!loaded)
+    {
+        profile = loadStartupProfile();
+        loaded = true;
+    }
+    return profile;
+}
+
+/**
+ *  \brief Replaces active profile for operations started afterwards
+ *  \param [in] p const Profile& new parameters
+ */
+void Tuning::setProfile(const Profile& p)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    profile = p;
+    loaded = true;
+}
+
+/**
+ *  \brief Path of profile loaded at startup
+ *  \return std::string value of SQUAREMATRIX_TUNING, or .squarematrix_tuning in home directory
+ */
+std::string Tuning::defaultPath()
+{
+    const char* path = std::getenv("SQUAREMATRIX_TUNING");
+    if(path != nullptr && *path != '\0')
+    {
+        return path;
+    }
+    const char* home = std::getenv("HOME");
+    return std::string(home != nullptr ? home : ".") + "/.squarematrix_tuning";
+}
+
+/**
+ *  \brief Writes profile with the cache sizes of this machine as key=value lines
+ *  \param [in] p const Profile& parameters to save
+ *  \param [in] path const std::string& file to write
+ */
+void Tuning::save(const Profile& p, const std::string& path)
+{
+    CacheInfo caches = detectCaches();
+    std::ofstream file(path);
+    if(!file)
+    {
+        throw std::runtime_error("Can not write tuning profile \"" + path + "\"");
+    }
+
+    file << "# SquareMatrix tuning profile\n"
+         << "l1=" << caches.l1 << "\n"
+         << "l2=" << caches.l2 << "\n"
+         << "l3=" << caches.l3 << "\n"
+         << "cpus=" << caches.cpus << "\n"
+         << "threads=" << p.threads << "\n"
+         << "depthBlock=" << p.depthBlock << "\n"
+         << "columnBlock=" << p.columnBlock << "\n"
+         << "rowBlock=" << p.rowBlock << "\n"
+         << "parallelGrain=" << p.parallelGrain << "\n"
+         << "doubleKernel=" << p.doubleKernel << "\n";
+}
+
+/**
+ *  \brief Reads profile written by save
+ *  \param [in] path const std::string& file to read
+ *  \param [out] p Profile& parameters, unchanged if false is returned
+ *  \return bool true if file was a valid profile written on a machine with the same caches and cpu count
+ */
+bool Tuning::load(const std::string& path, Profile& p)
+{
+    std::ifstream file(path);
+    if(!file)
+    {
+        return false;
+    }
+
+    CacheInfo caches = detectCaches();
+    CacheInfo saved;
+    Profile result;
+    std::string line;
+    while(std::getline(file, line))
+    {
+        size_t equals = line.find('=');
+        if(line.empty() || line[0] == '#' || equals == std::string::npos)
+        {
+            continue;
+        }
+
+        std::string key = line.substr(0, equals);
+        size_t value;
+        try
+        {
+            value = std::stoul(line.substr(equals + 1));
+        }
+        catch(const std::exception&)
+        {
+            return false;
+        }
+
+        if(key == "l1") saved.l1 = value;
+        else if(key == "l2") saved.l2 = value;
+        else if(key == "l3") saved.l3 = value;
+        else if(key == "cpus") saved.cpus = value;
+        else if(key == "threads") result.threads = value;
+        else if(key == "depthBlock") result.depthBlock = value;
+        else if(key == "columnBlock") result.columnBlock = value;
+        else if(key == "rowBlock") result.rowBlock = value;
+        else if(key == "parallelGrain") result.parallelGrain = value;
+        else if(key == "doubleKernel") result.doubleKernel = value != 0;
+    }
+
+    if(saved.l1 != caches.l1 || saved.l2 != caches.l2 || saved.l3 != caches.l3 || saved.cpus != caches.cpus)
+    {
+        return false;
+    }
+    if(result.depthBlock == 0 || result.columnBlock == 0 || result.rowBlock == 0)
+    {
+        return false;
+    }
+
+    p = result;
+    return true;
+}
+
+/**
+ *  \brief Profile used before anything is set: saved profile if valid for this machine, otherwise derived from caches
+ *  \return Profile startup parameters
+ */
+Tuning::Profile Tuning::loadStartupProfile()
+{
+    Profile p = defaultProfile(detectCaches());
+    load(defaultPath(), p);
+    return p;
+}
@@ -0,0 +1,55 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+
+/**
+ * @file tuning.h
+ * @version 1.0
+ * @brief Declaration of Tuning
+ * @author Niko Lehto
+ */
+class Tuning
+{
+public:
+    struct CacheInfo
+    {
+        size_t l1 = 0;       ///< level 1 data cache bytes per core
+        size_t l2 = 0;       ///< level 2 cache bytes per core
+        size_t l3 = 0;       ///< level 3 cache bytes, shared
+        size_t lineSize = 0; ///< cache line bytes
+        unsigned int cpus = 0; ///< hardware threads
+    };
+
+    struct Profile
+    {
+        unsigned int threads = 0; ///< workers per operation, 0 uses all hardware threads
+        size_t depthBlock = 256;  ///< rows of right-hand side packed per pass in multiplication (KC)
+        size_t columnBlock = 1024; ///< columns of right-hand side packed per pass in multiplication (NC)
+        size_t rowBlock = 96;     ///< rows of left-hand side packed per pass in multiplication (MC)
+        size_t parallelGrain = 65536; ///< element operations a worker must get before another worker is started
+        bool doubleKernel = false; ///< multiply with double precision FMA when exact, set by autotune if it is faster
+    };
+
+private:
+    static std::mutex lock;
+    static Profile profile;
+    static bool loaded;
+
+    static Profile loadStartupProfile();
+
+public:
+    static CacheInfo detectCaches();
+    static Profile defaultProfile(const CacheInfo& caches);
+    static Profile autotune(int n, std::ostream* log = nullptr);
+
+    static Profile getProfile();
+    static void setProfile(const Profile& p);
+    static std::string defaultPath();
+    static void save(const Profile& p, const std::string& path);
+    static bool load(const std::string& path, Profile& p);
+};
+#endif
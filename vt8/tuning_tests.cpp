@@ -0,0 +1,66 @@
+#include "catch.hpp"
+#include "tuning.h"
+#include "squarematrix.h"
+
+#include <cstdio>
+#include <fstream>
+
+/**
+ *  @file tuning_tests.cpp
+ *  @version 1.0
+ *  @brief Test Case for Tuning class
+ *  @author Niko Lehto
+ *  */
+
+/**
+*  \brief Unit tests for Tuning, will run in main generated by catch.hpp
+*  \return 0 if tests passes
+*/
+TEST_CASE("Tuning", "[Tuning]")
+{
+    Tuning::CacheInfo caches = Tuning::detectCaches();
+    REQUIRE(caches.lineSize > 0);
+    REQUIRE(Tuning::defaultProfile(caches).depthBlock >= 16);
+
+    std::string path = "tuning_test_profile.txt";
+    Tuning::Profile saved, loaded;
+    saved.threads = 3;
+    saved.depthBlock = 48;
+    saved.columnBlock = 640;
+    saved.doubleKernel = true;
+    Tuning::save(saved, path);
+    REQUIRE(Tuning::load(path, loaded));
+    REQUIRE(loaded.threads == 3);
+    REQUIRE(loaded.depthBlock == 48);
+    REQUIRE(loaded.columnBlock == 640);
+    REQUIRE(loaded.doubleKernel);
+
+    // profile of another machine is ignored
+    {
+        std::ofstream file(path, std::ios::app);
+        file << "cpus=" << caches.cpus + 1 << "\n";
+    }
+    Tuning::Profile unchanged;
+    REQUIRE_FALSE(Tuning::load(path, unchanged));
+    REQUIRE(unchanged.depthBlock == Tuning::Profile().depthBlock);
+    REQUIRE_FALSE(Tuning::load("no_such_tuning_profile.txt", unchanged));
+    std::remove(path.c_str());
+
+    // odd block sizes give same result
+    Tuning::Profile original = Tuning::getProfile();
+    SquareMatrix a("[[1,2,3,4,5][6,7,8,9,10][11,12,13,14,15][16,17,18,19,20][21,22,23,24,25]]");
+    SquareMatrix expected = a * a;
+    Tuning::Profile odd;
+    odd.threads = 2;
+    odd.depthBlock = 2;
+    odd.columnBlock = 3;
+    Tuning::setProfile(odd);
+    SquareMatrix result = a * a;
+    Tuning::setProfile(original);
+    REQUIRE(result == expected);
+    REQUIRE(expected.toString() == "[[215,230,245,260,275][490,530,570,610,650][765,830,895,960,1025][1040,1130,1220,1310,1400][1315,1430,1545,1660,1775]]");
+
+    Tuning::Profile tuned = Tuning::autotune(32);
+    REQUIRE(tuned.depthBlock > 0);
+    REQUIRE(Tuning::getProfile().depthBlock == original.depthBlock);
+}